@@ -0,0 +1,143 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#include "Simulation.h"
+#include "Profiler.h"
+
+#define DEFAULT_NODES 100000
+#define DEFAULT_STEPS 1000
+#define WARMUP_STEPS  10
+#define DT            (1./30)
+
+/* The names of the solvers, in the order of the Solver enumeration. */
+static const char* SOLVERS[] = {"explicit", "implicit", "xpbd"};
+
+static double now(){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+/* Fills the simulation with a triangulated square grid of about nb_nodes nodes, i.e. with about 3 springs per node,
+ * hence 6 springs touching every inner node, the density of the meshes met in practice. */
+static char build_grid(Simulation* sim, int nb_nodes){
+	int side = ceil(sqrt(nb_nodes));
+	float spacing = sim->L0;
+	for (int r = 0; r < side; r++){
+		for (int c = 0; c < side; c++){
+			if (Nodes_add(&sim->nodes, (c+1)*spacing, (r+1)*spacing, r == 0) < 0){
+				return 1;
+			}
+		}
+	}
+	for (int r = 0; r < side; r++){
+		for (int c = 0; c < side; c++){
+			int i = r*side + c;
+			if (c+1 < side && Springs_add(&sim->springs, i, i+1)){
+				return 1;
+			}
+			if (r+1 < side && Springs_add(&sim->springs, i, i+side)){
+				return 1;
+			}
+			if (c+1 < side && r+1 < side && Springs_add(&sim->springs, i, i+side+1)){
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char** argv){
+	int nb_nodes = (argc > 1)?atoi(argv[1]):DEFAULT_NODES;
+	int nb_steps = (argc > 2)?atoi(argv[2]):DEFAULT_STEPS;
+	int nb_threads = (argc > 3)?atoi(argv[3]):1;
+	const char* solver = (argc > 4)?argv[4]:"explicit";
+	const char* springs = (argc > 5)?argv[5]:"shared";
+	int solver_id = -1;
+	for (int id = 0; id < (int)(sizeof(SOLVERS)/sizeof(SOLVERS[0])); id++){
+		if (strcmp(solver, SOLVERS[id]) == 0){
+			solver_id = id;
+		}
+	}
+	char materials = strcmp(springs, "materials") == 0;
+	if (nb_nodes <= 0 || nb_steps <= 0 || nb_threads < 0 || solver_id < 0 || (!materials && strcmp(springs, "shared"))){
+		fprintf(stderr, "usage: %s [nodes] [steps] [threads, 0 for one per core] [explicit|implicit|xpbd] "
+				"[shared|materials]\n", argv[0]);
+		return 1;
+	}
+
+	int side = ceil(sqrt(nb_nodes));
+	nb_nodes = side*side;
+	Simulation sim;
+	if (Simulation_create(&sim, nb_nodes, (side+1)*SIMULATION_L0, (side+1)*SIMULATION_L0)){
+		fprintf(stderr, "Could not allocate %d nodes.\n", nb_nodes);
+		return 1;
+	}
+	// with materials, every spring has its own parameters, its rest length being the one of the grid.
+	if (build_grid(&sim, nb_nodes)
+			|| (materials && Springs_use_materials(&sim.springs, sim.nodes.x, sim.nodes.y, sim.K, sim.Kd))){
+		fprintf(stderr, "Could not allocate the mesh.\n");
+		Simulation_free(&sim);
+		return 1;
+	}
+
+	sim.solver = solver_id;
+	if (Simulation_set_threads(&sim, nb_threads)){
+		fprintf(stderr, "Could not start the threads.\n");
+		Simulation_free(&sim);
+		return 1;
+	}
+
+	printf("soft-body-bench: %d nodes, %d %s springs, %d steps, %s kernels, %d threads, %s solver\n",
+			sim.nodes.count, sim.springs.count, springs, nb_steps, sim.kernels.name, ThreadPool_size(sim.pool), solver);
+
+	for (int step = 0; step < WARMUP_STEPS; step++){
+		Simulation_step(&sim, DT);
+	}
+
+	// the phases are timed separately so that the cost of a node, of a spring and of a contact query can be told apart.
+	double forces = 0, contacts = 0, solve = 0, integrate = 0;
+	int iterations = 0;
+	double start = now();
+	for (int step = 0; step < nb_steps; step++){
+		double t0 = now();
+		Simulation_compute_forces(&sim);
+		double t1 = now();
+		Simulation_compute_contacts(&sim);
+		double t2 = now();
+		Simulation_solve(&sim, DT);
+		double t3 = now();
+		Simulation_integrate(&sim, DT);
+		double t4 = now();
+		forces += t1 - t0;
+		contacts += t2 - t1;
+		solve += t3 - t2;
+		integrate += t4 - t3;
+		iterations += sim.implicit.iterations;
+	}
+	double total = now() - start;
+
+	printf("steps/s:          %.2f\n", nb_steps/total);
+	printf("ns/step:          %.0f\n", total*1e9/nb_steps);
+	printf("ns/node-update:   %.3f\n", integrate*1e9/((double)nb_steps*sim.nodes.count));
+	printf("ns/spring-update: %.3f\n", forces*1e9/((double)nb_steps*sim.springs.count));
+	printf("ns/contact-query: %.3f\n", contacts*1e9/((double)nb_steps*sim.nodes.count));
+	if (sim.solver != SOLVER_EXPLICIT){
+		printf("ns/solve:         %.0f\n", solve*1e9/nb_steps);
+	}
+	if (sim.solver == SOLVER_IMPLICIT){
+		printf("iterations/step:  %.2f\n", (double)iterations/nb_steps);
+	}
+
+#ifdef SOFT_BODY_PROFILE
+	if (getenv("SOFT_BODY_TRACE") != NULL){
+		Profiler_dump(getenv("SOFT_BODY_TRACE"));
+	}
+#endif
+	Simulation_free(&sim);
+	Profiler_free();
+	return 0;
+}
@@ -0,0 +1,403 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#include "Simulation.h"
+#include "Raster.h"
+
+/* The sizes swept, every size being ten times the previous one. */
+#define MIN_NODES     10
+#define MAX_NODES     1000000
+/* The number of timed repetitions of every case, and the time a repetition should last at least, in seconds, a
+ * repetition calling the kernel as many times as needed. */
+#define REPETITIONS   5
+#define MIN_TIME      0.02
+#define DT            (1./30)
+/* The seed the random meshes are numbered with. */
+#define SEED          0x9e3779b9u
+/* The size of the framebuffer the meshes are drawn into, in pixels, and the sizes of the lines and of the discs. */
+#define CANVAS        1024
+#define LINE_WIDTH    1
+#define DISC_RADIUS   2
+
+/* The names of the topologies of the meshes: a chain, where every node is linked to the next one, the triangulated
+ * square grid of the benchmark, and the same grid with its nodes numbered at random, whose springs have no locality in
+ * memory at all. */
+static const char* TOPOLOGIES[] = {"chain", "grid", "random"};
+#define NB_TOPOLOGIES ((int)(sizeof(TOPOLOGIES)/sizeof(TOPOLOGIES[0])))
+
+/* A mesh being measured, with the positions it starts from before every repetition. */
+typedef struct Case{
+	Simulation* sim;
+	Raster* raster;
+	float* x;
+	float* y;
+	/** The factor from the world to the framebuffer. */
+	float scale;
+} Case;
+
+static void run_springs(Case* c){
+	Simulation* sim = c->sim;
+	sim->kernels.springs(&sim->nodes, &sim->springs, 0, sim->springs.count, sim->K, sim->Kd, sim->L0);
+}
+
+static void run_integrate(Case* c){
+	Simulation* sim = c->sim;
+	sim->kernels.integrate(&sim->nodes, 0, sim->nodes.count, DT, sim->drag, FLT_MAX, FLT_MAX);
+}
+
+/* The integration in an empty box, so that every node hits the walls at every call. */
+static void run_walls(Case* c){
+	Simulation* sim = c->sim;
+	sim->kernels.integrate(&sim->nodes, 0, sim->nodes.count, DT, sim->drag, 0, 0);
+}
+
+static void run_contacts(Case* c){
+	Simulation_compute_contacts(c->sim);
+}
+
+static void run_step(Case* c){
+	Simulation_step(c->sim, DT);
+}
+
+/* An empty frame, i.e. the clearing and the drawing of the tiles of the framebuffer, whose cost is the same whatever
+ * is drawn and is taken out of the lines and the discs. */
+static void run_frame(Case* c){
+	Raster_clear(c->raster);
+	Raster_draw(c->raster, c->sim->pool);
+}
+
+static void run_lines(Case* c){
+	Simulation* sim = c->sim;
+	const float* x = sim->nodes.x;
+	const float* y = sim->nodes.y;
+	Raster_clear(c->raster);
+	for (int s = 0; s < sim->springs.count; s++){
+		int a = sim->springs.a[s];
+		int b = sim->springs.b[s];
+		Raster_line(c->raster, c->scale*x[a], c->scale*y[a], c->scale*x[b], c->scale*y[b], LINE_WIDTH, 0xffffff);
+	}
+	Raster_draw(c->raster, sim->pool);
+}
+
+static void run_discs(Case* c){
+	Simulation* sim = c->sim;
+	Raster_clear(c->raster);
+	for (int i = 0; i < sim->nodes.count; i++){
+		Raster_disc(c->raster, c->scale*sim->nodes.x[i], c->scale*sim->nodes.y[i], DISC_RADIUS, 0xff00ff);
+	}
+	Raster_draw(c->raster, sim->pool);
+}
+
+/* What the cost of a kernel is counted per. */
+typedef enum Per{
+	PER_NODE,
+	PER_SPRING,
+	PER_CALL,
+} Per;
+
+/* The kernels measured, what their cost is counted per, and whether the cost of an empty frame, measured before them,
+ * is taken out of theirs. */
+static const struct{
+	const char* name;
+	void (*run)(Case* c);
+	Per per;
+	char raster;
+} KERNELS[] = {
+	{"springs", run_springs, PER_SPRING, 0},
+	{"integrate", run_integrate, PER_NODE, 0},
+	{"walls", run_walls, PER_NODE, 0},
+	{"contacts", run_contacts, PER_NODE, 0},
+	{"step", run_step, PER_NODE, 0},
+	{"frame", run_frame, PER_CALL, 0},
+	{"lines", run_lines, PER_SPRING, 1},
+	{"discs", run_discs, PER_NODE, 1},
+};
+#define NB_KERNELS ((int)(sizeof(KERNELS)/sizeof(KERNELS[0])))
+
+static double now(){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+/* A xorshift generator, so that the random meshes are the same on every run and on every platform. */
+static uint32_t next_random(uint32_t* state){
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+/* Fills the simulation with a mesh of nb_nodes nodes laid out on a square grid, the chain snaking along its rows so
+ * that consecutive nodes stay neighbours. */
+static char build(Simulation* sim, int topology, int nb_nodes){
+	int side = ceil(sqrt(nb_nodes));
+	float spacing = sim->L0;
+	// the node at every place of the grid, shuffled by Fisher-Yates for the random meshes.
+	int* number = malloc(nb_nodes*sizeof(int));
+	if (number == NULL){
+		return 1;
+	}
+	uint32_t state = SEED;
+	for (int k = 0; k < nb_nodes; k++){
+		number[k] = k;
+		if (topology == 2){
+			int j = next_random(&state) % (k+1);
+			number[k] = number[j];
+			number[j] = k;
+		}
+	}
+	char failed = 0;
+	for (int i = 0; i < nb_nodes && !failed; i++){
+		failed = Nodes_add(&sim->nodes, 0, 0, 0) < 0;
+	}
+	for (int k = 0; k < nb_nodes && !failed; k++){
+		int r = k / side;
+		int c = (topology == 0 && r % 2)?side-1 - k % side:k % side;
+		Nodes_set(&sim->nodes, number[k], (c+1)*spacing, (r+1)*spacing, 0);
+		if (topology == 0){
+			failed = k+1 < nb_nodes && Springs_add(&sim->springs, k, k+1);
+			continue;
+		}
+		failed = (c+1 < side && k+1 < nb_nodes && Springs_add(&sim->springs, number[k], number[k+1]))
+				|| (k+side < nb_nodes && Springs_add(&sim->springs, number[k], number[k+side]))
+				|| (c+1 < side && k+side+1 < nb_nodes && Springs_add(&sim->springs, number[k], number[k+side+1]));
+	}
+	free(number);
+	return failed;
+}
+
+/* Puts the nodes back where they started, at rest under the gravity. */
+static void reset(Case* c){
+	Nodes* nodes = &c->sim->nodes;
+	memcpy(nodes->x, c->x, nodes->count*sizeof(float));
+	memcpy(nodes->y, c->y, nodes->count*sizeof(float));
+	memset(nodes->vx, 0, nodes->count*sizeof(float));
+	memset(nodes->vy, 0, nodes->count*sizeof(float));
+	Kernels_clear(nodes, 0, nodes->count, 0, c->sim->gravity);
+}
+
+static int compare_doubles(const void* a, const void* b){
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+/* Measures a kernel on a mesh, giving the number of calls per repetition and the times per item of the repetitions,
+ * sorted, as measured and once a fixed cost per call, in nanoseconds, is taken out. A first call warms the caches up and
+ * tells how many calls a repetition needs. */
+static int measure(Case* c, int kernel, int items, double overhead, double* times, double* raw){
+	reset(c);
+	KERNELS[kernel].run(c);
+	reset(c);
+	double start = now();
+	KERNELS[kernel].run(c);
+	double once = now() - start;
+	int iterations = (once < MIN_TIME)?MIN_TIME / ((once > 1e-7)?once:1e-7):1;
+	for (int r = 0; r < REPETITIONS; r++){
+		reset(c);
+		start = now();
+		for (int k = 0; k < iterations; k++){
+			KERNELS[kernel].run(c);
+		}
+		double call = (now() - start)*1e9 / iterations;
+		raw[r] = call / ((items > 0)?items:1);
+		times[r] = ((call > overhead)?call - overhead:0) / ((items > 0)?items:1);
+	}
+	qsort(times, REPETITIONS, sizeof(double), compare_doubles);
+	qsort(raw, REPETITIONS, sizeof(double), compare_doubles);
+	return iterations;
+}
+
+/* Runs every kernel on every topology and size, printing a table and writing the results as JSON, one result per line
+ * in a fixed order, so that the files of two commits can be compared line by line. */
+static int run(const char* output, int max_nodes, int nb_threads){
+	FILE* json = NULL;
+	if (output != NULL && (json = fopen(output, "w")) == NULL){
+		fprintf(stderr, "Could not open %s.\n", output);
+		return 1;
+	}
+	Raster raster = Raster_init();
+	if (Raster_resize(&raster, CANVAS, CANVAS, 0xff000000u)){
+		fprintf(stderr, "Could not allocate the framebuffer.\n");
+		if (json != NULL){
+			fclose(json);
+		}
+		return 1;
+	}
+	Kernels kernels = Kernels_select();
+	if (json != NULL){
+		fprintf(json, "{\n  \"kernels\": \"%s\",\n  \"threads\": %d,\n  \"repetitions\": %d,\n  \"unit\": \"ns/item\",\n"
+				"  \"results\": [\n", kernels.name, nb_threads, REPETITIONS);
+	}
+	printf("soft-body-suite: %s kernels, %d threads, %d repetitions, ns per node, spring or frame (min / median / max, "
+			"net of the frame when drawing, and the median as measured; * below the noise of the frame)\n",
+			kernels.name, nb_threads, REPETITIONS);
+	printf("%-10s %-7s %8s %8s %10s %10s %10s %10s\n", "kernel", "mesh", "nodes", "springs", "min", "median", "max",
+			"raw");
+
+	char failed = 0;
+	char first = 1;
+	for (int nb_nodes = MIN_NODES; nb_nodes <= max_nodes && !failed; nb_nodes *= 10){
+		for (int topology = 0; topology < NB_TOPOLOGIES && !failed; topology++){
+			Simulation sim;
+			int side = ceil(sqrt(nb_nodes));
+			if (Simulation_create(&sim, nb_nodes, (side+1)*SIMULATION_L0, (side+1)*SIMULATION_L0)){
+				failed = 1;
+				break;
+			}
+			Case c = {&sim, &raster, malloc(nb_nodes*sizeof(float)), malloc(nb_nodes*sizeof(float)),
+					(float)CANVAS / ((side+1)*SIMULATION_L0)};
+			// the whole mesh is stepped at every call, rather than what is left awake.
+			sim.sleeping = 0;
+			failed = c.x == NULL || c.y == NULL || build(&sim, topology, nb_nodes)
+					|| Simulation_set_threads(&sim, nb_threads);
+			if (!failed){
+				memcpy(c.x, sim.nodes.x, nb_nodes*sizeof(float));
+				memcpy(c.y, sim.nodes.y, nb_nodes*sizeof(float));
+			}
+			// the median cost of an empty frame, and how much it varies between the repetitions, in nanoseconds.
+			double frame = 0;
+			double frame_noise = 0;
+			for (int kernel = 0; kernel < NB_KERNELS && !failed; kernel++){
+				double times[REPETITIONS];
+				double raw[REPETITIONS];
+				Per per = KERNELS[kernel].per;
+				int items = (per == PER_SPRING)?sim.springs.count:(per == PER_NODE)?sim.nodes.count:1;
+				char raster = KERNELS[kernel].raster;
+				int iterations = measure(&c, kernel, items, raster?frame:0, times, raw);
+				double median = times[REPETITIONS/2];
+				if (per == PER_CALL){
+					frame = median;
+					frame_noise = times[REPETITIONS-1] - times[0];
+				}
+				// a drawing costing no more than the frame varies by cannot be told apart from the frame.
+				char noise = raster && median*((items > 0)?items:1) <= frame_noise;
+				printf("%-10s %-7s %8d %8d %10.3f %10.3f%c %9.3f %10.3f\n", KERNELS[kernel].name, TOPOLOGIES[topology],
+						sim.nodes.count, sim.springs.count, times[0], median, noise?'*':' ', times[REPETITIONS-1],
+						raw[REPETITIONS/2]);
+				if (json != NULL){
+					fprintf(json, "%s    {\"kernel\": \"%s\", \"topology\": \"%s\", \"nodes\": %d, \"springs\": %d, "
+							"\"iterations\": %d, \"min\": %.4f, \"median\": %.4f, \"max\": %.4f, \"raw\": %.4f, "
+							"\"noise\": %s}", first?"":",\n", KERNELS[kernel].name, TOPOLOGIES[topology], sim.nodes.count,
+							sim.springs.count, iterations, times[0], median, times[REPETITIONS-1], raw[REPETITIONS/2],
+							noise?"true":"false");
+					first = 0;
+				}
+			}
+			fflush(stdout);
+			free(c.x);
+			free(c.y);
+			Simulation_free(&sim);
+		}
+	}
+	if (json != NULL){
+		fprintf(json, "\n  ]\n}\n");
+		fclose(json);
+	}
+	Raster_free(&raster);
+	if (failed){
+		fprintf(stderr, "Could not allocate the meshes.\n");
+	}
+	return failed;
+}
+
+/* A result read back from a JSON file written by run. */
+typedef struct Result{
+	char kernel[32];
+	char topology[16];
+	int nodes;
+	double median;
+	/** This field tells whether the median is below the noise of the frame, see run. */
+	char noise;
+} Result;
+
+/* Reads the results of a JSON file, relying on the one result per line layout written by run. */
+static Result* load(const char* path, int* count){
+	FILE* file = fopen(path, "r");
+	if (file == NULL){
+		fprintf(stderr, "Could not open %s.\n", path);
+		return NULL;
+	}
+	Result* results = NULL;
+	int capacity = 0;
+	char line[512];
+	*count = 0;
+	while (fgets(line, sizeof(line), file) != NULL){
+		Result result;
+		char noise[8] = "false";
+		// the files written before the noise was measured have no such field, their results are taken as they are.
+		if (sscanf(line, " {\"kernel\": \"%31[^\"]\", \"topology\": \"%15[^\"]\", \"nodes\": %d, \"springs\": %*d, "
+				"\"iterations\": %*d, \"min\": %*f, \"median\": %lf, \"max\": %*f, \"raw\": %*f, \"noise\": %7[a-z]",
+				result.kernel, result.topology, &result.nodes, &result.median, noise) < 4){
+			continue;
+		}
+		result.noise = strcmp(noise, "true") == 0;
+		if (*count == capacity){
+			capacity = (capacity > 0)?2*capacity:128;
+			Result* grown = realloc(results, capacity*sizeof(Result));
+			if (grown == NULL){
+				free(results);
+				fclose(file);
+				return NULL;
+			}
+			results = grown;
+		}
+		results[(*count)++] = result;
+	}
+	fclose(file);
+	return (results != NULL)?results:calloc(1, sizeof(Result));
+}
+
+/* Prints the medians of the results found in both files, and how much faster or slower the second one is, unless one
+ * of them is below the noise or null. */
+static int compare(const char* before, const char* after){
+	int nb_old, nb_new;
+	Result* old = load(before, &nb_old);
+	Result* new = load(after, &nb_new);
+	if (old == NULL || new == NULL){
+		free(old);
+		free(new);
+		return 1;
+	}
+	printf("%-10s %-7s %8s %10s %10s %8s\n", "kernel", "mesh", "nodes", "before", "after", "change");
+	for (int n = 0; n < nb_new; n++){
+		for (int o = 0; o < nb_old; o++){
+			if (old[o].nodes == new[n].nodes && strcmp(old[o].kernel, new[n].kernel) == 0
+					&& strcmp(old[o].topology, new[n].topology) == 0){
+				printf("%-10s %-7s %8d %10.3f %10.3f ", new[n].kernel, new[n].topology, new[n].nodes, old[o].median,
+						new[n].median);
+				if (old[o].noise || new[n].noise || old[o].median <= 0){
+					printf("%8s\n", "noise");
+				} else {
+					printf("%+7.1f%%\n", 100*(new[n].median / old[o].median - 1));
+				}
+				break;
+			}
+		}
+	}
+	free(old);
+	free(new);
+	return 0;
+}
+
+int main(int argc, char** argv){
+	if (argc == 4 && strcmp(argv[1], "compare") == 0){
+		return compare(argv[2], argv[3]);
+	}
+	const char* output = (argc > 1 && strcmp(argv[1], "-") != 0)?argv[1]:NULL;
+	int max_nodes = (argc > 2)?atoi(argv[2]):MAX_NODES;
+	int nb_threads = (argc > 3)?atoi(argv[3]):1;
+	// an option, e.g. --help, is not taken for the name of the results.
+	if ((output != NULL && output[0] == '-') || argc > 4 || max_nodes < MIN_NODES || nb_threads < 0){
+		fprintf(stderr, "usage: %s [results.json|-] [max nodes] [threads, 0 for one per core]\n"
+				"       %s compare <before.json> <after.json>\n", argv[0], argv[0]);
+		return 1;
+	}
+	return run(output, max_nodes, nb_threads);
+}
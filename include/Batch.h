@@ -0,0 +1,197 @@
+#ifndef LIB_BATCH_H
+#define LIB_BATCH_H
+
+#include <SDL2/SDL.h>
+
+#include "Nodes.h"
+#include "Springs.h"
+#include "Bvh.h"
+#include "View.h"
+#include "Raster.h"
+#include "ThreadPool.h"
+
+/***********************************************************************************************************************
+ * @brief The Batch structure
+
+ * This structure gathers everything drawn during a frame into a single list of colored quads, so that the whole frame is
+ * submitted to the renderer with one call to SDL_RenderGeometry instead of one draw call, and one color change, per
+ * spring and per node. The springs are drawn as thin quads and the nodes as squares, in the order they are added.
+ * Everything is seen through a view, and what falls out of the window is culled before any quad is made, so that the
+ * batch holds what is on screen rather than the whole scene. When zoomed out, the nodes can be drawn as a density map
+ * of the window instead, whose number of quads is bounded by the number of pixels.
+ * The batch can also draw through a software rasterizer, see Raster, in which case the springs become antialiased
+ * lines and the nodes discs, and the frame is uploaded as a single streaming texture.
+ **********************************************************************************************************************/
+typedef struct Batch{
+	/** The four corners of every quad. */
+	SDL_Vertex* vertices;
+	/** The two triangles of every quad, which never change and are filled once when the batch grows. */
+	int* indices;
+	/** The springs left after the culling, their lengths as drawn, and their brightness, from 0 to 255. */
+	int* visible;
+	float* length;
+	float* shade;
+	/** The number of quads added since the batch was last cleared. */
+	int count;
+	/** The number of quads that fit in the arrays before they have to grow. */
+	int capacity;
+	/** The number of springs the visible, length and shade arrays can hold. */
+	int shade_capacity;
+	/** The number of nodes in every cell of the window, for the density map, and the number of cells it can hold. */
+	int* density;
+	int density_capacity;
+
+	/** The rasterizer the shapes go to instead of the quads, the texture it is uploaded to, NULL when the quads are
+	 * drawn by the renderer, and the threads it draws with. */
+	Raster raster;
+	SDL_Texture* texture;
+	ThreadPool* pool;
+} Batch;
+
+/***********************************************************************************************************************
+ * @brief Gives a newly initialized, empty, batch.
+
+ * @return the batch, nothing is allocated until it is filled.
+ **********************************************************************************************************************/
+extern Batch Batch_init();
+
+/***********************************************************************************************************************
+ * @brief Makes a batch draw through the software rasterizer rather than with the renderer.
+
+ * @param batch (Batch*): a pointer to the batch.
+ * @param renderer (SDL_Renderer*): the renderer the texture of the frame is created for.
+ * @param width (int): the width of the window, in pixels.
+ * @param height (int): the height of the window, in pixels.
+ * @param background (Uint32): the color of the background, as 0xAARRGGBB.
+ * @param pool (ThreadPool*): the threads the tiles of the frame are drawn by, NULL for the calling thread alone.
+
+ * @return a char, non zero if the texture or the framebuffer could not be created, the renderer being used then.
+ **********************************************************************************************************************/
+extern char Batch_use_raster(Batch* batch, SDL_Renderer* renderer, int width, int height, Uint32 background,
+		ThreadPool* pool);
+
+/***********************************************************************************************************************
+ * @brief Makes sure a batch can hold a given number of quads without growing.
+
+ * @param batch (Batch*): a pointer to the batch.
+ * @param capacity (int): the number of quads the batch should be able to hold.
+
+ * @return a char, non zero if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern char Batch_reserve(Batch* batch, int capacity);
+
+/***********************************************************************************************************************
+ * @brief Removes every quad, without releasing the memory.
+
+ * @param batch (Batch*): a pointer to the batch.
+ **********************************************************************************************************************/
+extern void Batch_clear(Batch* batch);
+
+/***********************************************************************************************************************
+ * @brief Adds every spring seen through a view.
+
+ * The springs are sorted into bins by the tiles of their ends, see Snapshot, and the bins whose two tiles lie out of
+ * the window are skipped as a whole, so that the cost follows what is on screen rather than the scene. In the other
+ * bins, the springs whose ends are both past the same side of the window, and the ones shorter than a given number of
+ * pixels, are left out. A spring is the brighter the shorter it is, with a brightness of 255*exp(-length/300). The
+ * lengths are measured on the positions the nodes are drawn at, and the brightness of the springs left is computed in a
+ * single branchless pass the compiler vectorizes.
+
+ * @param batch (Batch*): a pointer to the batch.
+ * @param springs (const Springs*): a pointer to the list of springs, sorted into the bins.
+ * @param tiles (const BvhBox*): the bounding box of every tile of nodes, see Snapshot.
+ * @param bins (const int*): the two tiles of the ends of the springs of every bin.
+ * @param bin_offsets (const int*): the first spring of every bin, followed by the number of springs.
+ * @param nb_bins (int): the number of bins.
+ * @param x (const float*): the x coordinates the nodes are drawn at, in the world.
+ * @param y (const float*): the y coordinates the nodes are drawn at, in the world.
+ * @param width (float): the width of the springs, in pixels.
+ * @param min_length (float): the length on screen below which a spring is left out, in pixels, 0 to draw them all.
+ * @param view (const View*): a pointer to the view.
+
+ * @return a char, non zero if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern char Batch_add_springs(Batch* batch, const Springs* springs, const BvhBox* tiles, const int* bins,
+		const int* bin_offsets, int nb_bins, const float* x, const float* y, float width, float min_length,
+		const View* view);
+
+/***********************************************************************************************************************
+ * @brief Adds a square for every node seen through a view.
+
+ * The nodes are white and the locked ones red. The tiles out of the window are skipped as a whole, then the nodes out
+ * of the window one by one.
+
+ * @param batch (Batch*): a pointer to the batch.
+ * @param nodes (const Nodes*): a pointer to the node store.
+ * @param tiles (const BvhBox*): the bounding box of every tile of tile_size consecutive nodes, see Snapshot.
+ * @param tile_size (int): the number of nodes of every tile.
+ * @param x (const float*): the x coordinates the nodes are drawn at, in the world.
+ * @param y (const float*): the y coordinates the nodes are drawn at, in the world.
+ * @param size (float): the size of the squares, in the world.
+ * @param view (const View*): a pointer to the view.
+
+ * @return a char, non zero if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern char Batch_add_nodes(Batch* batch, const Nodes* nodes, const BvhBox* tiles, int tile_size, const float* x,
+		const float* y, float size, const View* view);
+
+/***********************************************************************************************************************
+ * @brief Adds a square for some of the nodes, e.g. the ones under the mouse, drawn over the others.
+
+ * The nodes lose their blue component, the locked ones staying red. The squares are at least 4 pixels wide, so that the
+ * nodes stay visible when zoomed out.
+
+ * @param batch (Batch*): a pointer to the batch.
+ * @param nodes (const Nodes*): a pointer to the node store.
+ * @param indices (const int*): the nodes.
+ * @param count (int): the number of nodes.
+ * @param x (const float*): the x coordinates the nodes are drawn at, in the world.
+ * @param y (const float*): the y coordinates the nodes are drawn at, in the world.
+ * @param size (float): the size of the squares, in the world.
+ * @param view (const View*): a pointer to the view.
+
+ * @return a char, non zero if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern char Batch_add_highlight(Batch* batch, const Nodes* nodes, const int* indices, int count, const float* x,
+		const float* y, float size, const View* view);
+
+/***********************************************************************************************************************
+ * @brief Adds the density of the nodes seen through a view, rather than the nodes themselves.
+
+ * The window is split into square cells, every node is counted in its cell, and every cell holding a node is drawn as
+ * one square, the brighter the more nodes it holds. The number of quads is thus bounded by the size of the window,
+ * whatever the number of nodes, which is how a scene too large to be drawn node by node is shown when zoomed out.
+
+ * @param batch (Batch*): a pointer to the batch.
+ * @param nodes (const Nodes*): a pointer to the node store.
+ * @param tiles (const BvhBox*): the bounding box of every tile of tile_size consecutive nodes, see Snapshot.
+ * @param tile_size (int): the number of nodes of every tile.
+ * @param x (const float*): the x coordinates the nodes are drawn at, in the world.
+ * @param y (const float*): the y coordinates the nodes are drawn at, in the world.
+ * @param cell (int): the size of the cells, in pixels.
+ * @param view (const View*): a pointer to the view.
+
+ * @return a char, non zero if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern char Batch_add_density(Batch* batch, const Nodes* nodes, const BvhBox* tiles, int tile_size, const float* x,
+		const float* y, int cell, const View* view);
+
+/***********************************************************************************************************************
+ * @brief Submits every quad of a batch to a renderer, with a single draw call, or rasterizes the shapes of the batch and
+ * copies the frame to the renderer.
+
+ * @param batch (Batch*): a pointer to the batch.
+ * @param renderer (SDL_Renderer*): the renderer to draw with.
+
+ * @return a char, non zero if the renderer failed.
+ **********************************************************************************************************************/
+extern char Batch_render(Batch* batch, SDL_Renderer* renderer);
+
+/***********************************************************************************************************************
+ * @brief Releases the memory held by a batch.
+
+ * @param batch (Batch*): a pointer to the batch, which is left empty and can be reused.
+ **********************************************************************************************************************/
+extern void Batch_free(Batch* batch);
+
+#endif
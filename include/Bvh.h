@@ -0,0 +1,150 @@
+#ifndef LIB_BVH_H
+#define LIB_BVH_H
+
+/** The largest height a tree can reach, the balancing keeping it around 1.44 log2 of the number of leaves. */
+#define BVH_MAX_HEIGHT 64
+
+/***********************************************************************************************************************
+ * @brief An axis aligned bounding box.
+ **********************************************************************************************************************/
+typedef struct BvhBox{
+	float min_x;
+	float min_y;
+	float max_x;
+	float max_y;
+} BvhBox;
+
+/***********************************************************************************************************************
+ * @brief A node of a tree, either a leaf holding a box given by the user, or an internal node with two children.
+ **********************************************************************************************************************/
+typedef struct BvhNode{
+	/** The box of the leaf, grown by the fattening, or the union of the boxes of the children. */
+	BvhBox box;
+	/** The parent of the node, -1 for the root, or the next free node for the nodes not in use. */
+	int parent;
+	/** The children of the node, -1 for a leaf. */
+	int left;
+	int right;
+	/** The height of the node, 0 for a leaf, -1 for the nodes not in use. */
+	int height;
+	/** The value given by the user for a leaf. */
+	int user;
+	/** This field tells whether a leaf is one of the leaves Bvh_find_pairs is looking for the pairs of. */
+	char listed;
+} BvhNode;
+
+/***********************************************************************************************************************
+ * @brief The Bvh structure
+
+ * This structure is a dynamic bounding volume hierarchy: a binary tree whose leaves hold boxes, every internal node
+ * bounding the boxes of its children, so that the leaves overlapping a box are found in O(log N) rather than O(N).
+ * The tree is updated incrementally: a leaf is inserted next to the sibling that grows the tree the least, and the
+ * boxes of its ancestors are refitted on the way back to the root, with rotations keeping the tree balanced.
+ * The leaves hold fat boxes, grown by a margin, so that a box moving a little stays inside its leaf and does not touch
+ * the tree at all. The pairs of overlapping leaves can be found at once, as the candidates of a finer test.
+ **********************************************************************************************************************/
+typedef struct Bvh{
+	/** The nodes of the tree, leaves and internal nodes alike, the ones not in use being chained from free_list. */
+	BvhNode* nodes;
+	/** The number of nodes the array can hold. */
+	int capacity;
+	/** The root of the tree, -1 for an empty tree, and the first free node. */
+	int root;
+	int free_list;
+	/** The number of leaves. */
+	int nb_leaves;
+	/** The margin the boxes of the leaves are grown by. */
+	float fatten;
+
+	/** The pairs of leaves found by Bvh_find_pairs: the values of the two leaves of pair p are pairs[2p] and
+	 * pairs[2p+1]. */
+	int* pairs;
+	/** The number of pairs found, and the number of pairs the array can hold. */
+	int nb_pairs;
+	int pairs_capacity;
+} Bvh;
+
+/***********************************************************************************************************************
+ * @brief Gives a newly initialized, empty, tree.
+
+ * @param fatten (float): the margin the boxes of the leaves are grown by.
+
+ * @return the tree, nothing is allocated until the first leaf is inserted.
+ **********************************************************************************************************************/
+extern Bvh Bvh_init(float fatten);
+
+/***********************************************************************************************************************
+ * @brief Removes every leaf from a tree, keeping its memory.
+
+ * @param bvh (Bvh*): a pointer to the tree.
+ **********************************************************************************************************************/
+extern void Bvh_clear(Bvh* bvh);
+
+/***********************************************************************************************************************
+ * @brief Inserts a box into a tree.
+
+ * @param bvh (Bvh*): a pointer to the tree.
+ * @param box (BvhBox): the box, which the leaf holds grown by the fattening.
+ * @param user (int): a value given back with the leaf, e.g. the index of the body the box bounds.
+
+ * @return the leaf, or -1 if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern int Bvh_insert(Bvh* bvh, BvhBox box, int user);
+
+/***********************************************************************************************************************
+ * @brief Removes a leaf from a tree.
+
+ * @param bvh (Bvh*): a pointer to the tree.
+ * @param leaf (int): the leaf, as given by Bvh_insert.
+ **********************************************************************************************************************/
+extern void Bvh_remove(Bvh* bvh, int leaf);
+
+/***********************************************************************************************************************
+ * @brief Updates the box of a leaf.
+
+ * Nothing is done as long as the box stays inside the fat box of the leaf. Otherwise the leaf is taken out of the tree
+ * and inserted again with the new box grown by the fattening, refitting the boxes of its ancestors on the way. The leaf
+ * keeps its index, and no memory is allocated.
+
+ * @param bvh (Bvh*): a pointer to the tree.
+ * @param leaf (int): the leaf, as given by Bvh_insert.
+ * @param box (BvhBox): the new box.
+
+ * @return a char, non zero if the leaf had to be moved in the tree.
+ **********************************************************************************************************************/
+extern char Bvh_move(Bvh* bvh, int leaf, BvhBox box);
+
+/***********************************************************************************************************************
+ * @brief Finds the leaves whose fat boxes overlap a box.
+
+ * @param bvh (const Bvh*): a pointer to the tree.
+ * @param box (BvhBox): the box.
+ * @param found (int*): an array receiving the values of the leaves found.
+ * @param max_found (int): the size of the array.
+
+ * @return the number of leaves found, which may be larger than max_found if the array is too small.
+ **********************************************************************************************************************/
+extern int Bvh_query(const Bvh* bvh, BvhBox box, int* found, int max_found);
+
+/***********************************************************************************************************************
+ * @brief Finds the pairs of leaves whose fat boxes overlap, each pair once, into the pairs of the tree.
+
+ * Only the pairs with at least one of the given leaves are found, so that the leaves that did not move, e.g. bodies at
+ * rest, cost nothing unless something comes close to them.
+
+ * @param bvh (Bvh*): a pointer to the tree.
+ * @param leaves (const int*): the leaves to find the pairs of, NULL for every leaf.
+ * @param nb_leaves (int): the number of leaves given.
+
+ * @return a char, non zero if the memory could not be allocated, in which case the pairs are incomplete.
+ **********************************************************************************************************************/
+extern char Bvh_find_pairs(Bvh* bvh, const int* leaves, int nb_leaves);
+
+/***********************************************************************************************************************
+ * @brief Releases the memory held by a tree.
+
+ * @param bvh (Bvh*): a pointer to the tree.
+ **********************************************************************************************************************/
+extern void Bvh_free(Bvh* bvh);
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef LIB_EXPORTER_H
+#define LIB_EXPORTER_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+/***********************************************************************************************************************
+ * @brief The function writing a frame to a file.
+
+ * The frame is given as rows of 0xAARRGGBB pixels. The function is called from the encoder threads, several at once,
+ * so it must not rely on any shared state.
+
+ * @return a char, non zero if the file could not be written.
+ **********************************************************************************************************************/
+typedef char (*ExporterWriter)(const char* path, const uint32_t* pixels, int width, int height);
+
+/***********************************************************************************************************************
+ * @brief The Exporter structure
+
+ * This structure writes the frames of a run to numbered files on background encoder threads, so that the frames can be
+ * rendered and saved without a display and without slowing the simulation down.
+ * The exporter owns a fixed number of frame buffers. The renderer takes a free one, draws into it and submits it; the
+ * encoders take the submitted frames in order, write them, and give the buffers back. When every buffer is still
+ * waiting for an encoder, i.e. when the disk cannot keep up, taking a buffer fails at once rather than waiting: the
+ * frame is dropped and counted, so that the backpressure is visible instead of stalling the caller.
+ **********************************************************************************************************************/
+typedef struct Exporter{
+	/** The pixels of every frame buffer, one after the other, and the size of a frame. */
+	uint32_t* pixels;
+	int width;
+	int height;
+	/** The number of frame buffers. */
+	int capacity;
+	/** The number given to the file of every frame buffer. */
+	uint64_t* numbers;
+
+	/** The free buffers, as a stack. */
+	int* free_slots;
+	int nb_free;
+	/** The submitted buffers, as a ring starting at head. */
+	int* queue;
+	int head;
+	int nb_queued;
+	/** The lock of the stack and of the ring, and the condition the encoders wait on for a submitted frame. */
+	pthread_mutex_t lock;
+	pthread_cond_t submitted;
+
+	/** The encoder threads. */
+	pthread_t* threads;
+	int nb_threads;
+	/** This field tells the encoders to exit once the ring is empty. */
+	char stop;
+
+	/** The printf pattern of the files, given the number of a frame as an unsigned long long, e.g. "out/%06llu.ppm". */
+	const char* pattern;
+	/** The function writing the files. */
+	ExporterWriter writer;
+
+	/** The number of frames written, of frames dropped because no buffer was free, and of files that failed. */
+	atomic_ullong written;
+	atomic_ullong dropped;
+	atomic_ullong failed;
+} Exporter;
+
+/***********************************************************************************************************************
+ * @brief Writes a frame as a binary PPM file.
+
+ * @param path (const char*): the path of the file.
+ * @param pixels (const uint32_t*): the rows of 0xAARRGGBB pixels, the alpha being left out.
+ * @param width (int): the width of the frame.
+ * @param height (int): the height of the frame.
+
+ * @return a char, non zero if the file could not be written.
+ **********************************************************************************************************************/
+extern char Exporter_write_ppm(const char* path, const uint32_t* pixels, int width, int height);
+
+/***********************************************************************************************************************
+ * @brief Allocates the frame buffers of an exporter and starts its encoder threads.
+
+ * @param exporter (Exporter*): a pointer to the exporter to be started.
+ * @param pattern (const char*): the printf pattern of the files, given the number of a frame as an unsigned long long,
+ * which must hold exactly one conversion such as %06llu, and no other % than %%.
+ * @param writer (ExporterWriter): the function writing the files, NULL for Exporter_write_ppm.
+ * @param width (int): the width of the frames.
+ * @param height (int): the height of the frames.
+ * @param nb_frames (int): the number of frame buffers, i.e. the number of frames that can wait for the encoders.
+ * @param nb_threads (int): the number of encoder threads.
+
+ * @return a char, non zero if the pattern is not valid, the memory could not be allocated or the threads could not be
+ * created.
+ **********************************************************************************************************************/
+extern char Exporter_start(Exporter* exporter, const char* pattern, ExporterWriter writer, int width, int height,
+		int nb_frames, int nb_threads);
+
+/***********************************************************************************************************************
+ * @brief Takes a free frame buffer, without ever waiting.
+
+ * @param exporter (Exporter*): a pointer to the exporter.
+
+ * @return the buffer, whose pixels are exporter->pixels + buffer*width*height, or -1 if none is free, in which case
+ * the frame is counted as dropped.
+ **********************************************************************************************************************/
+extern int Exporter_acquire(Exporter* exporter);
+
+/***********************************************************************************************************************
+ * @brief Gives a frame buffer drawn into to the encoders.
+
+ * @param exporter (Exporter*): a pointer to the exporter.
+ * @param buffer (int): the buffer, as given by Exporter_acquire.
+ * @param number (uint64_t): the number of the frame, given to the pattern of the file.
+ **********************************************************************************************************************/
+extern void Exporter_submit(Exporter* exporter, int buffer, uint64_t number);
+
+/***********************************************************************************************************************
+ * @brief Waits for the frames submitted to be written, stops the encoder threads and releases the buffers.
+
+ * @param exporter (Exporter*): a pointer to the exporter, whose counters are kept.
+ **********************************************************************************************************************/
+extern void Exporter_stop(Exporter* exporter);
+
+#endif
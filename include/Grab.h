@@ -0,0 +1,96 @@
+#ifndef LIB_GRAB_H
+#define LIB_GRAB_H
+
+#include "Nodes.h"
+#include "Grid.h"
+
+/***********************************************************************************************************************
+ * @brief The Grab structure
+
+ * This structure holds the nodes picked by the user, either the node closest to a point or every node of a brush
+ * around it, and pulls them towards a target moving with the mouse. Every node is pulled by a damped spring towards the
+ * target plus the offset it was picked at, so that a brush keeps its shape, and the forces are added during the steps,
+ * so that the bodies react to the drag with the same solver as to anything else.
+ **********************************************************************************************************************/
+typedef struct Grab{
+	/** The nodes held, none when nothing is grabbed. */
+	int* nodes;
+	/** The offset of every node held from the target, as of when it was picked. */
+	float* offset_x;
+	float* offset_y;
+	/** The number of nodes held, and the number of nodes the arrays can hold. */
+	int count;
+	int capacity;
+	/** The point the nodes are pulled towards. */
+	float x;
+	float y;
+} Grab;
+
+/***********************************************************************************************************************
+ * @brief Gives a newly initialized grab, holding nothing.
+
+ * @return the grab, nothing is allocated until nodes are picked.
+ **********************************************************************************************************************/
+extern Grab Grab_init();
+
+/***********************************************************************************************************************
+ * @brief Picks the nodes to be held, replacing the ones held before.
+
+ * The nodes are sorted into a grid whose cells are twice as large as the radius, then the closest node or the nodes of
+ * the brush are found in the 2 x 2 cells around the point, see Grid_nearest and Grid_query.
+
+ * @param grab (Grab*): a pointer to the grab.
+ * @param grid (Grid*): a pointer to the grid the nodes are sorted into, e.g. the grid of the contacts, whose cell size
+ * is changed.
+ * @param nodes (const Nodes*): a pointer to the node store.
+ * @param x (float): the x coordinate of the point picked, which becomes the target.
+ * @param y (float): the y coordinate of the point picked.
+ * @param radius (float): the distance within which the nodes are picked.
+ * @param brush (char): whether every node within the radius is picked, or only the closest one.
+
+ * @return a char, non zero if the memory could not be allocated, in which case nothing is held.
+ **********************************************************************************************************************/
+extern char Grab_pick(Grab* grab, Grid* grid, const Nodes* nodes, float x, float y, float radius, char brush);
+
+/***********************************************************************************************************************
+ * @brief Moves the target the nodes held are pulled towards.
+
+ * @param grab (Grab*): a pointer to the grab.
+ * @param x (float): the x coordinate of the target.
+ * @param y (float): the y coordinate of the target.
+ **********************************************************************************************************************/
+extern void Grab_move(Grab* grab, float x, float y);
+
+/***********************************************************************************************************************
+ * @brief Lets go of the nodes held.
+
+ * @param grab (Grab*): a pointer to the grab.
+ **********************************************************************************************************************/
+extern void Grab_release(Grab* grab);
+
+/***********************************************************************************************************************
+ * @brief Adds the forces pulling the nodes held towards the target to the accelerations of the nodes.
+
+ * @param grab (const Grab*): a pointer to the grab.
+ * @param nodes (Nodes*): a pointer to the node store, the locked nodes being left where they are.
+ * @param K (float): the stiffness of the springs pulling the nodes.
+ * @param Kd (float): the damping of the nodes held, relative to the target, which does not move during a step.
+ **********************************************************************************************************************/
+extern void Grab_apply(const Grab* grab, Nodes* nodes, float K, float Kd);
+
+/***********************************************************************************************************************
+ * @brief Renumbers the nodes held after nodes were moved around in the store.
+
+ * @param grab (Grab*): a pointer to the grab.
+ * @param map (const int*): the new index of every node, -1 for the removed ones, which are let go of.
+ **********************************************************************************************************************/
+extern void Grab_remap(Grab* grab, const int* map);
+
+/***********************************************************************************************************************
+ * @brief Releases the memory held by a grab.
+
+ * @param grab (Grab*): a pointer to the grab.
+ **********************************************************************************************************************/
+extern void Grab_free(Grab* grab);
+
+#endif
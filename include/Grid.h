@@ -0,0 +1,121 @@
+#ifndef LIB_GRID_H
+#define LIB_GRID_H
+
+#include <stdint.h>
+#include <math.h>
+
+/***********************************************************************************************************************
+ * @brief The Grid structure
+
+ * This structure is a uniform grid over the plane, used to find the nodes close to a point without testing every node.
+ * The plane is split into square cells, and the cells are hashed into a table of buckets so that the grid needs no
+ * bounds. The grid is rebuilt from scratch with a counting sort of the nodes over their bucket, in O(N).
+ * A query for the nodes closer than half the size of a cell only looks at the 2 x 2 cells around the point, so it costs
+ * O(1) as long as the nodes are not piled up.
+ **********************************************************************************************************************/
+typedef struct Grid{
+	/** The size of a cell, twice the largest radius a query can use. */
+	float cell_size;
+	/** The number of buckets, always a power of two. */
+	int nb_buckets;
+	/** The nodes of bucket h are sorted[bucket_start[h]] to sorted[bucket_start[h+1]-1]. */
+	int* bucket_start;
+	/** The nodes, sorted by bucket. */
+	int* sorted;
+	/** The positions of the nodes, in the same order, so that the nodes of a bucket are tested without jumping around
+	 * in memory. */
+	float* sorted_x;
+	float* sorted_y;
+	/** The bucket of every node, -1 for the inactive ones. */
+	int* bucket_of;
+	/** The number of nodes the arrays can hold. */
+	int capacity;
+	/** The number of nodes the grid has been built for. */
+	int count;
+} Grid;
+
+/***********************************************************************************************************************
+ * @brief Gives a newly initialized, empty, grid.
+
+ * @param cell_size (float): the size of a cell.
+
+ * @return the grid, nothing is allocated until it is built.
+ **********************************************************************************************************************/
+extern Grid Grid_init(float cell_size);
+
+/***********************************************************************************************************************
+ * @brief Sorts a set of points into the grid.
+
+ * @param grid (Grid*): a pointer to the grid.
+ * @param x (const float*): the x coordinates of the points.
+ * @param y (const float*): the y coordinates of the points.
+ * @param active (const uint32_t*): a bitmask telling which points to put in the grid, NULL to put all of them.
+ * @param count (int): the number of points.
+
+ * @return a char, non zero if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern char Grid_build(Grid* grid, const float* x, const float* y, const uint32_t* active, int count);
+
+/***********************************************************************************************************************
+ * @brief Gives the cell a coordinate falls in.
+ **********************************************************************************************************************/
+static inline int Grid_cell(const Grid* grid, float coordinate){
+	return (int)floorf(coordinate / grid->cell_size);
+}
+
+/***********************************************************************************************************************
+ * @brief Gives the bucket a cell is hashed into.
+ **********************************************************************************************************************/
+static inline int Grid_bucket(const Grid* grid, int cx, int cy){
+	return (int)(((uint32_t)cx * 73856093u) ^ ((uint32_t)cy * 19349663u)) & (grid->nb_buckets - 1);
+}
+
+/***********************************************************************************************************************
+ * @brief Gives the distinct buckets of the 2 x 2 cells around a point.
+
+ * These are the cells a disc around the point overlaps, as long as its radius is no larger than half a cell. Two
+ * neighbouring cells may be hashed into the same bucket, which is then only given once, so that no node is found twice.
+
+ * @param grid (const Grid*): a pointer to the grid.
+ * @param x (float): the x coordinate of the point.
+ * @param y (float): the y coordinate of the point.
+ * @param buckets (int*): an array of 4 integers receiving the buckets.
+
+ * @return the number of distinct buckets.
+ **********************************************************************************************************************/
+extern int Grid_neighbourhood(const Grid* grid, float x, float y, int* buckets);
+
+/***********************************************************************************************************************
+ * @brief Finds the points closer to a given point than a radius.
+
+ * @param grid (const Grid*): a pointer to the grid, which holds the positions of the points it was built from.
+ * @param px (float): the x coordinate of the point.
+ * @param py (float): the y coordinate of the point.
+ * @param radius (float): the radius, no larger than half the size of a cell.
+ * @param found (int*): an array receiving the indices of the points found.
+ * @param max_found (int): the size of the array.
+
+ * @return the number of points found, which may be larger than max_found if the array is too small.
+ **********************************************************************************************************************/
+extern int Grid_query(const Grid* grid, float px, float py, float radius, int* found, int max_found);
+
+/***********************************************************************************************************************
+ * @brief Finds the point closest to a given point, within a radius.
+
+ * @param grid (const Grid*): a pointer to the grid, which holds the positions of the points it was built from.
+ * @param px (float): the x coordinate of the point.
+ * @param py (float): the y coordinate of the point.
+ * @param radius (float): the radius, no larger than half the size of a cell.
+
+ * @return the index of the closest point, or -1 if no point is closer than the radius.
+ **********************************************************************************************************************/
+extern int Grid_nearest(const Grid* grid, float px, float py, float radius);
+
+/***********************************************************************************************************************
+ * @brief Releases the memory held by a grid.
+
+ * @param grid (Grid*): a pointer to the grid.
+ **********************************************************************************************************************/
+extern void Grid_free(Grid* grid);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef LIB_HISTOGRAM_H
+#define LIB_HISTOGRAM_H
+
+#include <stdint.h>
+
+/** The number of buckets per power of two, as a power of two, i.e. 64 buckets and a relative precision of 1/64. */
+#define HISTOGRAM_PRECISION_BITS 6
+#define HISTOGRAM_SUB_BUCKETS    (1 << HISTOGRAM_PRECISION_BITS)
+/** The number of bits of the largest value recorded, the larger values being clamped to it. */
+#define HISTOGRAM_RANGE_BITS     32
+#define HISTOGRAM_BUCKETS        ((HISTOGRAM_RANGE_BITS - HISTOGRAM_PRECISION_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+/***********************************************************************************************************************
+ * @brief The Histogram structure
+
+ * This structure counts integer values, e.g. durations in microseconds, in the manner of an HDR histogram: the values
+ * below 2*HISTOGRAM_SUB_BUCKETS have a bucket each, and every power of two above is split into HISTOGRAM_SUB_BUCKETS
+ * buckets of equal width. Every value is thus known to a fixed relative precision, whatever its magnitude, with a fixed
+ * amount of memory and no allocation, and any percentile can be read back from it.
+ **********************************************************************************************************************/
+typedef struct Histogram{
+	/** The number of values recorded in every bucket. */
+	uint32_t counts[HISTOGRAM_BUCKETS];
+	/** The number of values recorded. */
+	uint64_t count;
+	/** The smallest and the largest values recorded, exactly. */
+	uint64_t min;
+	uint64_t max;
+} Histogram;
+
+/***********************************************************************************************************************
+ * @brief Empties a histogram.
+
+ * @param histogram (Histogram*): a pointer to the histogram.
+ **********************************************************************************************************************/
+extern void Histogram_clear(Histogram* histogram);
+
+/***********************************************************************************************************************
+ * @brief Records a value.
+
+ * @param histogram (Histogram*): a pointer to the histogram.
+ * @param value (uint64_t): the value, clamped to 2^HISTOGRAM_RANGE_BITS - 1.
+ **********************************************************************************************************************/
+extern void Histogram_record(Histogram* histogram, uint64_t value);
+
+/***********************************************************************************************************************
+ * @brief Gives the value below which a given fraction of the recorded values are.
+
+ * @param histogram (const Histogram*): a pointer to the histogram.
+ * @param percentile (double): the percentile, between 0 and 100.
+
+ * @return the middle of the bucket holding the percentile, within the smallest and the largest values recorded, 0 if
+ * the histogram is empty.
+ **********************************************************************************************************************/
+extern uint64_t Histogram_percentile(const Histogram* histogram, double percentile);
+
+#endif
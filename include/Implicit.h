@@ -0,0 +1,98 @@
+#ifndef LIB_IMPLICIT_H
+#define LIB_IMPLICIT_H
+
+#include "Nodes.h"
+#include "Springs.h"
+
+/***********************************************************************************************************************
+ * @brief The Implicit structure
+
+ * This structure holds the memory used by the backward Euler integrator. Instead of moving the nodes with the forces at
+ * the start of the step, the velocity change dv is taken such that the step ends in equilibrium with the forces at its
+ * end, linearized around the current state:
+ *     (I - dt * df/dv - dt^2 * df/dx) dv = dt * (f + dt * df/dx v)
+ * The system is solved with a conjugate gradient preconditioned by its diagonal. The matrix is never built: its
+ * products with a vector are computed by walking the springs, in O(N + E). The spring stiffness across the spring is
+ * clamped to zero for compressed springs, which keeps the matrix positive definite so that the gradient converges.
+ * The locked nodes are filtered out of the system, so that their velocity does not change.
+ * The masses of the nodes are all 1, as in the explicit integrator, and the contacts stay explicit.
+ **********************************************************************************************************************/
+typedef struct Implicit{
+	/** The velocity change being solved for. */
+	float* dvx;
+	float* dvy;
+	/** The residual of the system. */
+	float* rx;
+	float* ry;
+	/** The preconditioned residual. */
+	float* zx;
+	float* zy;
+	/** The search direction. */
+	float* px;
+	float* py;
+	/** The product of the matrix with the search direction. */
+	float* qx;
+	float* qy;
+	/** The inverse of the diagonal of the matrix, 0 for the nodes filtered out. */
+	float* inv_x;
+	float* inv_y;
+	/** 1 for the nodes free to move, 0 for the others. */
+	float* free;
+	/** The number of nodes the arrays can hold. */
+	int capacity;
+
+	/** The direction of every spring, from its second node to its first one, 0 if both ends are at the same place. */
+	float* nx;
+	float* ny;
+	/** The stiffness of every spring across its direction, already multiplied by dt^2. */
+	float* across;
+	/** The stiffness of every spring along its direction, multiplied by dt^2, and the same plus its damping multiplied
+	 * by dt, i.e. the coefficients along the spring of the stiffness part and of the whole matrix. */
+	float* stiffness;
+	float* along;
+	/** The number of springs the arrays can hold. */
+	int spring_capacity;
+
+	/** The number of iterations of the last solve. */
+	int iterations;
+	/** The relative residual at the end of the last solve. */
+	float residual;
+} Implicit;
+
+/***********************************************************************************************************************
+ * @brief Gives a newly initialized implicit integrator.
+
+ * @return the integrator, nothing is allocated until the first solve.
+ **********************************************************************************************************************/
+extern Implicit Implicit_init();
+
+/***********************************************************************************************************************
+ * @brief Solves for the velocity change of a backward Euler step.
+
+ * The forces of the step must have been accumulated onto the accelerations of the nodes beforehand, together with the
+ * lengths of the springs, see Simulation_compute_forces. The accelerations are replaced by dv / dt, so that the
+ * explicit integration kernel then applies the velocity change and moves the nodes.
+
+ * @param implicit (Implicit*): a pointer to the integrator.
+ * @param nodes (Nodes*): a pointer to the node store.
+ * @param springs (const Springs*): a pointer to the list of springs.
+ * @param dt (float): the time step, in seconds.
+ * @param K (float): the stiffness of the springs, unless they have materials of their own.
+ * @param Kd (float): the damping of the springs, unless they have materials of their own.
+ * @param L0 (float): the rest length of the springs, unless they have materials of their own.
+ * @param max_iterations (int): the maximum number of conjugate gradient iterations.
+ * @param tolerance (float): the residual, relative to the right hand side, below which the gradient stops.
+
+ * @return a char, non zero if the memory could not be allocated, in which case the accelerations are left untouched.
+ **********************************************************************************************************************/
+extern char Implicit_solve(Implicit* implicit, Nodes* nodes, const Springs* springs, float dt, float K, float Kd,
+		float L0, int max_iterations, float tolerance);
+
+/***********************************************************************************************************************
+ * @brief Releases the memory held by an implicit integrator.
+
+ * @param implicit (Implicit*): a pointer to the integrator.
+ **********************************************************************************************************************/
+extern void Implicit_free(Implicit* implicit);
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef LIB_ISLANDS_H
+#define LIB_ISLANDS_H
+
+#include "Nodes.h"
+#include "Springs.h"
+#include "Bvh.h"
+
+/***********************************************************************************************************************
+ * @brief The Islands structure
+
+ * This structure splits the nodes into islands, i.e. the sets of nodes linked together by springs, found as the
+ * connected components of the springs. Every island keeps its bounding box, and falls asleep once the mean kinetic
+ * energy of its nodes has stayed low for a while: its nodes stop moving and are left out of the steps until an awake
+ * island comes close to it.
+ * The nodes and the springs of the awake islands are kept before the sleeping ones, so that the steps only have to
+ * process the first awake_nodes nodes and awake_springs springs, with the same kernels. They are only reordered when
+ * an island falls asleep or wakes up, which is rare.
+ * The bounding boxes of the islands are kept in a dynamic tree, which gives the pairs of islands close to each other
+ * at every step in O(I log I) rather than by testing the I^2 pairs.
+ **********************************************************************************************************************/
+typedef struct Islands{
+	/** The island of every node. */
+	int* island;
+	/** The order the nodes are sorted into, and the new index of every node, while the nodes are reordered. */
+	int* order;
+	int* rank;
+	/** The number of nodes the arrays above can hold. */
+	int capacity;
+
+	/** The bounding box of every island, as of the last step it was awake. */
+	float* min_x;
+	float* min_y;
+	float* max_x;
+	float* max_y;
+	/** The number of nodes of every island. */
+	int* size;
+	/** The mean kinetic energy of the nodes of every island during the last step. */
+	float* energy;
+	/** The number of steps every island has been still for. */
+	int* still;
+	/** This field tells whether every island is asleep. */
+	char* asleep;
+	/** The leaf of the tree holding the box of every island, -1 until the island has been measured. */
+	int* leaf;
+	/** The number of islands. */
+	int count;
+	/** The number of islands the arrays above can hold. */
+	int island_capacity;
+	/** The tree of the bounding boxes, grown by half the margin given to Islands_update, whose pairs are the islands
+	 * that may be closer than the margin, one of them at least being awake, as of the last update. */
+	Bvh tree;
+
+	/** The numbers of nodes and springs the islands were found for, they are found again when these change. */
+	int nb_nodes;
+	int nb_springs;
+	/** The number of nodes, and of springs, of the awake islands, which come first. */
+	int awake_nodes;
+	int awake_springs;
+	/** This field tells whether the islands match the nodes and the springs. */
+	char valid;
+	/** The number of times the nodes were reordered, so that the arrays kept by node elsewhere can tell they are out of
+	 * date. */
+	int arranged;
+} Islands;
+
+/***********************************************************************************************************************
+ * @brief Gives a newly initialized set of islands.
+
+ * @return the islands, invalid until they are built.
+ **********************************************************************************************************************/
+extern Islands Islands_init();
+
+/***********************************************************************************************************************
+ * @brief Finds the islands of the nodes, with a union-find over the springs in O(N + E), every island being awake.
+
+ * @param islands (Islands*): a pointer to the islands.
+ * @param nodes (const Nodes*): a pointer to the node store.
+ * @param springs (const Springs*): a pointer to the list of springs.
+
+ * @return a char, non zero if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern char Islands_build(Islands* islands, const Nodes* nodes, const Springs* springs);
+
+/***********************************************************************************************************************
+ * @brief Updates the islands after a step, putting the still ones to sleep and waking the sleeping ones approached.
+
+ * The kinetic energy and the bounding box of the awake islands are measured. An island whose nodes had a mean kinetic
+ * energy below a threshold for a number of steps falls asleep, its velocities are zeroed. A sleeping island wakes up
+ * when the bounding box of a moving island, grown by a margin, overlaps its own, the candidate pairs being given by the
+ * tree of the bounding boxes. When an island changes state, the
+ * nodes and the springs are reordered, so that the awake ones come first again, and the colors of the springs are
+ * invalidated.
+
+ * @param islands (Islands*): a pointer to the islands.
+ * @param nodes (Nodes*): a pointer to the node store.
+ * @param springs (Springs*): a pointer to the list of springs.
+ * @param energy (float): the mean kinetic energy of the nodes, i.e. v^2/2, below which an island is still.
+ * @param steps (int): the number of steps an island has to stay still for to fall asleep.
+ * @param margin (float): the distance at which an awake island wakes up a sleeping one.
+
+ * @return a char, non zero if the memory could not be allocated, in which case every island is woken up.
+ **********************************************************************************************************************/
+extern char Islands_update(Islands* islands, Nodes* nodes, Springs* springs, float energy, int steps, float margin);
+
+/***********************************************************************************************************************
+ * @brief Releases the memory held by a set of islands.
+
+ * @param islands (Islands*): a pointer to the islands.
+ **********************************************************************************************************************/
+extern void Islands_free(Islands* islands);
+
+#endif
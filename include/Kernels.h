@@ -0,0 +1,72 @@
+#ifndef LIB_KERNELS_H
+#define LIB_KERNELS_H
+
+#include "Nodes.h"
+#include "Springs.h"
+
+/***********************************************************************************************************************
+ * @brief The Kernels structure
+
+ * This structure gathers the functions doing the actual physics work on a node store. Several implementations exist,
+ * a portable scalar one and vectorized ones for the instruction sets of x86 processors, the best one the processor
+ * supports being picked at runtime.
+ * Every kernel works on a range [begin, end) of springs or nodes so that the work can be split between threads.
+ **********************************************************************************************************************/
+typedef struct Kernels{
+	/** The name of the instruction set used by the kernels, e.g. "avx2". */
+	const char* name;
+	/** The number of springs or nodes processed per instruction. */
+	int width;
+
+	/** Accumulates the forces of the springs in [begin, end) onto the accelerations of their ends, and stores the
+	 * lengths of the springs on the way. The ends of a spring of null length are pushed apart along x. */
+	void (*springs)(Nodes* nodes, Springs* springs, int begin, int end, float K, float Kd, float L0);
+	/** The same for springs with materials of their own, whose parameters are loaded spring by spring. The springs
+	 * sharing the parameters of the simulation go through the kernel above, which keeps them in registers. */
+	void (*springs_materials)(Nodes* nodes, Springs* springs, int begin, int end);
+	/** Integrates the unlocked nodes in [begin, end), bouncing them on the walls of a w x h box. */
+	void (*integrate)(Nodes* nodes, int begin, int end, float dt, float drag, float w, float h);
+} Kernels;
+
+/***********************************************************************************************************************
+ * @brief Resets the accelerations of the nodes in [begin, end) to a constant field, e.g. the gravity.
+
+ * @param nodes (Nodes*): a pointer to the node store.
+ * @param begin (int): the first node.
+ * @param end (int): one past the last node.
+ * @param gx (float): the x component of the field.
+ * @param gy (float): the y component of the field.
+ **********************************************************************************************************************/
+extern void Kernels_clear(Nodes* nodes, int begin, int end, float gx, float gy);
+
+/***********************************************************************************************************************
+ * @brief Gives the portable scalar kernels, available everywhere.
+
+ * @return the scalar kernels.
+ **********************************************************************************************************************/
+extern Kernels Kernels_scalar();
+
+/***********************************************************************************************************************
+ * @brief Gives the 4 wide SSE2 kernels, and the 8 wide AVX2 kernels.
+
+ * These functions only exist when compiling for an x86 processor, and must not be used unless the processor supports
+ * the matching instruction set, see Kernels_select.
+
+ * @return the vectorized kernels.
+ **********************************************************************************************************************/
+#if defined(__x86_64__) || defined(__i386__)
+extern Kernels Kernels_sse();
+extern Kernels Kernels_avx2();
+#endif
+
+/***********************************************************************************************************************
+ * @brief Picks the kernels matching the processor the program is running on.
+
+ * The processor is queried with CPUID, and the widest supported kernels are returned. The choice can be forced with the
+ * SOFT_BODY_KERNELS environment variable, set to "scalar", "sse" or "avx2".
+
+ * @return the kernels to be used.
+ **********************************************************************************************************************/
+extern Kernels Kernels_select();
+
+#endif
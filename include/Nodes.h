@@ -0,0 +1,191 @@
+#ifndef LIB_NODES_H
+#define LIB_NODES_H
+
+#include <stdint.h>
+
+/**
+ * @brief The alignment, in bytes, of every array of the node store, enough for the widest vector loads.
+ */
+#define NODES_ALIGNMENT 64
+/**
+ * @brief The number of nodes processed at once by the widest kernel, capacities are rounded up to a multiple of it.
+ */
+#define NODES_LANES 16
+
+/***********************************************************************************************************************
+ * @brief The Nodes structure
+
+ * This structure stores the nodes of a soft body as a structure of arrays: every field lives in its own aligned array,
+ * so that the kernels only load the fields they need and can process several nodes per instruction.
+ * The nodes are kept densely packed: the nodes are always the slots 0 to count-1, a new node is appended after them
+ * and a removed node is replaced by the last one. Adding and removing a node are therefore O(1), whatever the number of
+ * slots ever allocated, and the loops over the nodes never meet a hole.
+ * The flags are packed as bitmasks, node i being represented by bit (i % 32) of word (i / 32).
+ **********************************************************************************************************************/
+typedef struct Nodes{
+	/** The positions of the nodes. */
+	float* x;
+	float* y;
+	/** The velocities of the nodes. */
+	float* vx;
+	float* vy;
+	/** The accelerations of the nodes, accumulated during a step. */
+	float* ax;
+	float* ay;
+	/** The positions of the nodes before the last step, used to interpolate the rendered positions. */
+	float* px;
+	float* py;
+
+	/** A bitmask telling which nodes are locked, i.e. do not move. */
+	uint32_t* locked;
+
+	/** The number of nodes. */
+	int count;
+	/** The number of slots allocated, always a multiple of NODES_LANES. */
+	int capacity;
+	/** This field tells whether the positions and the locked mask belong to someone else, e.g. a mapped scene file,
+	 * in which case they are not released with the store. */
+	char borrowed;
+} Nodes;
+
+/***********************************************************************************************************************
+ * @brief Allocates an empty node store.
+
+ * @param nodes (Nodes*): a pointer to the store to be allocated.
+ * @param capacity (int): the number of nodes the store should be able to hold before it has to grow.
+
+ * @return a char, non zero if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern char Nodes_create(Nodes* nodes, int capacity);
+
+/***********************************************************************************************************************
+ * @brief Makes sure a node store can hold a given number of nodes without growing.
+
+ * The arrays are reallocated, so any pointer to them is invalidated. Borrowed arrays are copied into arrays of the
+ * store's own.
+
+ * @param nodes (Nodes*): a pointer to the store.
+ * @param capacity (int): the number of nodes the store should be able to hold.
+
+ * @return a char, non zero if the memory could not be allocated, in which case the store is left as it was.
+ **********************************************************************************************************************/
+extern char Nodes_reserve(Nodes* nodes, int capacity);
+
+/***********************************************************************************************************************
+ * @brief Creates a node store on top of existing positions and locked mask, which are used in place.
+
+ * The other fields are allocated, the nodes being at rest. The arrays must stay valid until the store is released or
+ * grows, and are not released with it.
+
+ * @param nodes (Nodes*): a pointer to the store to be created.
+ * @param x (float*): the x coordinates of the nodes, aligned to NODES_ALIGNMENT and holding a multiple of NODES_LANES
+ * floats.
+ * @param y (float*): the y coordinates of the nodes, with the same layout.
+ * @param locked (uint32_t*): the locked mask of the nodes, holding capacity/32 + 1 words.
+ * @param count (int): the number of nodes.
+ * @param capacity (int): the number of floats of x and y, a multiple of NODES_LANES.
+
+ * @return a char, non zero if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern char Nodes_wrap(Nodes* nodes, float* x, float* y, uint32_t* locked, int count, int capacity);
+
+/***********************************************************************************************************************
+ * @brief Puts an existing node at rest at a given place.
+
+ * @param nodes (Nodes*): a pointer to the store.
+ * @param i (int): the index of the node, lower than the number of nodes.
+ * @param x (float): the x coordinate of the node.
+ * @param y (float): the y coordinate of the node.
+ * @param locked (char): whether the node is locked or not.
+ **********************************************************************************************************************/
+extern void Nodes_set(Nodes* nodes, int i, float x, float y, char locked);
+
+/***********************************************************************************************************************
+ * @brief Adds a node at rest after the last one.
+
+ * The store grows geometrically when it is full, so adding a node is O(1) amortized.
+
+ * @param nodes (Nodes*): a pointer to the store.
+ * @param x (float): the x coordinate of the node.
+ * @param y (float): the y coordinate of the node.
+ * @param locked (char): whether the node is locked or not.
+
+ * @return the index of the new node, -1 if the store could not grow.
+ **********************************************************************************************************************/
+extern int Nodes_add(Nodes* nodes, float x, float y, char locked);
+
+/***********************************************************************************************************************
+ * @brief Removes a node, the last node taking its place.
+
+ * Whatever refers to the nodes by index, e.g. the springs, has to be told that the last node moved, see
+ * Simulation_remove_nodes which does it for the springs.
+
+ * @param nodes (Nodes*): a pointer to the store.
+ * @param i (int): the index of the node, lower than the number of nodes.
+
+ * @return the index the node now at index i had before, i.e. the former last index, i itself if the last node was
+ * removed.
+ **********************************************************************************************************************/
+extern int Nodes_remove(Nodes* nodes, int i);
+
+/***********************************************************************************************************************
+ * @brief Moves a node from one index to another, overwriting the node there.
+
+ * @param nodes (Nodes*): a pointer to the store.
+ * @param from (int): the index of the node to move.
+ * @param to (int): the index it is moved to.
+ **********************************************************************************************************************/
+extern void Nodes_move(Nodes* nodes, int from, int to);
+
+/***********************************************************************************************************************
+ * @brief Reorders the nodes.
+
+ * Whatever refers to the nodes by index, e.g. the springs, has to be renumbered, node order[k] becoming node k.
+
+ * @param nodes (Nodes*): a pointer to the store.
+ * @param order (const int*): the former index of every node, a permutation of the nodes.
+
+ * @return a char, non zero if the memory could not be allocated, in which case the store is left as it was.
+ **********************************************************************************************************************/
+extern char Nodes_permute(Nodes* nodes, const int* order);
+
+/***********************************************************************************************************************
+ * @brief Remembers the current positions of the nodes as the previous ones, before they are updated by a step.
+
+ * @param nodes (Nodes*): a pointer to the store.
+ **********************************************************************************************************************/
+extern void Nodes_save_positions(Nodes* nodes);
+
+/***********************************************************************************************************************
+ * @brief Interpolates the positions of the nodes between the previous and the current ones.
+
+ * @param nodes (const Nodes*): a pointer to the store.
+ * @param alpha (float): the interpolation factor, 0 giving the previous positions and 1 the current ones.
+ * @param x (float*): the array receiving the interpolated x coordinates, with room for every node.
+ * @param y (float*): the array receiving the interpolated y coordinates, with room for every node.
+ **********************************************************************************************************************/
+extern void Nodes_interpolate(const Nodes* nodes, float alpha, float* x, float* y);
+
+/***********************************************************************************************************************
+ * @brief Releases the memory held by a node store.
+
+ * @param nodes (Nodes*): a pointer to the store to be released.
+ **********************************************************************************************************************/
+extern void Nodes_free(Nodes* nodes);
+
+/***********************************************************************************************************************
+ * @brief Reads and writes the flags of a node.
+ **********************************************************************************************************************/
+static inline char Nodes_get_flag(const uint32_t* mask, int i){
+	return (mask[i >> 5] >> (i & 31)) & 1;
+}
+
+static inline void Nodes_set_flag(uint32_t* mask, int i, char value){
+	if (value){
+		mask[i >> 5] |= (uint32_t)1 << (i & 31);
+	} else {
+		mask[i >> 5] &= ~((uint32_t)1 << (i & 31));
+	}
+}
+
+#endif
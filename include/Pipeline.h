@@ -0,0 +1,223 @@
+#ifndef LIB_PIPELINE_H
+#define LIB_PIPELINE_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "Simulation.h"
+#include "Stepper.h"
+#include "Bvh.h"
+
+/** The bit of the shared slot index telling that it holds a state the reader has not seen yet. */
+#define PIPELINE_FRESH 4
+/** The number of consecutive nodes bounded by every tile of a snapshot. */
+#define PIPELINE_TILE 256
+/** The radius of the grabs until the renderer sets one, see Pipeline_set_pick_radius. */
+#define PIPELINE_PICK_RADIUS 20
+/** The time the simulation thread sleeps for while it waits for the renderer in lockstep, in nanoseconds. */
+#define PIPELINE_POLL 100000
+
+/***********************************************************************************************************************
+ * @brief A state of the simulation, as published for the renderer.
+
+ * Only the fields needed to draw the state are filled: the positions before and after the last step and the locked
+ * mask of the nodes, and the endpoints of the springs. They can thus be given as they are to Nodes_interpolate and to
+ * the Batch functions. The springs are only copied when their topology changed since the snapshot was last published,
+ * see Springs, so that a publication costs O(N) rather than O(N + E) while the springs stay as they are.
+ * The nodes are also split into tiles of PIPELINE_TILE consecutive nodes, whose bounding boxes are measured on the
+ * simulation thread, so that the renderer skips the tiles out of the view without looking at their nodes. The springs
+ * are sorted into bins by the tiles of their ends, a spring lying in the union of the boxes of its two tiles, so that
+ * the renderer skips the bins out of the view without looking at their springs either.
+ **********************************************************************************************************************/
+typedef struct Snapshot{
+	Nodes nodes;
+	Springs springs;
+	/** The bounding box of every tile, over both states of its nodes so that it holds them at any alpha. */
+	BvhBox* tiles;
+	/** The number of tiles, and the number of tiles the array can hold. */
+	int nb_tiles;
+	int tile_capacity;
+	/** The bins of the springs: the springs of bin k are the springs bin_offsets[k] to bin_offsets[k+1]-1, whose ends
+	 * are in the tiles bins[2k] and bins[2k+1]. They are sorted again along with the springs. */
+	int* bins;
+	int* bin_offsets;
+	/** The number of bins, and the number of bins the arrays can hold. */
+	int nb_bins;
+	int bin_capacity;
+	/** The nodes grabbed, the number of them and the number of them the array can hold. */
+	int* grabbed;
+	int nb_grabbed;
+	int grabbed_capacity;
+	/** The position between the two states the snapshot was published at, see Stepper. */
+	float alpha;
+	/** The time the snapshot was published at, in seconds, on the clock of Pipeline_now. */
+	double time;
+	/** The time spent stepping the simulation since the previous snapshot, in seconds. */
+	double physics;
+	/** The number of the snapshot, counting from 1, 0 for a snapshot not published yet. */
+	uint64_t sequence;
+} Snapshot;
+
+/***********************************************************************************************************************
+ * @brief The requests of the renderer to the simulation thread, applied before its next steps.
+ **********************************************************************************************************************/
+typedef struct PipelineInput{
+	/** This field tells whether nodes are to be grabbed, and whether the ones grabbed are to be released. */
+	char grab;
+	char release;
+	/** This field tells whether every node within the radius is to be grabbed, rather than the closest one. */
+	char brush;
+	/** This field tells whether the target moved since the last requests were applied. */
+	char moved;
+	/** The point the nodes are grabbed at, then the target they are pulled towards. */
+	float x;
+	float y;
+	/** The radius of the grabs. */
+	float radius;
+} PipelineInput;
+
+/***********************************************************************************************************************
+ * @brief The Pipeline structure
+
+ * This structure steps a simulation on a thread of its own, so that step N+1 is computed while step N is drawn. The
+ * thread follows the real time with a fixed step, see Stepper, and publishes the state reached after every batch of
+ * steps into a triple buffer: the simulation thread writes to its back snapshot, the renderer reads its front one,
+ * and the third is shared. Publishing and acquiring a snapshot both swap the index of the shared snapshot with a single
+ * atomic exchange, so that neither thread ever waits for the other, and the renderer always gets the latest state.
+ * In lockstep, the simulation thread rather waits for the renderer to take a snapshot before stepping past it, so that
+ * the renderer gets every state published, e.g. to export them all.
+ * The simulation must not be touched by any other thread while the pipeline runs.
+ **********************************************************************************************************************/
+typedef struct Pipeline{
+	/** The snapshots, indexed by the back, shared and front indices. */
+	Snapshot snapshots[3];
+	/** The index of the shared snapshot, ored with PIPELINE_FRESH when it was published after the last acquisition. */
+	atomic_int shared;
+	/** The snapshot written by the simulation thread. */
+	int back;
+	/** The snapshot read by the renderer. */
+	int front;
+
+	/** The simulation, stepped by the thread. */
+	Simulation* sim;
+	Stepper stepper;
+	pthread_t thread;
+	/** This field tells whether the simulation advances, it is paused otherwise. */
+	atomic_int running;
+	/** This field tells whether the simulation waits for every snapshot to be acquired before stepping further. */
+	atomic_int lockstep;
+	/** This field tells the thread to exit. */
+	atomic_int stop;
+	/** This field is set by the thread when a snapshot could not be allocated, in which case it stops publishing. */
+	atomic_int failed;
+	/** The number of snapshots published. */
+	uint64_t sequence;
+	/** The requests of the renderer, written by both threads under the lock. */
+	PipelineInput input;
+	pthread_mutex_t input_lock;
+	/** The memory the springs are sorted into bins with, and the number of ints it can hold. */
+	int* scratch;
+	int scratch_capacity;
+} Pipeline;
+
+/***********************************************************************************************************************
+ * @brief Gives the time of the clock the snapshots are stamped with.
+
+ * @return the time, in seconds, from an arbitrary origin.
+ **********************************************************************************************************************/
+extern double Pipeline_now();
+
+/***********************************************************************************************************************
+ * @brief Publishes the current state of a simulation and starts stepping it on a thread of its own.
+
+ * @param pipeline (Pipeline*): a pointer to the pipeline to be started.
+ * @param sim (Simulation*): a pointer to the simulation, which belongs to the thread until the pipeline is stopped.
+ * @param dt (double): the fixed physics step, in seconds, which Simulation_advance splits further when the simulation
+ * is adaptive.
+ * @param max_steps (int): the maximum number of steps run at once when the physics is late.
+ * @param running (char): whether the simulation advances from the start, or is paused.
+
+ * @return a char, non zero if the first snapshot could not be allocated or the thread could not be created.
+ **********************************************************************************************************************/
+extern char Pipeline_start(Pipeline* pipeline, Simulation* sim, double dt, int max_steps, char running);
+
+/***********************************************************************************************************************
+ * @brief Pauses or resumes the simulation.
+
+ * @param pipeline (Pipeline*): a pointer to the pipeline.
+ * @param running (char): whether the simulation advances.
+ **********************************************************************************************************************/
+extern void Pipeline_set_running(Pipeline* pipeline, char running);
+
+/***********************************************************************************************************************
+ * @brief Has the simulation wait for the renderer to acquire every snapshot before stepping further, or not. The
+ * simulation still follows the real time, running up to the maximum number of steps at once after a wait.
+
+ * @param pipeline (Pipeline*): a pointer to the pipeline.
+ * @param lockstep (char): whether the simulation waits for the renderer.
+ **********************************************************************************************************************/
+extern void Pipeline_set_lockstep(Pipeline* pipeline, char lockstep);
+
+/***********************************************************************************************************************
+ * @brief Sets the radius of the grabs from now on.
+
+ * @param pipeline (Pipeline*): a pointer to the pipeline.
+ * @param radius (float): the radius, in the coordinates of the world.
+ **********************************************************************************************************************/
+extern void Pipeline_set_pick_radius(Pipeline* pipeline, float radius);
+
+/***********************************************************************************************************************
+ * @brief Has the simulation grab the node closest to a point, or every node around it, see Simulation_grab.
+
+ * @param pipeline (Pipeline*): a pointer to the pipeline.
+ * @param x (float): the x coordinate of the point.
+ * @param y (float): the y coordinate of the point.
+ * @param brush (char): whether every node within the radius set is grabbed, or only the closest one.
+ **********************************************************************************************************************/
+extern void Pipeline_grab(Pipeline* pipeline, float x, float y, char brush);
+
+/***********************************************************************************************************************
+ * @brief Moves the target the nodes grabbed are pulled towards.
+
+ * @param pipeline (Pipeline*): a pointer to the pipeline.
+ * @param x (float): the x coordinate of the target.
+ * @param y (float): the y coordinate of the target.
+ **********************************************************************************************************************/
+extern void Pipeline_move_grab(Pipeline* pipeline, float x, float y);
+
+/***********************************************************************************************************************
+ * @brief Has the simulation let go of the nodes grabbed.
+
+ * @param pipeline (Pipeline*): a pointer to the pipeline.
+ **********************************************************************************************************************/
+extern void Pipeline_release(Pipeline* pipeline);
+
+/***********************************************************************************************************************
+ * @brief Gives the latest snapshot published, to be read by a single renderer thread.
+
+ * @param pipeline (Pipeline*): a pointer to the pipeline.
+
+ * @return a pointer to the snapshot, which is not written to until the next call.
+ **********************************************************************************************************************/
+extern const Snapshot* Pipeline_acquire(Pipeline* pipeline);
+
+/***********************************************************************************************************************
+ * @brief Gives the position between the two states of a snapshot the renderer should draw at a given time.
+
+ * @param snapshot (const Snapshot*): a pointer to the snapshot.
+ * @param dt (double): the fixed physics step, in seconds.
+ * @param now (double): the time of the frame, see Pipeline_now.
+
+ * @return the position, in [0, 1].
+ **********************************************************************************************************************/
+extern float Pipeline_alpha(const Snapshot* snapshot, double dt, double now);
+
+/***********************************************************************************************************************
+ * @brief Stops the simulation thread and releases the snapshots. The simulation can be used again afterwards.
+
+ * @param pipeline (Pipeline*): a pointer to the pipeline.
+ **********************************************************************************************************************/
+extern void Pipeline_stop(Pipeline* pipeline);
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef LIB_PROFILER_H
+#define LIB_PROFILER_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+/** The number of scopes kept per thread, a power of two. The oldest ones are overwritten once the ring is full. */
+#define PROFILER_RING_SIZE  (1 << 16)
+/** The deepest nesting of scopes, the scopes opened deeper are not recorded. */
+#define PROFILER_MAX_DEPTH  32
+/** The number of threads that can record scopes, the threads started past it are not recorded. */
+#define PROFILER_MAX_THREADS 64
+
+/***********************************************************************************************************************
+ * @brief The clock the profiler reads, giving a number of ticks from an arbitrary origin.
+ **********************************************************************************************************************/
+typedef uint64_t (*Profiler_clock)(void);
+
+/***********************************************************************************************************************
+ * @brief A scope closed by a thread, with the ticks of the clock at its start and at its end.
+ **********************************************************************************************************************/
+typedef struct ProfilerEvent{
+	/** The name of the scope, which must outlive the profiler, e.g. a string literal. */
+	const char* name;
+	uint64_t begin;
+	uint64_t end;
+} ProfilerEvent;
+
+/***********************************************************************************************************************
+ * @brief The ProfilerRing structure
+
+ * This structure holds the scopes recorded by a single thread. Only the thread owning the ring writes to it, so that
+ * recording a scope takes no lock and no atomic read-modify-write: the event is written first, and the head is then
+ * published with a release store. The nested scopes still open are kept on a small stack, their ends being matched
+ * with their starts in order.
+ **********************************************************************************************************************/
+typedef struct ProfilerRing{
+	/** The last scopes closed, the scope number n being at n % PROFILER_RING_SIZE. */
+	ProfilerEvent events[PROFILER_RING_SIZE];
+	/** The number of scopes closed since the ring was created. */
+	atomic_uint_fast64_t head;
+	/** The names and the starts of the scopes still open. */
+	const char* names[PROFILER_MAX_DEPTH];
+	uint64_t starts[PROFILER_MAX_DEPTH];
+	/** The number of scopes still open, including the ones too deep to be recorded. */
+	int depth;
+	/** The number of the thread in the trace, in the order the threads recorded their first scope. */
+	int thread;
+} ProfilerRing;
+
+/*
+ * The scopes are recorded through these macros, which compile to nothing unless SOFT_BODY_PROFILE is defined, so that
+ * the profiler costs nothing at all when it is compiled out. Every PROFILE_BEGIN must be matched by a PROFILE_END on
+ * the same thread.
+ */
+#ifdef SOFT_BODY_PROFILE
+#define PROFILE_BEGIN(name) Profiler_begin(name)
+#define PROFILE_END()       Profiler_end()
+#else
+#define PROFILE_BEGIN(name) ((void)0)
+#define PROFILE_END()       ((void)0)
+#endif
+
+/***********************************************************************************************************************
+ * @brief Sets the clock the scopes are timed with.
+
+ * The default clock is the monotonic clock of the system, in nanoseconds. It should be set before any scope is
+ * recorded, e.g. to SDL_GetPerformanceCounter with SDL_GetPerformanceFrequency.
+
+ * @param clock (Profiler_clock): the function giving the current number of ticks.
+ * @param frequency (uint64_t): the number of ticks per second.
+ **********************************************************************************************************************/
+extern void Profiler_set_clock(Profiler_clock clock, uint64_t frequency);
+
+/***********************************************************************************************************************
+ * @brief Opens a named scope on the calling thread, nested in the scopes it has already opened.
+
+ * The first scope opened by a thread allocates its ring, nothing is allocated afterwards.
+
+ * @param name (const char*): the name of the scope, which must outlive the profiler, e.g. a string literal.
+ **********************************************************************************************************************/
+extern void Profiler_begin(const char* name);
+
+/***********************************************************************************************************************
+ * @brief Closes the last scope opened by the calling thread and records it.
+ **********************************************************************************************************************/
+extern void Profiler_end();
+
+/***********************************************************************************************************************
+ * @brief Writes the scopes recorded by every thread as a Chrome trace, to be opened with chrome://tracing or Perfetto.
+
+ * The scopes are written as complete events, in microseconds from the earliest one. The threads should not record
+ * scopes during the dump, e.g. it is done between two frames or at the end of the program, otherwise the scopes being
+ * overwritten at the same time may come out garbled.
+
+ * @param path (const char*): the path of the JSON file to be written.
+
+ * @return a char, non zero if the file could not be written.
+ **********************************************************************************************************************/
+extern char Profiler_dump(const char* path);
+
+/***********************************************************************************************************************
+ * @brief Releases the rings of every thread, the threads must not record scopes anymore.
+ **********************************************************************************************************************/
+extern void Profiler_free();
+
+#endif
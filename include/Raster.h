@@ -0,0 +1,131 @@
+#ifndef LIB_RASTER_H
+#define LIB_RASTER_H
+
+#include <stdint.h>
+
+#include "ThreadPool.h"
+
+/** The size of the square tiles the framebuffer is split into, in pixels. */
+#define RASTER_TILE 64
+
+/***********************************************************************************************************************
+ * @brief A shape drawn by a rasterizer: the pixels closer than a radius to a segment, i.e. a line with round caps, or a
+ * disc when both ends of the segment are the same point.
+ **********************************************************************************************************************/
+typedef struct RasterShape{
+	/** The ends of the segment, in pixels. */
+	float x0;
+	float y0;
+	float x1;
+	float y1;
+	/** The radius of the shape, half the width of a line. */
+	float radius;
+	/** The color of the shape, as 0x00RRGGBB. */
+	uint32_t color;
+} RasterShape;
+
+/***********************************************************************************************************************
+ * @brief The Raster structure
+
+ * This structure is a software rasterizer: the shapes of a frame are gathered, then drawn into a framebuffer of
+ * 0xAARRGGBB pixels with antialiased edges, so that a frame can be uploaded as a single texture rather than drawn by the
+ * renderer, whose fallback paths are slow on hosts without a GPU.
+ * The framebuffer is split into tiles of RASTER_TILE pixels, and every shape is binned into the tiles its bounding box
+ * touches with a counting sort. The tiles are then drawn in parallel, every tile by a single thread and in the order the
+ * shapes were added, so that the result does not depend on the number of threads. The coverage of a row of pixels is
+ * computed 4 pixels at a time with SSE2 intrinsics, or by a scalar loop on hosts without SSE2.
+ **********************************************************************************************************************/
+typedef struct Raster{
+	/** The framebuffer, row after row, and its size in pixels. */
+	uint32_t* pixels;
+	int width;
+	int height;
+	/** The number of tiles along each axis. */
+	int columns;
+	int rows;
+	/** The color the framebuffer is cleared with. */
+	uint32_t background;
+
+	/** The shapes added since the last clear, the number of them and the number the array can hold. */
+	RasterShape* shapes;
+	int count;
+	int capacity;
+	/** The shapes of every tile, those of tile t being bins[offsets[t]] to bins[offsets[t+1]-1], and the number of
+	 * entries the bins can hold. */
+	int* offsets;
+	int* bins;
+	int bin_capacity;
+} Raster;
+
+/***********************************************************************************************************************
+ * @brief Gives a newly initialized, empty, rasterizer.
+
+ * @return the rasterizer, without a framebuffer until it is resized.
+ **********************************************************************************************************************/
+extern Raster Raster_init();
+
+/***********************************************************************************************************************
+ * @brief Allocates the framebuffer of a rasterizer.
+
+ * @param raster (Raster*): a pointer to the rasterizer.
+ * @param width (int): the width of the framebuffer, in pixels.
+ * @param height (int): the height of the framebuffer, in pixels.
+ * @param background (uint32_t): the color the framebuffer is cleared with, as 0xAARRGGBB.
+
+ * @return a char, non zero if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern char Raster_resize(Raster* raster, int width, int height, uint32_t background);
+
+/***********************************************************************************************************************
+ * @brief Removes every shape, without releasing the memory.
+
+ * @param raster (Raster*): a pointer to the rasterizer.
+ **********************************************************************************************************************/
+extern void Raster_clear(Raster* raster);
+
+/***********************************************************************************************************************
+ * @brief Adds a line with round caps.
+
+ * @param raster (Raster*): a pointer to the rasterizer.
+ * @param x0 (float): the x coordinate of the first end, in pixels.
+ * @param y0 (float): the y coordinate of the first end, in pixels.
+ * @param x1 (float): the x coordinate of the second end, in pixels.
+ * @param y1 (float): the y coordinate of the second end, in pixels.
+ * @param width (float): the width of the line, in pixels.
+ * @param color (uint32_t): the color of the line, as 0x00RRGGBB.
+
+ * @return a char, non zero if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern char Raster_line(Raster* raster, float x0, float y0, float x1, float y1, float width, uint32_t color);
+
+/***********************************************************************************************************************
+ * @brief Adds a disc.
+
+ * @param raster (Raster*): a pointer to the rasterizer.
+ * @param x (float): the x coordinate of the center, in pixels.
+ * @param y (float): the y coordinate of the center, in pixels.
+ * @param radius (float): the radius of the disc, in pixels.
+ * @param color (uint32_t): the color of the disc, as 0x00RRGGBB.
+
+ * @return a char, non zero if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern char Raster_disc(Raster* raster, float x, float y, float radius, uint32_t color);
+
+/***********************************************************************************************************************
+ * @brief Clears the framebuffer and draws every shape into it.
+
+ * @param raster (Raster*): a pointer to the rasterizer.
+ * @param pool (ThreadPool*): the threads the tiles are shared between, NULL to draw them on the calling thread.
+
+ * @return a char, non zero if the memory could not be allocated, in which case the framebuffer is only cleared.
+ **********************************************************************************************************************/
+extern char Raster_draw(Raster* raster, ThreadPool* pool);
+
+/***********************************************************************************************************************
+ * @brief Releases the memory held by a rasterizer.
+
+ * @param raster (Raster*): a pointer to the rasterizer, which is left empty and can be reused.
+ **********************************************************************************************************************/
+extern void Raster_free(Raster* raster);
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef LIB_SCENE_H
+#define LIB_SCENE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Simulation.h"
+
+/*######################################################################################################################
+## FILE FORMAT #########################################################################################################
+######################################################################################################################*/
+/** The first bytes of every scene file. */
+#define SCENE_MAGIC     "SOFTBODY"
+/** The version of the format, bumped whenever the layout changes. */
+#define SCENE_VERSION   1
+/** The alignment of every block in the file, enough for the vector loads of the kernels. */
+#define SCENE_ALIGNMENT NODES_ALIGNMENT
+
+/***********************************************************************************************************************
+ * @brief The SceneHeader structure
+
+ * This structure is the first thing of a scene file. It is followed by blocks laid out exactly as the engine stores
+ * them in memory, each one starting at a multiple of SCENE_ALIGNMENT bytes, so that a mapped file is used in place:
+ *  - the x then the y coordinates of the nodes, capacity floats each, capacity being the number of nodes rounded up to
+ *    a multiple of NODES_LANES,
+ *  - the locked mask of the nodes, capacity/32 + 1 words,
+ *  - the first then the second node of every spring, one int per spring.
+ * The file is written in the byte order of the machine, a file of the other byte order failing the version check.
+ **********************************************************************************************************************/
+typedef struct SceneHeader{
+	/** SCENE_MAGIC, without the final null character. */
+	char magic[8];
+	/** SCENE_VERSION. */
+	uint32_t version;
+	/** The size of this header, in bytes. */
+	uint32_t header_size;
+	/** The number of nodes and of springs. */
+	uint32_t nb_nodes;
+	uint32_t nb_springs;
+	/** The stiffness, the damping and the rest length of the springs, shared by every spring. */
+	float K;
+	float Kd;
+	float L0;
+	/** The size of the box the nodes bounce in. */
+	float width;
+	float height;
+	uint32_t reserved;
+	/** The offsets of the blocks, in bytes from the start of the file. */
+	uint64_t x;
+	uint64_t y;
+	uint64_t locked;
+	uint64_t a;
+	uint64_t b;
+} SceneHeader;
+
+/***********************************************************************************************************************
+ * @brief The Scene structure
+
+ * This structure is a scene file mapped in memory. The mapping is private: the simulation writes to the positions in
+ * place, each page being copied on its first write only, and the file itself is never modified.
+ **********************************************************************************************************************/
+typedef struct Scene{
+	/** The mapped file. */
+	void* data;
+	/** The size of the mapped file, in bytes. */
+	size_t size;
+	/** The header, at the start of the mapping. */
+	const SceneHeader* header;
+} Scene;
+
+/***********************************************************************************************************************
+ * @brief Maps a scene file in memory, and checks that it is a valid scene.
+
+ * Nothing is read but the header and the spring endpoints, checked to be valid nodes, so that opening a scene costs
+ * the page faults of the springs rather than parsing.
+
+ * @param scene (Scene*): a pointer to the scene to be opened.
+ * @param path (const char*): the path of the file.
+
+ * @return a char, non zero if the file could not be mapped or is not a valid scene.
+ **********************************************************************************************************************/
+extern char Scene_open(Scene* scene, const char* path);
+
+/***********************************************************************************************************************
+ * @brief Creates a simulation from a scene, the positions and the springs being used in place.
+
+ * The scene must stay open until the simulation is released.
+
+ * @param scene (const Scene*): a pointer to the opened scene.
+ * @param sim (Simulation*): a pointer to the simulation to be created.
+
+ * @return a char, non zero if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern char Scene_load(const Scene* scene, Simulation* sim);
+
+/***********************************************************************************************************************
+ * @brief Writes the current state of a simulation to a scene file.
+
+ * The format only holds the parameters shared by the springs, the materials of the springs are not written.
+
+ * @param sim (const Simulation*): a pointer to the simulation.
+ * @param path (const char*): the path of the file.
+
+ * @return a char, non zero if the file could not be written.
+ **********************************************************************************************************************/
+extern char Scene_save(const Simulation* sim, const char* path);
+
+/***********************************************************************************************************************
+ * @brief Unmaps a scene file.
+
+ * @param scene (Scene*): a pointer to the scene.
+ **********************************************************************************************************************/
+extern void Scene_close(Scene* scene);
+
+#endif
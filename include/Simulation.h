@@ -0,0 +1,369 @@
+#ifndef LIB_SIMULATION_H
+#define LIB_SIMULATION_H
+
+#include "Nodes.h"
+#include "Springs.h"
+#include "Kernels.h"
+#include "ThreadPool.h"
+#include "Grid.h"
+#include "Implicit.h"
+#include "Xpbd.h"
+#include "Islands.h"
+#include "Grab.h"
+
+/*######################################################################################################################
+## DEFAULT PHYSICAL PARAMETERS #########################################################################################
+######################################################################################################################*/
+#define SIMULATION_K       10
+#define SIMULATION_KD      1
+#define SIMULATION_L0      200
+#define SIMULATION_GRAVITY 200
+#define SIMULATION_DRAG    0.99
+
+#define SIMULATION_CONTACT_RADIUS 20
+#define SIMULATION_CONTACT_K      100
+#define SIMULATION_CONTACT_KD     2
+
+/*######################################################################################################################
+## SOLVERS #############################################################################################################
+######################################################################################################################*/
+/***********************************************************************************************************************
+ * @brief The ways a simulation can be stepped, which can be changed between any two steps.
+ **********************************************************************************************************************/
+typedef enum Solver{
+	/** The forces at the start of the step move the nodes, cheap but unstable when the springs are stiff. */
+	SOLVER_EXPLICIT,
+	/** Backward Euler, solved with a conjugate gradient, stable with much larger steps, see Implicit. */
+	SOLVER_IMPLICIT,
+	/** The springs are distance constraints the positions are projected onto, stable at any step, see Xpbd. */
+	SOLVER_XPBD,
+} Solver;
+
+#define SIMULATION_SOLVER                SOLVER_EXPLICIT
+#define SIMULATION_ITERATIONS            50
+#define SIMULATION_TOLERANCE             1e-3
+#define SIMULATION_CONSTRAINT_ITERATIONS 8
+
+/*######################################################################################################################
+## SLEEPING ############################################################################################################
+######################################################################################################################*/
+/** The mean kinetic energy of the nodes of an island, v^2/2, below which it is considered still. */
+#define SIMULATION_SLEEP_ENERGY 50
+/** The number of steps all the nodes of an island have to stay still for before it falls asleep. */
+#define SIMULATION_SLEEP_STEPS  60
+
+/*######################################################################################################################
+## GRABBING ############################################################################################################
+######################################################################################################################*/
+/** The stiffness of the springs pulling the nodes grabbed towards the mouse, and their damping. */
+#define SIMULATION_GRAB_K  400
+#define SIMULATION_GRAB_KD 40
+
+/*######################################################################################################################
+## ADAPTIVE STEPPING ###################################################################################################
+######################################################################################################################*/
+/** The fraction of the largest stable step the explicit solver is stepped with. */
+#define SIMULATION_SAFETY       0.5f
+/** The fraction of the contact radius, or of the rest length without contacts, the fastest node may travel per step. */
+#define SIMULATION_MAX_TRAVEL   0.5f
+/** The largest number of steps Simulation_advance splits its time into. */
+#define SIMULATION_MAX_SUBSTEPS 32
+/** The number of nodes a node is assumed to be in contact with at most, for the stability of the contact forces. */
+#define SIMULATION_MAX_CONTACTS 6
+
+/*######################################################################################################################
+## TEARING #############################################################################################################
+######################################################################################################################*/
+/** The islands are found again once one spring in SIMULATION_TEAR_REBUILD has broken since they were last found. */
+#define SIMULATION_TEAR_REBUILD 8
+
+/*######################################################################################################################
+## MULTITHREADING ######################################################################################################
+######################################################################################################################*/
+/** The number of springs processed by a thread at once, below which the spring forces are not split between threads. */
+#define SIMULATION_SPRING_GRAIN 2048
+/** The number of nodes processed by a thread at once, a multiple of NODES_LANES to keep the vector loads aligned. */
+#define SIMULATION_NODE_GRAIN   4096
+
+/***********************************************************************************************************************
+ * @brief The Simulation structure
+
+ * This structure holds everything needed to step a soft body simulation: the nodes, the springs, the physical
+ * parameters and the kernels doing the work. It does not depend on SDL, so that it can run without any window, e.g. on
+ * servers or inside the benchmark.
+ **********************************************************************************************************************/
+typedef struct Simulation{
+	/** The nodes of the soft bodies. */
+	Nodes nodes;
+	/** The springs linking the nodes. */
+	Springs springs;
+	/** The kernels used to step the simulation. */
+	Kernels kernels;
+	/** The threads the steps are split between, NULL to step on the calling thread only. */
+	ThreadPool* pool;
+
+	/** The stiffness of the springs, unless they have materials of their own, see Springs_use_materials. */
+	float K;
+	/** The damping of the springs, unless they have materials of their own. */
+	float Kd;
+	/** The rest length of the springs, unless they have materials of their own. */
+	float L0;
+	/** The vertical acceleration applied to every node. */
+	float gravity;
+	/** The factor applied to the velocities at every step. */
+	float drag;
+	/** The size of the box the nodes bounce in, its top left corner being the origin. */
+	float width;
+	float height;
+
+	/** The distance below which two nodes push each other apart, 0 to disable the contacts. */
+	float contact_radius;
+	/** The stiffness of the contacts, i.e. the force per unit of overlap. */
+	float contact_K;
+	/** The damping of the contacts, along the line between the nodes. */
+	float contact_Kd;
+	/** The grid used to find the nodes in contact, rebuilt at every step, and the nodes grabbed. */
+	Grid grid;
+
+	/** The way the simulation is stepped. */
+	Solver solver;
+	/** The maximum number of iterations of the conjugate gradient. */
+	int iterations;
+	/** The residual, relative to the right hand side, below which the conjugate gradient stops. */
+	float tolerance;
+	/** The memory of the implicit solver. */
+	Implicit implicit;
+	/** The number of times the XPBD solver projects the nodes onto every spring per step. */
+	int constraint_iterations;
+	/** The memory of the XPBD solver. */
+	Xpbd xpbd;
+
+	/** This field tells whether the springs are always processed color by color, even on a single thread, so that the
+	 * forces are summed onto every node in the same order whatever the number of threads, and a given scene always
+	 * goes through bit identical states. See Trace. */
+	char deterministic;
+
+	/** This field tells whether the still islands fall asleep, see Islands. */
+	char sleeping;
+	/** The mean kinetic energy below which an island is still, and the number of steps it has to stay still. */
+	float sleep_energy;
+	int sleep_steps;
+	/** The islands of the nodes, found again whenever the number of nodes or of springs changes. */
+	Islands islands;
+	/** The number of sleeping nodes, hidden past the count of the nodes during a step. */
+	int asleep_nodes;
+
+	/** The nodes grabbed by the user, see Grab, and the stiffness and the damping they are pulled with. */
+	Grab grab;
+	float grab_K;
+	float grab_Kd;
+
+	/** This field tells whether Simulation_advance splits its time into as many steps as the stability needs. */
+	char adaptive;
+	/** The fraction of the largest stable step used, the fraction of the contact radius the fastest node may travel
+	 * per step, and the largest number of steps a call to Simulation_advance is split into. */
+	float safety;
+	float max_travel;
+	int max_substeps;
+	/** The number of steps the last call to Simulation_advance was split into. */
+	int substeps;
+	/** The number of times a node whose state was no longer finite was put back at rest, see Simulation_advance. */
+	int repaired;
+	/** The positions of the nodes at the start of Simulation_advance, and the stiffness and the damping around every
+	 * node while the stable step is measured, capacity floats each. */
+	float* scratch;
+	int scratch_capacity;
+
+	/** The number of springs broken since the simulation was created, see Springs_use_tearing, and since the islands
+	 * were last found. */
+	int torn;
+	int torn_since_build;
+
+	/** The new index of every node while nodes are removed, -1 for the removed ones, and the index itself otherwise. */
+	int* remap;
+	/** The number of nodes the remap array can hold. */
+	int remap_capacity;
+} Simulation;
+
+/***********************************************************************************************************************
+ * @brief Creates an empty simulation with the default physical parameters.
+
+ * @param sim (Simulation*): a pointer to the simulation to be created.
+ * @param capacity (int): the number of nodes the simulation should be able to hold.
+ * @param width (float): the width of the box the nodes bounce in.
+ * @param height (float): the height of the box the nodes bounce in.
+
+ * @return a char, non zero if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern char Simulation_create(Simulation* sim, int capacity, float width, float height);
+
+/***********************************************************************************************************************
+ * @brief Sets the number of threads the steps are split between.
+
+ * The spring forces are accumulated color by color, see Springs_color: the springs of a color share no node, so they
+ * are split between the threads without any synchronization, and a color is finished before the next one starts.
+
+ * @param sim (Simulation*): a pointer to the simulation.
+ * @param nb_threads (int): the number of threads, including the calling one, 0 meaning one per core.
+
+ * @return a char, non zero if the threads could not be created, in which case the simulation runs on one thread.
+ **********************************************************************************************************************/
+extern char Simulation_set_threads(Simulation* sim, int nb_threads);
+
+/***********************************************************************************************************************
+ * @brief Removes a set of nodes together with their springs.
+
+ * The nodes are removed at once: the removed nodes below the new number of nodes are filled with the last nodes that
+ * remain, then the springs are renumbered in a single pass, the springs of the removed nodes being dropped. Removing
+ * many nodes per frame therefore costs a single pass over the springs, O(n + E), and nothing depends on the number of
+ * slots ever allocated. The springs have to be colored again afterwards, which is done on the next step if needed.
+
+ * @param sim (Simulation*): a pointer to the simulation.
+ * @param indices (const int*): the indices of the nodes to remove, all different.
+ * @param n (int): the number of nodes to remove.
+
+ * @return a char, non zero if the memory could not be allocated, in which case nothing is removed.
+ **********************************************************************************************************************/
+extern char Simulation_remove_nodes(Simulation* sim, const int* indices, int n);
+
+/***********************************************************************************************************************
+ * @brief Wakes every island up, and has the islands found again on the next step.
+
+ * The islands are found again on their own when the number of nodes or of springs changes, this is needed when the
+ * nodes are moved or the springs rewired by hand without changing their numbers.
+
+ * @param sim (Simulation*): a pointer to the simulation.
+ **********************************************************************************************************************/
+extern void Simulation_wake(Simulation* sim);
+
+/***********************************************************************************************************************
+ * @brief Grabs the node closest to a point, or every node around it, to be pulled towards a target from now on.
+
+ * Every island is woken up, and none falls asleep while nodes are held, so that the nodes held keep their indices.
+
+ * @param sim (Simulation*): a pointer to the simulation.
+ * @param x (float): the x coordinate of the point, which becomes the target.
+ * @param y (float): the y coordinate of the point.
+ * @param radius (float): the distance within which the nodes are grabbed.
+ * @param brush (char): whether every node within the radius is grabbed, or only the closest one.
+
+ * @return a char, non zero if the memory could not be allocated, in which case nothing is grabbed.
+ **********************************************************************************************************************/
+extern char Simulation_grab(Simulation* sim, float x, float y, float radius, char brush);
+
+/***********************************************************************************************************************
+ * @brief Moves the target the nodes grabbed are pulled towards.
+
+ * @param sim (Simulation*): a pointer to the simulation.
+ * @param x (float): the x coordinate of the target.
+ * @param y (float): the y coordinate of the target.
+ **********************************************************************************************************************/
+extern void Simulation_move_grab(Simulation* sim, float x, float y);
+
+/***********************************************************************************************************************
+ * @brief Lets go of the nodes grabbed.
+
+ * @param sim (Simulation*): a pointer to the simulation.
+ **********************************************************************************************************************/
+extern void Simulation_release(Simulation* sim);
+
+/***********************************************************************************************************************
+ * @brief Resets the accelerations of the nodes to the gravity, and accumulates the spring forces onto them.
+
+ * With the XPBD solver, the springs are constraints rather than forces, and only the gravity is set.
+
+ * @param sim (Simulation*): a pointer to the simulation.
+ **********************************************************************************************************************/
+extern void Simulation_compute_forces(Simulation* sim);
+
+/***********************************************************************************************************************
+ * @brief Accumulates the contact forces onto the accelerations of the nodes.
+
+ * Any two nodes closer than the contact radius are pushed apart, whether they belong to the same body or not. The nodes
+ * in contact are found with a uniform grid rebuilt at every step, so the contacts cost O(N) rather than O(N^2).
+
+ * @param sim (Simulation*): a pointer to the simulation.
+ **********************************************************************************************************************/
+extern void Simulation_compute_contacts(Simulation* sim);
+
+/***********************************************************************************************************************
+ * @brief Turns the forces computed beforehand into the accelerations the chosen solver moves the nodes with.
+
+ * The explicit solver uses the forces as they are, the implicit one replaces them with the velocity change of a
+ * backward Euler step divided by the time step. If the implicit solver cannot allocate its memory, the step is explicit.
+ * The XPBD solver moves the nodes with the forces, then projects them onto the springs, the velocities being set by
+ * Simulation_integrate. The springs of a color are projected in parallel, see Simulation_set_threads.
+
+ * @param sim (Simulation*): a pointer to the simulation.
+ * @param dt (float): the time step, in seconds.
+ **********************************************************************************************************************/
+extern void Simulation_solve(Simulation* sim, float dt);
+
+/***********************************************************************************************************************
+ * @brief Moves the nodes according to the accelerations computed beforehand.
+
+ * The positions before the move are kept, so that the rendering can be interpolated between the last two states. With
+ * the XPBD solver, the nodes have already moved, and are given the velocity of their move instead.
+
+ * @param sim (Simulation*): a pointer to the simulation.
+ * @param dt (float): the time step, in seconds.
+ **********************************************************************************************************************/
+extern void Simulation_integrate(Simulation* sim, float dt);
+
+/***********************************************************************************************************************
+ * @brief Advances the simulation by one time step, i.e. computes the forces, the contacts and the pull on the nodes
+ * grabbed, solves then integrates.
+
+ * When sleeping is enabled, the nodes and the springs of the sleeping islands come last, and are hidden from the
+ * phases by lowering the counts of the nodes and of the springs for the duration of the step, so that they cost
+ * nothing. The awake nodes still collide with the sleeping ones, which stay still. The islands are updated at the end
+ * of the step, which may reorder the nodes, see Islands_update.
+ * When the springs can tear, the springs strained past their threshold are removed at the end of the step, each in
+ * O(colors), see Springs_remove. A tear can only split an island, so the islands are kept as they are, only their
+ * springs being counted down; they are found again once enough springs have broken, see SIMULATION_TEAR_REBUILD.
+
+ * @param sim (Simulation*): a pointer to the simulation.
+ * @param dt (float): the time step, in seconds.
+ **********************************************************************************************************************/
+extern void Simulation_step(Simulation* sim, float dt);
+
+/***********************************************************************************************************************
+ * @brief Gives the largest time step the simulation can be stepped with right now.
+
+ * The explicit solver is stable as long as dt < 2 / (c + w), w^2 and c being the largest stiffness and damping around a
+ * node, bounded by twice the sum of those of its springs, of the contacts of SIMULATION_MAX_CONTACTS nodes and of the
+ * pull of the grab, the nodes having a unit mass. Every solver is also limited so that the fastest node does not travel
+ * more than a fraction of the contact radius per step, lest it goes through the nodes it should hit.
+
+ * @param sim (Simulation*): a pointer to the simulation.
+
+ * @return the time step, in seconds, or a negative value if the memory needed could not be allocated.
+ **********************************************************************************************************************/
+extern float Simulation_stable_dt(Simulation* sim);
+
+/***********************************************************************************************************************
+ * @brief Advances the simulation by a given time, in as many steps as needed when the simulation is adaptive, and in a
+ * single step otherwise.
+
+ * The time is split into equal steps no larger than the stable step, which is measured again after every step as the
+ * nodes speed up or slow down, up to max_substeps steps, so that calm frames run a single large step and only violent
+ * ones pay for small steps. The previous positions of the nodes are those at the start of the call, so that the
+ * rendering interpolates over the whole time.
+ * After every step, a node whose state is no longer finite, e.g. after an overflow, is put back at rest where it was
+ * before the step, so that it does not spread through the mesh.
+
+ * @param sim (Simulation*): a pointer to the simulation.
+ * @param dt (float): the time to advance by, in seconds.
+
+ * @return the number of steps run.
+ **********************************************************************************************************************/
+extern int Simulation_advance(Simulation* sim, float dt);
+
+/***********************************************************************************************************************
+ * @brief Releases the memory held by a simulation.
+
+ * @param sim (Simulation*): a pointer to the simulation.
+ **********************************************************************************************************************/
+extern void Simulation_free(Simulation* sim);
+
+#endif
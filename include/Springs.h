@@ -0,0 +1,244 @@
+#ifndef LIB_SPRINGS_H
+#define LIB_SPRINGS_H
+
+/***********************************************************************************************************************
+ * @brief The Springs structure
+
+ * This structure stores the topology of a soft body as a compact list of edges: spring number s links node a[s] to node
+ * b[s]. Walking every spring therefore costs O(E) whatever the number of nodes, instead of testing every (i, j) pair of
+ * a dense connection matrix.
+ * An optional compressed sparse row (CSR) adjacency view can be built on demand to walk the neighbours of a node.
+ * The springs can also be sorted into colors, i.e. batches in which no two springs share a node, so that the springs of
+ * a batch can be processed in parallel without two threads ever writing to the same node.
+ * Every spring uses the rest length, stiffness and damping of the simulation, unless the springs are given materials
+ * of their own, e.g. the rest lengths of a mesh measured on its initial shape.
+ * The springs can be made to tear, every spring breaking once its strain passes a threshold of its own. A broken spring
+ * is removed in O(colors) by moving springs from the end of the colors into its place, so that the colors stay valid.
+ **********************************************************************************************************************/
+typedef struct Springs{
+	/** The index of the first node of every spring. */
+	int* a;
+	/** The index of the second node of every spring. */
+	int* b;
+	/** The length of every spring, as measured by the last force computation. */
+	float* length;
+	/** The number of springs currently stored. */
+	int count;
+	/** The number of springs that fit in the arrays before they have to grow. */
+	int capacity;
+	/** This field tells whether the arrays a and b belong to someone else, e.g. a mapped scene file, in which case they
+	 * are copied before growing and are not released with the springs. */
+	char borrowed;
+	/** A number changed whenever springs are added, removed or reordered, or their ends renumbered, so that the copies
+	 * of the springs can tell whether they are out of date. */
+	unsigned int topology;
+
+	/** The rest length, the stiffness and the damping of every spring, NULL as long as the springs share the parameters
+	 * of the simulation, see Springs_use_materials. */
+	float* rest;
+	float* stiffness;
+	float* damping;
+	/** The strain, i.e. |length - rest| / rest, past which every spring breaks, NULL as long as the springs cannot
+	 * break, see Springs_use_tearing. A spring that never breaks has an infinite threshold. */
+	float* tear;
+
+	/** CSR view: the neighbours of node i are neighbours[offsets[i]] to neighbours[offsets[i+1]-1]. */
+	int* offsets;
+	/** CSR view: the other end of every spring, grouped by node. */
+	int* neighbours;
+	/** CSR view: the spring each entry of neighbours comes from. */
+	int* edges;
+	/** The number of nodes the CSR view has been built for. */
+	int adjacency_nodes;
+	/** This field tells whether the CSR view matches the current list of springs. */
+	char adjacency_valid;
+
+	/** Colors: the springs of color c are the springs color_offsets[c] to color_offsets[c+1]-1. The springs from
+	 * color_offsets[nb_colors] to the end could not be colored or were added afterwards, and may share nodes. */
+	int* color_offsets;
+	/** The number of colors. */
+	int nb_colors;
+	/** This field tells whether the springs have been sorted into colors. */
+	char colors_valid;
+} Springs;
+
+/***********************************************************************************************************************
+ * @brief Gives a newly initialized, empty, list of springs.
+
+ * @return springs (Springs): an empty list of springs, nothing is allocated until the first spring is added.
+ **********************************************************************************************************************/
+extern Springs Springs_init();
+
+/***********************************************************************************************************************
+ * @brief Gives a list of springs on top of existing arrays of endpoints, which are used in place.
+
+ * The arrays must stay valid until the springs are released, and are not released with them. They are only copied if
+ * the list has to grow or the springs are colored.
+
+ * @param a (int*): the index of the first node of every spring.
+ * @param b (int*): the index of the second node of every spring.
+ * @param count (int): the number of springs.
+
+ * @return the list of springs, with no spring at all if the lengths could not be allocated.
+ **********************************************************************************************************************/
+extern Springs Springs_wrap(int* a, int* b, int count);
+
+/***********************************************************************************************************************
+ * @brief Makes sure a list of springs can hold a given number of springs without growing.
+
+ * @param springs (Springs*): a pointer to the list of springs.
+ * @param capacity (int): the number of springs the list should be able to hold.
+
+ * @return a char, non zero if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern char Springs_reserve(Springs* springs, int capacity);
+
+/***********************************************************************************************************************
+ * @brief Adds a spring between two nodes.
+
+ * The arrays grow geometrically, so adding a spring is O(1) amortized. The CSR view is invalidated. If the springs have
+ * materials, the new spring has a null rest length, stiffness and damping until it is given some with
+ * Springs_set_material. If the springs can tear, the new spring never breaks until it is given a threshold.
+
+ * @param springs (Springs*): a pointer to the list of springs.
+ * @param a (int): the index of the first node.
+ * @param b (int): the index of the second node.
+
+ * @return a char, non zero if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern char Springs_add(Springs* springs, int a, int b);
+
+/***********************************************************************************************************************
+ * @brief Gives every spring a material of its own, its rest length being its current length.
+
+ * Once the springs have materials, the parameters of the simulation are ignored and the forces are computed by the
+ * general kernels, which read the parameters of every spring.
+
+ * @param springs (Springs*): a pointer to the list of springs.
+ * @param x (const float*): the x coordinates of the nodes.
+ * @param y (const float*): the y coordinates of the nodes.
+ * @param K (float): the stiffness of every spring.
+ * @param Kd (float): the damping of every spring.
+
+ * @return a char, non zero if the memory could not be allocated, in which case the springs are left as they were.
+ **********************************************************************************************************************/
+extern char Springs_use_materials(Springs* springs, const float* x, const float* y, float K, float Kd);
+
+/***********************************************************************************************************************
+ * @brief Sets the material of a spring, the springs having materials.
+
+ * @param springs (Springs*): a pointer to the list of springs.
+ * @param s (int): the index of the spring.
+ * @param rest (float): the rest length of the spring.
+ * @param K (float): the stiffness of the spring.
+ * @param Kd (float): the damping of the spring.
+ **********************************************************************************************************************/
+extern void Springs_set_material(Springs* springs, int s, float rest, float K, float Kd);
+
+/***********************************************************************************************************************
+ * @brief Lets the springs tear, every spring breaking once its strain passes a threshold, see Simulation_step.
+
+ * The thresholds can then be changed spring by spring in the tear array, an infinite threshold for a spring that never
+ * breaks.
+
+ * @param springs (Springs*): a pointer to the list of springs.
+ * @param strain (float): the threshold of every spring, e.g. 1 for a spring that breaks at twice its rest length.
+
+ * @return a char, non zero if the memory could not be allocated, in which case the springs are left as they were.
+ **********************************************************************************************************************/
+extern char Springs_use_tearing(Springs* springs, float strain);
+
+/***********************************************************************************************************************
+ * @brief Moves a spring from one index to another, overwriting the spring there.
+
+ * @param springs (Springs*): a pointer to the list of springs.
+ * @param from (int): the index of the spring to move.
+ * @param to (int): the index it is moved to.
+ **********************************************************************************************************************/
+extern void Springs_move(Springs* springs, int from, int to);
+
+/***********************************************************************************************************************
+ * @brief Removes a spring, the order of the other springs being changed.
+
+ * If the springs are colored, the spring is replaced by the last spring of its color, which is replaced by the last
+ * spring of the next color, and so on, the colors shrinking by one spring each: the removal costs O(colors) and the
+ * colors stay valid. Otherwise the spring is replaced by the last one, in O(1). The CSR view is invalidated. The
+ * entries past the count are left as they are.
+
+ * @param springs (Springs*): a pointer to the list of springs.
+ * @param s (int): the index of the spring.
+ **********************************************************************************************************************/
+extern void Springs_remove(Springs* springs, int s);
+
+/***********************************************************************************************************************
+ * @brief Reorders the springs, spring order[k] becoming spring k. The CSR view and the colors are invalidated.
+
+ * @param springs (Springs*): a pointer to the list of springs.
+ * @param order (const int*): the former index of every spring, a permutation of the springs.
+
+ * @return a char, non zero if the memory could not be allocated, in which case the list is left as it was.
+ **********************************************************************************************************************/
+extern char Springs_permute(Springs* springs, const int* order);
+
+/***********************************************************************************************************************
+ * @brief Measures the length of every spring, which is otherwise only done when computing the forces.
+
+ * @param springs (Springs*): a pointer to the list of springs.
+ * @param x (const float*): the x coordinates of the nodes.
+ * @param y (const float*): the y coordinates of the nodes.
+ **********************************************************************************************************************/
+extern void Springs_measure(Springs* springs, const float* x, const float* y);
+
+/***********************************************************************************************************************
+ * @brief Removes every spring, without releasing the memory.
+
+ * @param springs (Springs*): a pointer to the list of springs.
+ **********************************************************************************************************************/
+extern void Springs_clear(Springs* springs);
+
+/***********************************************************************************************************************
+ * @brief Builds the CSR adjacency view of the springs.
+
+ * The view is built with a counting sort over the endpoints, in O(N + E). Every spring appears twice, once in the row
+ * of each of its ends.
+
+ * @param springs (Springs*): a pointer to the list of springs.
+ * @param nb_nodes (int): the number of nodes, every endpoint must be lower than this value.
+
+ * @return a char, non zero if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern char Springs_build_adjacency(Springs* springs, int nb_nodes);
+
+/***********************************************************************************************************************
+ * @brief Sorts the springs into colors.
+
+ * The springs are colored greedily, every spring getting the lowest color used by neither of its ends, then reordered
+ * so that the springs of a color are contiguous. On the meshes met in practice, about twice the maximum degree of a
+ * node colors are needed. A node with more than 64 springs gets its extra springs left uncolored, at the end of the
+ * list. The CSR view is invalidated, as the springs move. The entries past the count are kept as they are, so that a
+ * prefix of the list can be colored by lowering the count for a while.
+
+ * @param springs (Springs*): a pointer to the list of springs.
+ * @param nb_nodes (int): the number of nodes, every endpoint must be lower than this value.
+
+ * @return a char, non zero if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern char Springs_color(Springs* springs, int nb_nodes);
+
+/***********************************************************************************************************************
+ * @brief Gives the number of springs left out of the colors, which have to be processed by a single thread.
+
+ * @param springs (const Springs*): a pointer to the list of springs.
+
+ * @return the number of uncolored springs, every spring if the springs have not been colored.
+ **********************************************************************************************************************/
+extern int Springs_uncolored(const Springs* springs);
+
+/***********************************************************************************************************************
+ * @brief Releases the memory held by a list of springs.
+
+ * @param springs (Springs*): a pointer to the list of springs, which is left empty and can be reused.
+ **********************************************************************************************************************/
+extern void Springs_free(Springs* springs);
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef LIB_STATS_H
+#define LIB_STATS_H
+
+#include <stdio.h>
+
+#include "Histogram.h"
+
+/***********************************************************************************************************************
+ * @brief The durations tracked for every frame.
+ **********************************************************************************************************************/
+typedef enum StatsMetric{
+	/** The whole frame, from one start of the main loop to the next. */
+	STATS_FRAME,
+	/** The physics steps run between two states published by the simulation thread, see Pipeline. */
+	STATS_PHYSICS,
+	/** The drawing of the frame, up to its presentation. */
+	STATS_RENDER,
+	/** The time spent waiting for the next frame. */
+	STATS_SLEEP,
+	/** The number of metrics. */
+	STATS_METRICS
+} StatsMetric;
+
+/***********************************************************************************************************************
+ * @brief The formats of the lines written by the statistics.
+ **********************************************************************************************************************/
+typedef enum StatsFormat{
+	/** Comma separated values, after a header line naming the columns, written only at the start of a file. */
+	STATS_CSV,
+	/** One JSON object per line. */
+	STATS_JSON
+} StatsFormat;
+
+/***********************************************************************************************************************
+ * @brief The Stats structure
+
+ * This structure gathers the durations of the frames into one histogram per metric and, once every period, writes a
+ * line with their 50th, 95th and 99th percentiles and their maximum before starting over, so that the stutters hidden
+ * by an average show up in the tail. The durations are kept in microseconds, to within 1/64 of their value, in a fixed
+ * amount of memory.
+ **********************************************************************************************************************/
+typedef struct Stats{
+	/** The durations of the frames of the current period, in microseconds. */
+	Histogram histograms[STATS_METRICS];
+	/** The file the lines are written to, and whether it has to be closed with the statistics. */
+	FILE* output;
+	char owned;
+	StatsFormat format;
+	/** The length of a period, in seconds. */
+	double period;
+
+	/** The time spent in the current period, and since the statistics were opened, in seconds. */
+	double elapsed;
+	double total;
+	/** The number of frames of the current period. */
+	int frames;
+} Stats;
+
+/***********************************************************************************************************************
+ * @brief Opens statistics, written to a file or to the standard output.
+
+ * @param stats (Stats*): a pointer to the statistics to be opened.
+ * @param path (const char*): the path of the file the lines are appended to, NULL or "-" for the standard output.
+ * @param format (StatsFormat): the format of the lines.
+ * @param period (double): the time between two lines, in seconds.
+
+ * @return a char, non zero if the file could not be opened.
+ **********************************************************************************************************************/
+extern char Stats_open(Stats* stats, const char* path, StatsFormat format, double period);
+
+/***********************************************************************************************************************
+ * @brief Records a duration of the current frame.
+
+ * @param stats (Stats*): a pointer to the statistics.
+ * @param metric (StatsMetric): what was timed, the frames themselves being given to Stats_end_frame.
+ * @param seconds (double): the duration, in seconds.
+ **********************************************************************************************************************/
+extern void Stats_record(Stats* stats, StatsMetric metric, double seconds);
+
+/***********************************************************************************************************************
+ * @brief Records the duration of a whole frame, and writes a line if the period is over.
+
+ * @param stats (Stats*): a pointer to the statistics.
+ * @param seconds (double): the duration of the frame, in seconds.
+ **********************************************************************************************************************/
+extern void Stats_end_frame(Stats* stats, double seconds);
+
+/***********************************************************************************************************************
+ * @brief Closes statistics, closing their file if they opened one.
+
+ * @param stats (Stats*): a pointer to the statistics.
+ **********************************************************************************************************************/
+extern void Stats_close(Stats* stats);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef LIB_STEPPER_H
+#define LIB_STEPPER_H
+
+/***********************************************************************************************************************
+ * @brief The Stepper structure
+
+ * This structure turns the real time elapsed between two rendered frames into a number of fixed physics steps. The time
+ * that does not make a whole step is carried over to the next frame, so that the simulated time follows the real time
+ * whatever the frame rate, and what is left is used to interpolate the rendered positions between the last two states.
+ * When the physics cannot keep up, the number of steps per frame is clamped and the late time is dropped, so that a
+ * long frame does not lead to even longer ones.
+ **********************************************************************************************************************/
+typedef struct Stepper{
+	/** The fixed physics step, in seconds. */
+	double dt;
+	/** The maximum number of steps run in a single frame. */
+	int max_steps;
+
+	/** The elapsed time not simulated yet, in seconds, always lower than dt after a call to Stepper_advance. */
+	double accumulator;
+	/** The position of the rendered frame between the previous and the current physics states, in [0, 1]. */
+	float alpha;
+	/** The total simulated time dropped because the physics could not keep up, in seconds. */
+	double dropped;
+} Stepper;
+
+/***********************************************************************************************************************
+ * @brief Gives a newly initialized stepper.
+
+ * @param dt (double): the fixed physics step, in seconds.
+ * @param max_steps (int): the maximum number of steps run in a single frame.
+
+ * @return the stepper, with nothing accumulated.
+ **********************************************************************************************************************/
+extern Stepper Stepper_init(double dt, int max_steps);
+
+/***********************************************************************************************************************
+ * @brief Accumulates the real time elapsed since the last frame and tells how many physics steps to run.
+
+ * @param stepper (Stepper*): a pointer to the stepper.
+ * @param elapsed (double): the real time elapsed since the last call, in seconds.
+
+ * @return the number of fixed steps to run during this frame, between 0 and the max_steps of the stepper.
+ **********************************************************************************************************************/
+extern int Stepper_advance(Stepper* stepper, double elapsed);
+
+/***********************************************************************************************************************
+ * @brief Forgets the accumulated time, e.g. when the simulation is paused.
+
+ * @param stepper (Stepper*): a pointer to the stepper.
+ **********************************************************************************************************************/
+extern void Stepper_reset(Stepper* stepper);
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef LIB_THREAD_POOL_H
+#define LIB_THREAD_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/***********************************************************************************************************************
+ * @brief The work given to a thread pool.
+
+ * The task is called with chunks [begin, end) of the range given to ThreadPool_parallel_for, and with the number of the
+ * thread running it, 0 being the calling thread and 1 to nb_workers the workers of the pool.
+ **********************************************************************************************************************/
+typedef void (*ThreadPool_task)(void* context, int begin, int end, int thread);
+
+/***********************************************************************************************************************
+ * @brief The ThreadPool structure
+
+ * This structure holds a set of persistent worker threads, so that the physics can be split between the cores of the
+ * processor at every step without paying for the creation of threads. The workers spin for a short while after a job
+ * before going to sleep, so that the many short jobs of a step are dispatched quickly.
+ **********************************************************************************************************************/
+typedef struct ThreadPool{
+	/** The worker threads, the calling thread also takes part in every job. */
+	pthread_t* threads;
+	/** The number of worker threads. */
+	int nb_workers;
+
+	/** These fields are used to put the idle workers to sleep and to wake them up. */
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	/** This field is incremented every time a job is posted, or when the pool is stopped. */
+	atomic_uint generation;
+	/** The start of the next chunk of the current job to be processed. */
+	atomic_int next;
+	/** The number of workers which have not finished the current job yet. */
+	atomic_int remaining;
+	/** This field tells the workers to exit. */
+	atomic_int stop;
+
+	/** The current job. */
+	ThreadPool_task task;
+	void* context;
+	int end;
+	int grain;
+} ThreadPool;
+
+/***********************************************************************************************************************
+ * @brief Starts a thread pool.
+
+ * @param pool (ThreadPool*): a pointer to the pool to be started.
+ * @param nb_threads (int): the total number of threads working on a job, including the calling thread, 0 meaning one
+ * per core of the processor.
+
+ * @return a char, non zero if the threads could not be created.
+ **********************************************************************************************************************/
+extern char ThreadPool_create(ThreadPool* pool, int nb_threads);
+
+/***********************************************************************************************************************
+ * @brief Runs a task over a range, split in chunks shared between the threads of the pool, and waits for its end.
+
+ * Chunks start at begin plus a multiple of grain, so that the vectorized kernels can rely on their alignment. Ranges no
+ * larger than a chunk are run directly by the calling thread.
+
+ * @param pool (ThreadPool*): a pointer to the pool, NULL to run the whole range on the calling thread.
+ * @param begin (int): the start of the range.
+ * @param end (int): one past the end of the range.
+ * @param grain (int): the size of the chunks.
+ * @param task (ThreadPool_task): the function to be run on every chunk.
+ * @param context (void*): the data given to the task.
+ **********************************************************************************************************************/
+extern void ThreadPool_parallel_for(ThreadPool* pool, int begin, int end, int grain, ThreadPool_task task, void* context);
+
+/***********************************************************************************************************************
+ * @brief Gives the total number of threads working on a job, including the calling thread.
+
+ * @param pool (const ThreadPool*): a pointer to the pool, NULL meaning the calling thread alone.
+
+ * @return the number of threads.
+ **********************************************************************************************************************/
+extern int ThreadPool_size(const ThreadPool* pool);
+
+/***********************************************************************************************************************
+ * @brief Stops the workers of a thread pool and releases its memory.
+
+ * @param pool (ThreadPool*): a pointer to the pool.
+ **********************************************************************************************************************/
+extern void ThreadPool_free(ThreadPool* pool);
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef LIB_TRACE_H
+#define LIB_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "Simulation.h"
+
+/*######################################################################################################################
+## FILE FORMAT #########################################################################################################
+######################################################################################################################*/
+/** The first bytes of every trace file. */
+#define TRACE_MAGIC   "SOFTRACE"
+/** The version of the format, bumped whenever the layout changes. */
+#define TRACE_VERSION 1
+
+/***********************************************************************************************************************
+ * @brief The TraceHeader structure
+
+ * This structure is the first thing of a trace file, and holds what is needed to run the same steps again. It is
+ * followed by one record per step, made of the checksum of the state of the nodes after the step, see Trace_hash, and
+ * of the x and y coordinates and the x and y velocities of the nodes, nb_nodes floats each.
+ * The file is written in the byte order of the machine, a file of the other byte order failing the version check.
+ **********************************************************************************************************************/
+typedef struct TraceHeader{
+	/** TRACE_MAGIC, without the final null character. */
+	char magic[8];
+	/** TRACE_VERSION. */
+	uint32_t version;
+	/** The size of this header, in bytes. */
+	uint32_t header_size;
+	/** The number of nodes and of springs of the simulation. */
+	uint32_t nb_nodes;
+	uint32_t nb_springs;
+	/** The time step, fixed for the whole trace. */
+	float dt;
+	/** The solver the simulation was stepped with. */
+	uint32_t solver;
+	/** The seed the scene was built with, if it was generated rather than loaded. */
+	uint32_t seed;
+	uint32_t reserved;
+} TraceHeader;
+
+/***********************************************************************************************************************
+ * @brief The first difference found between the state of a simulation and the state recorded in a trace.
+ **********************************************************************************************************************/
+typedef struct TraceDivergence{
+	/** The step, counted from 0, and the node. */
+	int step;
+	int node;
+	/** The name of the field that differs: "x", "y", "vx" or "vy". */
+	const char* field;
+	/** The value recorded and the value found. */
+	float expected;
+	float actual;
+	/** The distance between the two values, in units in the last place. */
+	uint32_t ulps;
+} TraceDivergence;
+
+/***********************************************************************************************************************
+ * @brief The Trace structure
+
+ * This structure records the state of the nodes after every step of a simulation into a file, or checks the steps of
+ * a simulation against a file recorded before, e.g. by the scalar kernels on a single thread, so that the vectorized
+ * and multithreaded kernels can be shown to follow the same trajectory. The checksums of two identical states are
+ * equal, in which case the nodes are not compared one by one; otherwise the nodes are compared with a tolerance in
+ * units in the last place, and the first one out of it is reported.
+ **********************************************************************************************************************/
+typedef struct Trace{
+	/** The file being written or read. */
+	FILE* file;
+	/** The header of the file. */
+	TraceHeader header;
+	/** This field tells whether the trace is being recorded rather than checked. */
+	char recording;
+	/** The number of steps recorded or checked so far. */
+	int step;
+	/** The state read back from the file for the current step, 4 x nb_nodes floats. */
+	float* expected;
+	/** The largest distance met so far between a value found and the value recorded, in units in the last place. */
+	uint32_t max_ulps;
+} Trace;
+
+/***********************************************************************************************************************
+ * @brief Computes the checksum of the state of the nodes, i.e. a 64 bit FNV-1a hash of the bits of their coordinates
+ * and velocities, which two states only share if they are bit identical, barring collisions.
+
+ * @param nodes (const Nodes*): a pointer to the node store.
+
+ * @return the checksum.
+ **********************************************************************************************************************/
+extern uint64_t Trace_hash(const Nodes* nodes);
+
+/***********************************************************************************************************************
+ * @brief Creates a trace file to record the steps of a simulation into.
+
+ * @param trace (Trace*): a pointer to the trace to be created.
+ * @param path (const char*): the path of the file.
+ * @param sim (const Simulation*): a pointer to the simulation, whose nodes and springs are counted and whose solver is
+ * recorded.
+ * @param dt (float): the time step the simulation is stepped with.
+ * @param seed (uint32_t): the seed the scene was built with, 0 if it was loaded.
+
+ * @return a char, non zero if the file could not be created.
+ **********************************************************************************************************************/
+extern char Trace_create(Trace* trace, const char* path, const Simulation* sim, float dt, uint32_t seed);
+
+/***********************************************************************************************************************
+ * @brief Opens a trace file to check the steps of a simulation against.
+
+ * @param trace (Trace*): a pointer to the trace to be opened.
+ * @param path (const char*): the path of the file.
+
+ * @return a char, non zero if the file could not be read or is not a valid trace.
+ **********************************************************************************************************************/
+extern char Trace_open(Trace* trace, const char* path);
+
+/***********************************************************************************************************************
+ * @brief Appends the state of the nodes after a step to a trace being recorded.
+
+ * @param trace (Trace*): a pointer to the trace.
+ * @param nodes (const Nodes*): a pointer to the node store.
+
+ * @return a char, non zero if the file could not be written.
+ **********************************************************************************************************************/
+extern char Trace_record(Trace* trace, const Nodes* nodes);
+
+/***********************************************************************************************************************
+ * @brief Compares the state of the nodes after a step with the next step of a trace being checked.
+
+ * @param trace (Trace*): a pointer to the trace.
+ * @param nodes (const Nodes*): a pointer to the node store.
+ * @param tolerance (uint32_t): the largest distance allowed between two values, in units in the last place, 0 for bit
+ * identical states.
+ * @param divergence (TraceDivergence*): filled with the first value out of the tolerance, if any.
+
+ * @return an int, 0 if the states match, 1 if they diverge, -1 if the trace has no more steps, and -2 if the next step
+ * is truncated or cannot be read, or if the number of nodes is not the one the trace was recorded with.
+ **********************************************************************************************************************/
+extern int Trace_check(Trace* trace, const Nodes* nodes, uint32_t tolerance, TraceDivergence* divergence);
+
+/***********************************************************************************************************************
+ * @brief Closes a trace file.
+
+ * @param trace (Trace*): a pointer to the trace.
+
+ * @return a char, non zero if a trace being recorded could not be written completely.
+ **********************************************************************************************************************/
+extern char Trace_close(Trace* trace);
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef LIB_VIEW_H
+#define LIB_VIEW_H
+
+#include "Bvh.h"
+
+/** The factor a view can be zoomed in or out by at most from the zoom it was fitted with. */
+#define VIEW_ZOOM_RANGE 1000
+
+/***********************************************************************************************************************
+ * @brief The View structure
+
+ * This structure is the camera of the viewer: the part of the world shown in the window, given by the point of the world
+ * at its top left corner and by a zoom, in pixels per unit of the world. A point (x, y) of the world is drawn at the
+ * pixel ((x - view.x)*view.zoom, (y - view.y)*view.zoom).
+ **********************************************************************************************************************/
+typedef struct View{
+	/** The point of the world at the top left corner of the window. */
+	float x;
+	float y;
+	/** The number of pixels per unit of the world. */
+	float zoom;
+	/** The size of the window, in pixels. */
+	float width;
+	float height;
+	/** The range the zoom is kept in, so that the coordinates stay finite. */
+	float min_zoom;
+	float max_zoom;
+} View;
+
+/***********************************************************************************************************************
+ * @brief Gives a view that fits a box of the world into a window, centered.
+
+ * @param world_w (float): the width of the box of the world.
+ * @param world_h (float): the height of the box of the world.
+ * @param width (float): the width of the window, in pixels.
+ * @param height (float): the height of the window, in pixels.
+
+ * @return the view, with a zoom of 1 when the box has the size of the window, which can be zoomed in or out by up to
+ * VIEW_ZOOM_RANGE.
+ **********************************************************************************************************************/
+extern View View_fit(float world_w, float world_h, float width, float height);
+
+/***********************************************************************************************************************
+ * @brief Zooms a view in or out, keeping the point of the world under a pixel in place, e.g. under the mouse. The zoom
+ * stays within the range of the view.
+
+ * @param view (View*): a pointer to the view.
+ * @param factor (float): the factor the zoom is multiplied by, greater than 1 to zoom in.
+ * @param pixel_x (float): the x coordinate of the pixel that stays in place.
+ * @param pixel_y (float): the y coordinate of the pixel that stays in place.
+ **********************************************************************************************************************/
+extern void View_zoom(View* view, float factor, float pixel_x, float pixel_y);
+
+/***********************************************************************************************************************
+ * @brief Moves a view so that the world follows the mouse, e.g. while it is dragged.
+
+ * @param view (View*): a pointer to the view.
+ * @param dx (float): the horizontal move of the mouse, in pixels.
+ * @param dy (float): the vertical move of the mouse, in pixels.
+ **********************************************************************************************************************/
+extern void View_pan(View* view, float dx, float dy);
+
+/***********************************************************************************************************************
+ * @brief Gives the box of the world shown in the window.
+
+ * @param view (const View*): a pointer to the view.
+ * @param margin (float): the number of pixels the box is grown by on every side, e.g. for the size of the nodes.
+
+ * @return the box, in the coordinates of the world.
+ **********************************************************************************************************************/
+extern BvhBox View_bounds(const View* view, float margin);
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef LIB_XPBD_H
+#define LIB_XPBD_H
+
+#include "Nodes.h"
+#include "Springs.h"
+
+/***********************************************************************************************************************
+ * @brief The Xpbd structure
+
+ * This structure holds the memory of the extended position based dynamics (XPBD) solver. Instead of turning the springs
+ * into forces, every spring becomes a distance constraint |xi - xj| = L0 with a compliance of 1/K, and the positions
+ * predicted from the external forces are corrected spring by spring, Gauss-Seidel style, a few times per step. The
+ * Lagrange multiplier of every spring is accumulated over the iterations, which makes the stiffness independent of the
+ * number of iterations and of the time step, so that the solver is stable at any time step.
+ * A step is split into Xpbd_predict, any number of Xpbd_project over all the springs, and Xpbd_finish. The springs of a
+ * color share no node, so that they can be projected in parallel.
+ **********************************************************************************************************************/
+typedef struct Xpbd{
+	/** The Lagrange multiplier of every spring, reset at every step. */
+	float* lambda;
+	/** The number of springs the array can hold. */
+	int capacity;
+} Xpbd;
+
+/***********************************************************************************************************************
+ * @brief Gives a newly initialized XPBD solver.
+
+ * @return the solver, nothing is allocated until the first step.
+ **********************************************************************************************************************/
+extern Xpbd Xpbd_init();
+
+/***********************************************************************************************************************
+ * @brief Starts a step: moves the free nodes in [begin, end) with the accelerations computed beforehand.
+
+ * The positions before the move are kept, as they give the velocities at the end of the step.
+
+ * @param nodes (Nodes*): a pointer to the node store.
+ * @param begin (int): the first node.
+ * @param end (int): one past the last node.
+ * @param dt (float): the time step, in seconds.
+ * @param drag (float): the factor applied to the velocities.
+ **********************************************************************************************************************/
+extern void Xpbd_predict(Nodes* nodes, int begin, int end, float dt, float drag);
+
+/***********************************************************************************************************************
+ * @brief Resets the Lagrange multipliers of the springs, before the first projection of a step.
+
+ * @param xpbd (Xpbd*): a pointer to the solver.
+ * @param count (int): the number of springs.
+
+ * @return a char, non zero if the memory could not be allocated.
+ **********************************************************************************************************************/
+extern char Xpbd_reset(Xpbd* xpbd, int count);
+
+/***********************************************************************************************************************
+ * @brief Projects the nodes onto the constraints of the springs in [begin, end), once.
+
+ * The damping of the springs is applied to the relative motion of their ends since the start of the step.
+
+ * @param xpbd (Xpbd*): a pointer to the solver.
+ * @param nodes (Nodes*): a pointer to the node store.
+ * @param springs (const Springs*): a pointer to the list of springs.
+ * @param begin (int): the first spring.
+ * @param end (int): one past the last spring.
+ * @param dt (float): the time step, in seconds.
+ * @param K (float): the stiffness of the springs, giving their compliance, unless they have materials of their own.
+ * @param Kd (float): the damping of the springs, unless they have materials of their own.
+ * @param L0 (float): the rest length of the springs, unless they have materials of their own.
+ **********************************************************************************************************************/
+extern void Xpbd_project(Xpbd* xpbd, Nodes* nodes, const Springs* springs, int begin, int end, float dt, float K,
+		float Kd, float L0);
+
+/***********************************************************************************************************************
+ * @brief Ends a step: gives the free nodes in [begin, end) the velocity of their move, and bounces them on the walls of
+ * a w x h box.
+
+ * @param nodes (Nodes*): a pointer to the node store.
+ * @param begin (int): the first node.
+ * @param end (int): one past the last node.
+ * @param dt (float): the time step, in seconds.
+ * @param w (float): the width of the box.
+ * @param h (float): the height of the box.
+ **********************************************************************************************************************/
+extern void Xpbd_finish(Nodes* nodes, int begin, int end, float dt, float w, float h);
+
+/***********************************************************************************************************************
+ * @brief Releases the memory held by an XPBD solver.
+
+ * @param xpbd (Xpbd*): a pointer to the solver.
+ **********************************************************************************************************************/
+extern void Xpbd_free(Xpbd* xpbd);
+
+#endif
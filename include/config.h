@@ -36,6 +36,44 @@
 ######################################################################################################################*/
 #define MAX_FPS 30
 #define TICKS_PER_FRAME 1000/MAX_FPS
+// the time between two lines of frame statistics, in seconds.
+#define STATS_PERIOD    1.
+
+/*######################################################################################################################
+## RENDERING INFORMATIONS ##############################################################################################
+######################################################################################################################*/
+// the color of the background, as 0xAARRGGBB, and the number of threads of the software rasterizer, 0 meaning one per
+// core of the processor.
+#define BACKGROUND_COLOR 0xff333333u
+#define RASTER_THREADS   0
+// the number of frames that can wait to be exported, and the number of threads writing them.
+#define EXPORT_FRAMES    16
+#define EXPORT_THREADS   2
+// the size of the nodes in the world, and the width of the springs in pixels.
+#define NODE_SIZE     20
+#define SPRING_WIDTH  1
+// the factor the zoom changes by for every notch of the mouse wheel.
+#define ZOOM_STEP     1.25f
+// the zoom, in pixels per unit of the world, below which the springs shorter than a pixel are left out and the nodes
+// are drawn as a density map of cells of DENSITY_CELL pixels.
+#define LOD_ZOOM      0.25f
+#define DENSITY_CELL  4
+// the distance from the mouse within which the nodes are hovered and grabbed, in pixels, and the largest number of
+// nodes highlighted at once.
+#define PICK_RADIUS   20
+#define PICK_MAX      4096
+
+/*######################################################################################################################
+## PHYSICS INFORMATIONS ################################################################################################
+######################################################################################################################*/
+// with the adaptive steps, the physics is stepped once per frame and the simulation splits the step only when it has
+// to, otherwise every frame runs a fixed number of smaller steps.
+#define PHYSICS_ADAPTIVE    1
+#define PHYSICS_SUBSTEPS    (PHYSICS_ADAPTIVE?1:4)
+#define PHYSICS_DT          (1./(MAX_FPS*PHYSICS_SUBSTEPS))
+#define PHYSICS_MAX_CATCHUP 4
+#define PHYSICS_MAX_STEPS   (PHYSICS_SUBSTEPS*PHYSICS_MAX_CATCHUP)
+#define PHYSICS_THREADS     0
 
 /*######################################################################################################################
 ## AUDIO INFORMATIONS ##################################################################################################
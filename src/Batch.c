@@ -0,0 +1,365 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "Batch.h"
+
+#if !SDL_VERSION_ATLEAST(2, 0, 18)
+#error "the batched renderer needs SDL_RenderGeometry, i.e. SDL 2.0.18 or newer"
+#endif
+
+/* Gives room for a given number of extra quads, growing the arrays geometrically. */
+static char grow(Batch* batch, int extra){
+	int needed = batch->count + extra;
+	if (needed <= batch->capacity){
+		return 0;
+	}
+	int capacity = (batch->capacity < 64)?64:batch->capacity;
+	while (capacity < needed){
+		capacity *= 2;
+	}
+	return Batch_reserve(batch, capacity);
+}
+
+/* Computes 255*exp(-length/300) for every spring. exp is replaced by a power of two, whose integer part goes straight
+ * into the exponent bits of a float and whose fractional part is a polynomial, so that the loop has no call and no
+ * branch and the compiler vectorizes it. The error stays below half a level of brightness. */
+static void shade_springs(const float* length, float* shade, int count){
+	const float scale = 1.f/(300*0.6931472f);
+	for (int s = 0; s < count; s++){
+		float u = length[s]*scale;
+		u = (u < 0)?0:u;
+		u = (u > 24)?24:u;
+		int integer = (int)u;
+		float f = u - integer;
+		float fraction = 1 + f*(-0.6931472f + f*(0.2402265f + f*(-0.0555041f + f*0.0096181f)));
+		uint32_t bits = (uint32_t)(127 - integer) << 23;
+		float power;
+		memcpy(&power, &bits, sizeof(float));
+		shade[s] = 255*fraction*power;
+	}
+}
+
+static inline void set_vertex(SDL_Vertex* vertex, float x, float y, Uint8 r, Uint8 g, Uint8 b){
+	vertex->position.x = x;
+	vertex->position.y = y;
+	vertex->color.r = r;
+	vertex->color.g = g;
+	vertex->color.b = b;
+	vertex->color.a = 0xff;
+	vertex->tex_coord.x = 0;
+	vertex->tex_coord.y = 0;
+}
+
+Batch Batch_init(){
+	Batch batch = {NULL, NULL, NULL, NULL, NULL, 0, 0, 0, NULL, 0, Raster_init(), NULL, NULL};
+	return batch;
+}
+
+char Batch_use_raster(Batch* batch, SDL_Renderer* renderer, int width, int height, Uint32 background,
+		ThreadPool* pool){
+	SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width,
+			height);
+	if (texture == NULL){
+		fprintf(stderr, "Could not create the frame texture : %s\n", SDL_GetError());
+		return 1;
+	}
+	if (Raster_resize(&batch->raster, width, height, background)){
+		SDL_DestroyTexture(texture);
+		return 1;
+	}
+	if (batch->texture != NULL){
+		SDL_DestroyTexture(batch->texture);
+	}
+	batch->texture = texture;
+	batch->pool = pool;
+	return 0;
+}
+
+char Batch_reserve(Batch* batch, int capacity){
+	if (capacity <= batch->capacity){
+		return 0;
+	}
+	SDL_Vertex* vertices = realloc(batch->vertices, 4*capacity*sizeof(SDL_Vertex));
+	if (vertices == NULL){
+		return 1;
+	}
+	batch->vertices = vertices;
+	int* indices = realloc(batch->indices, 6*capacity*sizeof(int));
+	if (indices == NULL){
+		return 1;
+	}
+	batch->indices = indices;
+
+	// every quad is made of the triangles (0, 1, 2) and (0, 2, 3) of its corners.
+	for (int q = batch->capacity; q < capacity; q++){
+		indices[6*q+0] = 4*q+0;
+		indices[6*q+1] = 4*q+1;
+		indices[6*q+2] = 4*q+2;
+		indices[6*q+3] = 4*q+0;
+		indices[6*q+4] = 4*q+2;
+		indices[6*q+5] = 4*q+3;
+	}
+	batch->capacity = capacity;
+	return 0;
+}
+
+void Batch_clear(Batch* batch){
+	batch->count = 0;
+	Raster_clear(&batch->raster);
+}
+
+/* Gives the corners of a new quad, or NULL if the memory could not be allocated. The quads are only counted once they
+ * are known to be visible, so that the batch grows with what is on screen rather than with the scene. */
+static inline SDL_Vertex* add_quad(Batch* batch){
+	if (batch->count == batch->capacity && grow(batch, 1)){
+		return NULL;
+	}
+	return batch->vertices + 4*batch->count++;
+}
+
+static inline char overlap(BvhBox a, BvhBox b){
+	return a.min_x <= b.max_x && b.min_x <= a.max_x && a.min_y <= b.max_y && b.min_y <= a.max_y;
+}
+
+char Batch_add_springs(Batch* batch, const Springs* springs, const BvhBox* tiles, const int* bins,
+		const int* bin_offsets, int nb_bins, const float* x, const float* y, float width, float min_length,
+		const View* view){
+	if (springs->count > batch->shade_capacity){
+		int* visible = realloc(batch->visible, springs->count*sizeof(int));
+		if (visible != NULL){
+			batch->visible = visible;
+		}
+		float* length = realloc(batch->length, springs->count*sizeof(float));
+		if (length != NULL){
+			batch->length = length;
+		}
+		float* shade = realloc(batch->shade, springs->count*sizeof(float));
+		if (shade != NULL){
+			batch->shade = shade;
+		}
+		if (visible == NULL || length == NULL || shade == NULL){
+			return 1;
+		}
+		batch->shade_capacity = springs->count;
+	}
+
+	BvhBox bounds = View_bounds(view, width);
+	float zoom = view->zoom;
+	int count = 0;
+	for (int k = 0; k < nb_bins; k++){
+		// the springs of a bin lie in the union of the boxes of its two tiles.
+		BvhBox low = tiles[bins[2*k]];
+		BvhBox high = tiles[bins[2*k+1]];
+		BvhBox box = {(low.min_x < high.min_x)?low.min_x:high.min_x, (low.min_y < high.min_y)?low.min_y:high.min_y,
+				(low.max_x > high.max_x)?low.max_x:high.max_x, (low.max_y > high.max_y)?low.max_y:high.max_y};
+		if (!overlap(box, bounds)){
+			continue;
+		}
+		for (int s = bin_offsets[k]; s < bin_offsets[k+1]; s++){
+			int i = springs->a[s];
+			int j = springs->b[s];
+			// a spring is culled when both of its ends are past the same side of the window.
+			if ((x[i] < bounds.min_x && x[j] < bounds.min_x) || (x[i] > bounds.max_x && x[j] > bounds.max_x)
+					|| (y[i] < bounds.min_y && y[j] < bounds.min_y) || (y[i] > bounds.max_y && y[j] > bounds.max_y)){
+				continue;
+			}
+			float dx = x[i] - x[j];
+			float dy = y[i] - y[j];
+			float length = sqrtf(dx*dx + dy*dy);
+			if (length*zoom < min_length){
+				continue;
+			}
+			batch->visible[count] = s;
+			batch->length[count++] = length;
+		}
+	}
+	shade_springs(batch->length, batch->shade, count);
+
+	for (int v = 0; v < count; v++){
+		int s = batch->visible[v];
+		int i = springs->a[s];
+		int j = springs->b[s];
+		float xi = (x[i] - view->x)*zoom;
+		float yi = (y[i] - view->y)*zoom;
+		float xj = (x[j] - view->x)*zoom;
+		float yj = (y[j] - view->y)*zoom;
+		Uint8 c = batch->shade[v];
+		if (batch->texture != NULL){
+			if (Raster_line(&batch->raster, xi, yi, xj, yj, width, c << 16 | c << 8 | c)){
+				return 1;
+			}
+			continue;
+		}
+		SDL_Vertex* vertex = add_quad(batch);
+		if (vertex == NULL){
+			return 1;
+		}
+		// the normal to the spring, scaled to half its width.
+		float length = batch->length[v]*zoom;
+		float k = width/2 / ((length < 1)?1:length);
+		float nx = (yi - yj)*k;
+		float ny = (xj - xi)*k;
+		set_vertex(vertex+0, xi + nx, yi + ny, c, c, c);
+		set_vertex(vertex+1, xi - nx, yi - ny, c, c, c);
+		set_vertex(vertex+2, xj - nx, yj - ny, c, c, c);
+		set_vertex(vertex+3, xj + nx, yj + ny, c, c, c);
+	}
+	return 0;
+}
+
+/* Adds a square, or a disc with the rasterizer, centered on a pixel. */
+static inline char add_node(Batch* batch, float px, float py, float half, Uint8 r, Uint8 g, Uint8 b){
+	if (batch->texture != NULL){
+		return Raster_disc(&batch->raster, px, py, half, r << 16 | g << 8 | b);
+	}
+	SDL_Vertex* vertex = add_quad(batch);
+	if (vertex == NULL){
+		return 1;
+	}
+	set_vertex(vertex+0, px - half, py - half, r, g, b);
+	set_vertex(vertex+1, px + half, py - half, r, g, b);
+	set_vertex(vertex+2, px + half, py + half, r, g, b);
+	set_vertex(vertex+3, px - half, py + half, r, g, b);
+	return 0;
+}
+
+char Batch_add_nodes(Batch* batch, const Nodes* nodes, const BvhBox* tiles, int tile_size, const float* x,
+		const float* y, float size, const View* view){
+	float zoom = view->zoom;
+	float half = size*zoom/2;
+	BvhBox bounds = View_bounds(view, half);
+	for (int begin = 0, t = 0; begin < nodes->count; begin += tile_size, t++){
+		if (!overlap(tiles[t], bounds)){
+			continue;
+		}
+		int end = (begin + tile_size < nodes->count)?begin + tile_size:nodes->count;
+		for (int i = begin; i < end; i++){
+			if (x[i] < bounds.min_x || x[i] > bounds.max_x || y[i] < bounds.min_y || y[i] > bounds.max_y){
+				continue;
+			}
+			Uint8 g = Nodes_get_flag(nodes->locked, i)?0x00:0xff;
+			if (add_node(batch, (x[i] - view->x)*zoom, (y[i] - view->y)*zoom, half, 0xff, g, 0xff)){
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+char Batch_add_highlight(Batch* batch, const Nodes* nodes, const int* indices, int count, const float* x,
+		const float* y, float size, const View* view){
+	// the nodes stay visible however far the view is zoomed out.
+	float half = size*view->zoom/2;
+	half = (half < 2)?2:half;
+	for (int k = 0; k < count; k++){
+		int i = indices[k];
+		Uint8 g = Nodes_get_flag(nodes->locked, i)?0x00:0xff;
+		if (add_node(batch, (x[i] - view->x)*view->zoom, (y[i] - view->y)*view->zoom, half, 0xff, g, 0x00)){
+			return 1;
+		}
+	}
+	return 0;
+}
+
+char Batch_add_density(Batch* batch, const Nodes* nodes, const BvhBox* tiles, int tile_size, const float* x,
+		const float* y, int cell, const View* view){
+	int columns = ((int)view->width + cell-1)/cell;
+	int rows = ((int)view->height + cell-1)/cell;
+	if (columns*rows > batch->density_capacity){
+		int* density = realloc(batch->density, columns*rows*sizeof(int));
+		if (density == NULL){
+			return 1;
+		}
+		batch->density = density;
+		batch->density_capacity = columns*rows;
+	}
+	memset(batch->density, 0, columns*rows*sizeof(int));
+
+	// the nodes are counted in the cell of the window they fall in.
+	float zoom = view->zoom / cell;
+	BvhBox bounds = View_bounds(view, 0);
+	for (int begin = 0, t = 0; begin < nodes->count; begin += tile_size, t++){
+		if (!overlap(tiles[t], bounds)){
+			continue;
+		}
+		int end = (begin + tile_size < nodes->count)?begin + tile_size:nodes->count;
+		for (int i = begin; i < end; i++){
+			float column = (x[i] - view->x)*zoom;
+			float row = (y[i] - view->y)*zoom;
+			if (column >= 0 && column < columns && row >= 0 && row < rows){
+				batch->density[(int)row*columns + (int)column]++;
+			}
+		}
+	}
+
+	// every cell holding nodes is one square, the brighter the more nodes it holds.
+	for (int r = 0; r < rows; r++){
+		for (int c = 0; c < columns; c++){
+			int count = batch->density[r*columns + c];
+			if (count == 0){
+				continue;
+			}
+			Uint8 shade = 255 - 764/(count+3);
+			float left = c*cell;
+			float top = r*cell;
+			if (batch->texture != NULL){
+				if (Raster_disc(&batch->raster, left + cell/2.f, top + cell/2.f, cell/2.f,
+						shade << 16 | shade << 8 | shade)){
+					return 1;
+				}
+				continue;
+			}
+			SDL_Vertex* vertex = add_quad(batch);
+			if (vertex == NULL){
+				return 1;
+			}
+			set_vertex(vertex+0, left, top, shade, shade, shade);
+			set_vertex(vertex+1, left + cell, top, shade, shade, shade);
+			set_vertex(vertex+2, left + cell, top + cell, shade, shade, shade);
+			set_vertex(vertex+3, left, top + cell, shade, shade, shade);
+		}
+	}
+	return 0;
+}
+
+char Batch_render(Batch* batch, SDL_Renderer* renderer){
+	if (batch->texture != NULL){
+		// the whole frame is drawn on the processor and uploaded at once.
+		Raster* raster = &batch->raster;
+		if (Raster_draw(raster, batch->pool)){
+			fprintf(stderr, "Could not bin the shapes of the frame.\n");
+			return 1;
+		}
+		if (SDL_UpdateTexture(batch->texture, NULL, raster->pixels, raster->width*sizeof(Uint32)) < 0
+				|| SDL_RenderCopy(renderer, batch->texture, NULL, NULL) < 0){
+			fprintf(stderr, "Could not render the frame : %s\n", SDL_GetError());
+			return 1;
+		}
+		return 0;
+	}
+	if (batch->count == 0){
+		return 0;
+	}
+	if (SDL_RenderGeometry(renderer, NULL, batch->vertices, 4*batch->count, batch->indices, 6*batch->count) < 0){
+		fprintf(stderr, "Could not render the frame : %s\n", SDL_GetError());
+		return 1;
+	}
+	return 0;
+}
+
+void Batch_free(Batch* batch){
+	free(batch->vertices);
+	free(batch->indices);
+	free(batch->visible);
+	free(batch->length);
+	free(batch->shade);
+	free(batch->density);
+	Raster_free(&batch->raster);
+	if (batch->texture != NULL){
+		SDL_DestroyTexture(batch->texture);
+	}
+	*batch = Batch_init();
+}
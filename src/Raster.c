@@ -0,0 +1,293 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "Raster.h"
+
+Raster Raster_init(){
+	Raster raster;
+	memset(&raster, 0, sizeof(Raster));
+	return raster;
+}
+
+char Raster_resize(Raster* raster, int width, int height, uint32_t background){
+	int columns = (width + RASTER_TILE-1)/RASTER_TILE;
+	int rows = (height + RASTER_TILE-1)/RASTER_TILE;
+	uint32_t* pixels = realloc(raster->pixels, (size_t)width*height*sizeof(uint32_t));
+	if (pixels == NULL){
+		return 1;
+	}
+	raster->pixels = pixels;
+	int* offsets = realloc(raster->offsets, (columns*rows+1)*sizeof(int));
+	if (offsets == NULL){
+		return 1;
+	}
+	raster->offsets = offsets;
+	raster->width = width;
+	raster->height = height;
+	raster->columns = columns;
+	raster->rows = rows;
+	raster->background = background;
+	return 0;
+}
+
+void Raster_clear(Raster* raster){
+	raster->count = 0;
+}
+
+/* Adds a shape, growing the array geometrically. */
+static char push(Raster* raster, RasterShape shape){
+	if (raster->count == raster->capacity){
+		int capacity = (raster->capacity < 64)?64:2*raster->capacity;
+		RasterShape* shapes = realloc(raster->shapes, capacity*sizeof(RasterShape));
+		if (shapes == NULL){
+			return 1;
+		}
+		raster->shapes = shapes;
+		raster->capacity = capacity;
+	}
+	raster->shapes[raster->count++] = shape;
+	return 0;
+}
+
+char Raster_line(Raster* raster, float x0, float y0, float x1, float y1, float width, uint32_t color){
+	RasterShape shape = {x0, y0, x1, y1, width/2, color};
+	return push(raster, shape);
+}
+
+char Raster_disc(Raster* raster, float x, float y, float radius, uint32_t color){
+	RasterShape shape = {x, y, x, y, radius, color};
+	return push(raster, shape);
+}
+
+/* Gives the distance from a point to the segment of a shape. */
+static inline float distance(const RasterShape* shape, float x, float y){
+	float ex = shape->x1 - shape->x0;
+	float ey = shape->y1 - shape->y0;
+	float length2 = ex*ex + ey*ey;
+	float dx = x - shape->x0;
+	float dy = y - shape->y0;
+	float t = (length2 > 0)?(dx*ex + dy*ey)/length2:0;
+	t = (t < 0)?0:(t > 1)?1:t;
+	dx -= t*ex;
+	dy -= t*ey;
+	return sqrtf(dx*dx + dy*dy);
+}
+
+/* Gives the range of tiles the bounding box of a shape touches, clamped to the framebuffer, or 0 if it is outside. */
+static inline char span(const Raster* raster, const RasterShape* shape, int* c0, int* r0, int* c1, int* r1){
+	// half a pixel more than the radius, for the antialiased edge.
+	float reach = shape->radius + 0.5f;
+	float min_x = ((shape->x0 < shape->x1)?shape->x0:shape->x1) - reach;
+	float max_x = ((shape->x0 > shape->x1)?shape->x0:shape->x1) + reach;
+	float min_y = ((shape->y0 < shape->y1)?shape->y0:shape->y1) - reach;
+	float max_y = ((shape->y0 > shape->y1)?shape->y0:shape->y1) + reach;
+	if (!(max_x >= 0 && max_y >= 0 && min_x < raster->width && min_y < raster->height)){
+		return 0;
+	}
+	*c0 = (min_x < 0)?0:(int)min_x/RASTER_TILE;
+	*r0 = (min_y < 0)?0:(int)min_y/RASTER_TILE;
+	*c1 = (max_x >= raster->width)?raster->columns-1:(int)max_x/RASTER_TILE;
+	*r1 = (max_y >= raster->height)?raster->rows-1:(int)max_y/RASTER_TILE;
+	return 1;
+}
+
+/* Tells whether a shape may touch a tile, i.e. whether its segment comes closer to the center of the tile than half its
+ * diagonal plus the reach of the shape, which keeps the long diagonal lines out of most of the tiles of their box. */
+static inline char touches(const RasterShape* shape, int column, int row){
+	float half = RASTER_TILE/2.f;
+	return distance(shape, column*RASTER_TILE + half, row*RASTER_TILE + half) <= half*1.4143f + shape->radius + 0.5f;
+}
+
+/* Blends a color over a row of pixels, given the coverage of every pixel. */
+static inline void blend(uint32_t* row, const float* coverage, int n, uint32_t color){
+	int sr = (color >> 16) & 0xff;
+	int sg = (color >> 8) & 0xff;
+	int sb = color & 0xff;
+	for (int i = 0; i < n; i++){
+		int w = (int)(coverage[i]*256);
+		uint32_t pixel = row[i];
+		int r = (pixel >> 16) & 0xff;
+		int g = (pixel >> 8) & 0xff;
+		int b = pixel & 0xff;
+		r += ((sr - r)*w) >> 8;
+		g += ((sg - g)*w) >> 8;
+		b += ((sb - b)*w) >> 8;
+		row[i] = (pixel & 0xff000000) | (uint32_t)r << 16 | (uint32_t)g << 8 | (uint32_t)b;
+	}
+}
+
+/* Computes the coverage of the pixels x0 to x1-1 of a row by a shape: the reach of the shape minus the distance from the
+ * center of the pixel to the segment, clamped to [0, 1]. dy is the height of the center of the row above the first end
+ * of the segment, (ex, ey) the segment and inverse the inverse of its squared length. With SSE2, the pixels are done 4 at
+ * a time, up to 3 past x1, which the coverage array has room for. */
+static inline void cover(float* coverage, const RasterShape* shape, int x0, int x1, float dy, float ex, float ey,
+		float inverse, float reach){
+	int x = x0;
+#if defined(__SSE2__)
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1);
+	const __m128 vex = _mm_set1_ps(ex);
+	const __m128 vey = _mm_set1_ps(ey);
+	const __m128 vdy = _mm_set1_ps(dy);
+	const __m128 vinverse = _mm_set1_ps(inverse);
+	const __m128 vreach = _mm_set1_ps(reach);
+	__m128 dx = _mm_add_ps(_mm_set1_ps(x0 + 0.5f - shape->x0), _mm_set_ps(3, 2, 1, 0));
+	for (; x < x1; x += 4){
+		__m128 s = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(dx, vex), _mm_mul_ps(vdy, vey)), vinverse);
+		s = _mm_min_ps(_mm_max_ps(s, zero), one);
+		__m128 px = _mm_sub_ps(dx, _mm_mul_ps(s, vex));
+		__m128 py = _mm_sub_ps(vdy, _mm_mul_ps(s, vey));
+		__m128 c = _mm_sub_ps(vreach, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(py, py))));
+		_mm_storeu_ps(coverage + x - x0, _mm_min_ps(_mm_max_ps(c, zero), one));
+		dx = _mm_add_ps(dx, _mm_set1_ps(4));
+	}
+#endif
+	for (; x < x1; x++){
+		float dx = x + 0.5f - shape->x0;
+		float s = (dx*ex + dy*ey)*inverse;
+		s = (s < 0)?0:(s > 1)?1:s;
+		float px = dx - s*ex;
+		float py = dy - s*ey;
+		float c = reach - sqrtf(px*px + py*py);
+		coverage[x - x0] = (c < 0)?0:(c > 1)?1:c;
+	}
+}
+
+/* Clears and draws the tiles [begin, end). */
+static void draw_tiles(void* context, int begin, int end, int thread){
+	(void)thread;
+	Raster* raster = context;
+	float coverage[RASTER_TILE+4];
+	for (int t = begin; t < end; t++){
+		int tile_x = (t % raster->columns)*RASTER_TILE;
+		int tile_y = (t / raster->columns)*RASTER_TILE;
+		int tile_w = (tile_x + RASTER_TILE < raster->width)?RASTER_TILE:raster->width - tile_x;
+		int tile_h = (tile_y + RASTER_TILE < raster->height)?RASTER_TILE:raster->height - tile_y;
+		for (int y = tile_y; y < tile_y + tile_h; y++){
+			uint32_t* row = raster->pixels + (size_t)y*raster->width + tile_x;
+			for (int x = 0; x < tile_w; x++){
+				row[x] = raster->background;
+			}
+		}
+
+		for (int k = raster->offsets[t]; k < raster->offsets[t+1]; k++){
+			const RasterShape* shape = &raster->shapes[raster->bins[k]];
+			float reach = shape->radius + 0.5f;
+			// the pixels of the tile inside the bounding box of the shape.
+			int x0 = (int)floorf(((shape->x0 < shape->x1)?shape->x0:shape->x1) - reach);
+			int x1 = (int)ceilf(((shape->x0 > shape->x1)?shape->x0:shape->x1) + reach);
+			int y0 = (int)floorf(((shape->y0 < shape->y1)?shape->y0:shape->y1) - reach);
+			int y1 = (int)ceilf(((shape->y0 > shape->y1)?shape->y0:shape->y1) + reach);
+			x0 = (x0 < tile_x)?tile_x:x0;
+			y0 = (y0 < tile_y)?tile_y:y0;
+			x1 = (x1 > tile_x + tile_w)?tile_x + tile_w:x1;
+			y1 = (y1 > tile_y + tile_h)?tile_y + tile_h:y1;
+
+			float ex = shape->x1 - shape->x0;
+			float ey = shape->y1 - shape->y0;
+			float length2 = ex*ex + ey*ey;
+			float inverse = (length2 > 0)?1/length2:0;
+			for (int y = y0; y < y1; y++){
+				float dy = y + 0.5f - shape->y0;
+				// the part of the segment within reach of the row, vertically, bounds the pixels the shape covers,
+				// which keeps the steep lines from going over the whole width of their box.
+				int start = x0;
+				int stop = x1;
+				if (ey != 0){
+					float s0 = (dy - reach)/ey;
+					float s1 = (dy + reach)/ey;
+					float low = (s0 < s1)?s0:s1;
+					float high = (s0 < s1)?s1:s0;
+					low = (low < 0)?0:low;
+					high = (high > 1)?1:high;
+					float a = shape->x0 + low*ex;
+					float b = shape->x0 + high*ex;
+					int left = (int)floorf(((a < b)?a:b) - reach);
+					int right = (int)ceilf(((a < b)?b:a) + reach);
+					start = (left > x0)?left:x0;
+					stop = (right < x1)?right:x1;
+				}
+				if (start >= stop){
+					continue;
+				}
+				cover(coverage, shape, start, stop, dy, ex, ey, inverse, reach);
+				blend(raster->pixels + (size_t)y*raster->width + start, coverage, stop - start, shape->color);
+			}
+		}
+	}
+}
+
+char Raster_draw(Raster* raster, ThreadPool* pool){
+	int nb_tiles = raster->columns*raster->rows;
+	int* offsets = raster->offsets;
+	char failed = 0;
+	if (nb_tiles == 0){
+		return 0;
+	}
+
+	// counting sort of the shapes by tile: first the number of shapes of every tile...
+	memset(offsets, 0, (nb_tiles+1)*sizeof(int));
+	for (int s = 0; s < raster->count; s++){
+		const RasterShape* shape = &raster->shapes[s];
+		int c0, r0, c1, r1;
+		if (span(raster, shape, &c0, &r0, &c1, &r1)){
+			for (int r = r0; r <= r1; r++){
+				for (int c = c0; c <= c1; c++){
+					offsets[r*raster->columns + c + 1] += touches(shape, c, r);
+				}
+			}
+		}
+	}
+	// ... then the start of every bin...
+	for (int t = 0; t < nb_tiles; t++){
+		offsets[t+1] += offsets[t];
+	}
+	if (offsets[nb_tiles] > raster->bin_capacity){
+		int* bins = realloc(raster->bins, offsets[nb_tiles]*sizeof(int));
+		if (bins == NULL){
+			failed = 1;
+		} else {
+			raster->bins = bins;
+			raster->bin_capacity = offsets[nb_tiles];
+		}
+	}
+	if (failed){
+		// the framebuffer is still cleared, with every bin empty.
+		memset(offsets, 0, (nb_tiles+1)*sizeof(int));
+	} else {
+		// ... and finally the bins themselves, in the order of the shapes, using offsets[t] as a cursor that ends up
+		// on the start of bin t+1.
+		for (int s = 0; s < raster->count; s++){
+			const RasterShape* shape = &raster->shapes[s];
+			int c0, r0, c1, r1;
+			if (span(raster, shape, &c0, &r0, &c1, &r1)){
+				for (int r = r0; r <= r1; r++){
+					for (int c = c0; c <= c1; c++){
+						if (touches(shape, c, r)){
+							raster->bins[offsets[r*raster->columns + c]++] = s;
+						}
+					}
+				}
+			}
+		}
+		for (int t = nb_tiles; t > 0; t--){
+			offsets[t] = offsets[t-1];
+		}
+		offsets[0] = 0;
+	}
+
+	ThreadPool_parallel_for(pool, 0, nb_tiles, 1, draw_tiles, raster);
+	return failed;
+}
+
+void Raster_free(Raster* raster){
+	free(raster->pixels);
+	free(raster->shapes);
+	free(raster->offsets);
+	free(raster->bins);
+	*raster = Raster_init();
+}
@@ -0,0 +1,33 @@
+#include "View.h"
+
+View View_fit(float world_w, float world_h, float width, float height){
+	float zoom_x = width / ((world_w > 0)?world_w:width);
+	float zoom_y = height / ((world_h > 0)?world_h:height);
+	float zoom = (zoom_x < zoom_y)?zoom_x:zoom_y;
+	// the box is centered along the axis it does not fill.
+	View view = {(world_w - width/zoom)/2, (world_h - height/zoom)/2, zoom, width, height, zoom/VIEW_ZOOM_RANGE,
+			zoom*VIEW_ZOOM_RANGE};
+	return view;
+}
+
+void View_zoom(View* view, float factor, float pixel_x, float pixel_y){
+	float x = view->x + pixel_x/view->zoom;
+	float y = view->y + pixel_y/view->zoom;
+	float zoom = view->zoom * factor;
+	view->zoom = (zoom < view->min_zoom)?view->min_zoom:(zoom > view->max_zoom)?view->max_zoom:zoom;
+	view->x = x - pixel_x/view->zoom;
+	view->y = y - pixel_y/view->zoom;
+}
+
+void View_pan(View* view, float dx, float dy){
+	view->x -= dx/view->zoom;
+	view->y -= dy/view->zoom;
+}
+
+BvhBox View_bounds(const View* view, float margin){
+	BvhBox box = {
+		view->x - margin/view->zoom, view->y - margin/view->zoom,
+		view->x + (view->width + margin)/view->zoom, view->y + (view->height + margin)/view->zoom
+	};
+	return box;
+}
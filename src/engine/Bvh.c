@@ -0,0 +1,331 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "Bvh.h"
+
+Bvh Bvh_init(float fatten){
+	Bvh bvh;
+	memset(&bvh, 0, sizeof(Bvh));
+	bvh.root = -1;
+	bvh.free_list = -1;
+	bvh.fatten = fatten;
+	return bvh;
+}
+
+/* Chains the nodes from first to the end of the array into the free list. */
+static void chain(Bvh* bvh, int first){
+	for (int i = first; i < bvh->capacity; i++){
+		bvh->nodes[i].parent = (i+1 < bvh->capacity)?i+1:-1;
+		bvh->nodes[i].height = -1;
+	}
+	bvh->free_list = (first < bvh->capacity)?first:-1;
+}
+
+void Bvh_clear(Bvh* bvh){
+	bvh->root = -1;
+	bvh->nb_leaves = 0;
+	bvh->nb_pairs = 0;
+	chain(bvh, 0);
+}
+
+/* Takes a node from the free list, growing the array if it is empty. */
+static int allocate(Bvh* bvh){
+	int node = bvh->free_list;
+	if (node == -1){
+		int capacity = (bvh->capacity > 0)?2*bvh->capacity:16;
+		BvhNode* nodes = realloc(bvh->nodes, capacity*sizeof(BvhNode));
+		if (nodes == NULL){
+			return -1;
+		}
+		bvh->nodes = nodes;
+		node = bvh->capacity;
+		bvh->capacity = capacity;
+		chain(bvh, node+1);
+	} else {
+		bvh->free_list = bvh->nodes[node].parent;
+	}
+	bvh->nodes[node].parent = -1;
+	bvh->nodes[node].left = -1;
+	bvh->nodes[node].right = -1;
+	bvh->nodes[node].height = 0;
+	bvh->nodes[node].listed = 0;
+	return node;
+}
+
+static void release(Bvh* bvh, int node){
+	bvh->nodes[node].parent = bvh->free_list;
+	bvh->nodes[node].height = -1;
+	bvh->free_list = node;
+}
+
+static inline BvhBox merge(BvhBox a, BvhBox b){
+	BvhBox box = {
+		(a.min_x < b.min_x)?a.min_x:b.min_x, (a.min_y < b.min_y)?a.min_y:b.min_y,
+		(a.max_x > b.max_x)?a.max_x:b.max_x, (a.max_y > b.max_y)?a.max_y:b.max_y
+	};
+	return box;
+}
+
+/* The cost of a box in the tree is its perimeter, which is how likely a query is to have to open it. */
+static inline float perimeter(BvhBox box){
+	return 2*((box.max_x - box.min_x) + (box.max_y - box.min_y));
+}
+
+static inline char overlap(BvhBox a, BvhBox b){
+	return a.min_x <= b.max_x && b.min_x <= a.max_x && a.min_y <= b.max_y && b.min_y <= a.max_y;
+}
+
+static inline char contains(BvhBox outer, BvhBox inner){
+	return outer.min_x <= inner.min_x && outer.min_y <= inner.min_y && outer.max_x >= inner.max_x
+			&& outer.max_y >= inner.max_y;
+}
+
+/* Recomputes the box and the height of an internal node from its children. */
+static void refit(Bvh* bvh, int node){
+	BvhNode* n = &bvh->nodes[node];
+	BvhNode* left = &bvh->nodes[n->left];
+	BvhNode* right = &bvh->nodes[n->right];
+	n->box = merge(left->box, right->box);
+	n->height = 1 + ((left->height > right->height)?left->height:right->height);
+}
+
+/* Replaces a child of a node, or the root if the node is -1. */
+static void replace(Bvh* bvh, int parent, int child, int by){
+	if (parent == -1){
+		bvh->root = by;
+	} else if (bvh->nodes[parent].left == child){
+		bvh->nodes[parent].left = by;
+	} else {
+		bvh->nodes[parent].right = by;
+	}
+	bvh->nodes[by].parent = parent;
+}
+
+/* Rotates the higher child of a node above it if the heights of its children differ by more than one, and gives the
+ * node now at its place. */
+static int balance(Bvh* bvh, int a){
+	BvhNode* nodes = bvh->nodes;
+	if (nodes[a].height < 2){
+		return a;
+	}
+	int b = nodes[a].left;
+	int c = nodes[a].right;
+	int difference = nodes[c].height - nodes[b].height;
+	if (difference >= -1 && difference <= 1){
+		return a;
+	}
+	// the higher child takes the place of a, which takes the place of the higher of its own children.
+	int up = (difference > 0)?c:b;
+	int other = (difference > 0)?b:c;
+	int f = nodes[up].left;
+	int g = nodes[up].right;
+	int high = (nodes[f].height > nodes[g].height)?f:g;
+	int low = (high == f)?g:f;
+
+	replace(bvh, nodes[a].parent, a, up);
+	nodes[up].left = a;
+	nodes[up].right = high;
+	nodes[a].parent = up;
+	nodes[high].parent = up;
+	nodes[a].left = other;
+	nodes[a].right = low;
+	nodes[low].parent = a;
+	refit(bvh, a);
+	refit(bvh, up);
+	return up;
+}
+
+/* Walks from a node up to the root, balancing and refitting every node on the way. */
+static void climb(Bvh* bvh, int node){
+	while (node != -1){
+		node = balance(bvh, node);
+		refit(bvh, node);
+		node = bvh->nodes[node].parent;
+	}
+}
+
+/* Puts a leaf into the tree, next to the sibling whose box grows the total perimeter of the tree the least. */
+static char insert_leaf(Bvh* bvh, int leaf){
+	if (bvh->root == -1){
+		bvh->root = leaf;
+		bvh->nodes[leaf].parent = -1;
+		return 0;
+	}
+	BvhBox box = bvh->nodes[leaf].box;
+	int sibling = bvh->root;
+	while (bvh->nodes[sibling].height > 0){
+		BvhNode* node = &bvh->nodes[sibling];
+		float combined = perimeter(merge(node->box, box));
+		// pairing the leaf with this node adds a parent of perimeter combined, going down grows this node instead.
+		float cost = 2*combined;
+		float inherited = 2*(combined - perimeter(node->box));
+		float costs[2];
+		int children[2] = {node->left, node->right};
+		for (int k = 0; k < 2; k++){
+			BvhNode* child = &bvh->nodes[children[k]];
+			float grown = perimeter(merge(child->box, box));
+			costs[k] = inherited + ((child->height == 0)?grown:grown - perimeter(child->box));
+		}
+		if (cost < costs[0] && cost < costs[1]){
+			break;
+		}
+		sibling = (costs[0] < costs[1])?children[0]:children[1];
+	}
+
+	int parent = allocate(bvh);
+	if (parent == -1){
+		return 1;
+	}
+	replace(bvh, bvh->nodes[sibling].parent, sibling, parent);
+	bvh->nodes[parent].left = sibling;
+	bvh->nodes[parent].right = leaf;
+	bvh->nodes[sibling].parent = parent;
+	bvh->nodes[leaf].parent = parent;
+	climb(bvh, parent);
+	return 0;
+}
+
+/* Takes a leaf out of the tree, its sibling taking the place of their parent. */
+static void remove_leaf(Bvh* bvh, int leaf){
+	if (leaf == bvh->root){
+		bvh->root = -1;
+		return;
+	}
+	int parent = bvh->nodes[leaf].parent;
+	int sibling = (bvh->nodes[parent].left == leaf)?bvh->nodes[parent].right:bvh->nodes[parent].left;
+	int grand_parent = bvh->nodes[parent].parent;
+	replace(bvh, grand_parent, parent, sibling);
+	release(bvh, parent);
+	climb(bvh, grand_parent);
+}
+
+static BvhBox fatten(const Bvh* bvh, BvhBox box){
+	BvhBox fat = {box.min_x - bvh->fatten, box.min_y - bvh->fatten, box.max_x + bvh->fatten, box.max_y + bvh->fatten};
+	return fat;
+}
+
+int Bvh_insert(Bvh* bvh, BvhBox box, int user){
+	int leaf = allocate(bvh);
+	if (leaf == -1){
+		return -1;
+	}
+	bvh->nodes[leaf].box = fatten(bvh, box);
+	bvh->nodes[leaf].user = user;
+	if (insert_leaf(bvh, leaf)){
+		release(bvh, leaf);
+		return -1;
+	}
+	bvh->nb_leaves++;
+	return leaf;
+}
+
+void Bvh_remove(Bvh* bvh, int leaf){
+	remove_leaf(bvh, leaf);
+	release(bvh, leaf);
+	bvh->nb_leaves--;
+}
+
+char Bvh_move(Bvh* bvh, int leaf, BvhBox box){
+	if (contains(bvh->nodes[leaf].box, box)){
+		return 0;
+	}
+	// the parent released by the removal is the one taken back by the insertion, so nothing is allocated.
+	remove_leaf(bvh, leaf);
+	bvh->nodes[leaf].box = fatten(bvh, box);
+	insert_leaf(bvh, leaf);
+	return 1;
+}
+
+int Bvh_query(const Bvh* bvh, BvhBox box, int* found, int max_found){
+	int stack[2*BVH_MAX_HEIGHT];
+	int top = 0;
+	int nb_found = 0;
+	if (bvh->root != -1){
+		stack[top++] = bvh->root;
+	}
+	while (top > 0){
+		const BvhNode* node = &bvh->nodes[stack[--top]];
+		if (!overlap(node->box, box)){
+			continue;
+		}
+		if (node->height == 0){
+			if (nb_found < max_found){
+				found[nb_found] = node->user;
+			}
+			nb_found++;
+		} else {
+			stack[top++] = node->left;
+			stack[top++] = node->right;
+		}
+	}
+	return nb_found;
+}
+
+/* Finds the pairs of a leaf, skipping the listed leaves before it, which find the pair themselves. */
+static char find_pairs(Bvh* bvh, int leaf){
+	int stack[2*BVH_MAX_HEIGHT];
+	BvhBox box = bvh->nodes[leaf].box;
+	int top = 0;
+	stack[top++] = bvh->root;
+	while (top > 0){
+		int index = stack[--top];
+		const BvhNode* node = &bvh->nodes[index];
+		if (!overlap(node->box, box)){
+			continue;
+		}
+		if (node->height > 0){
+			stack[top++] = node->left;
+			stack[top++] = node->right;
+			continue;
+		}
+		if (index == leaf || (node->listed && index < leaf)){
+			continue;
+		}
+		if (bvh->nb_pairs == bvh->pairs_capacity){
+			int capacity = (bvh->pairs_capacity > 0)?2*bvh->pairs_capacity:64;
+			int* pairs = realloc(bvh->pairs, 2*capacity*sizeof(int));
+			if (pairs == NULL){
+				return 1;
+			}
+			bvh->pairs = pairs;
+			bvh->pairs_capacity = capacity;
+		}
+		bvh->pairs[2*bvh->nb_pairs] = bvh->nodes[leaf].user;
+		bvh->pairs[2*bvh->nb_pairs+1] = node->user;
+		bvh->nb_pairs++;
+	}
+	return 0;
+}
+
+char Bvh_find_pairs(Bvh* bvh, const int* leaves, int nb_leaves){
+	char failed = 0;
+	bvh->nb_pairs = 0;
+	if (leaves == NULL){
+		for (int leaf = 0; leaf < bvh->capacity; leaf++){
+			bvh->nodes[leaf].listed = bvh->nodes[leaf].height == 0;
+		}
+		for (int leaf = 0; leaf < bvh->capacity && !failed; leaf++){
+			failed = bvh->nodes[leaf].listed && find_pairs(bvh, leaf);
+		}
+		for (int leaf = 0; leaf < bvh->capacity; leaf++){
+			bvh->nodes[leaf].listed = 0;
+		}
+		return failed;
+	}
+	for (int l = 0; l < nb_leaves; l++){
+		bvh->nodes[leaves[l]].listed = 1;
+	}
+	for (int l = 0; l < nb_leaves && !failed; l++){
+		failed = find_pairs(bvh, leaves[l]);
+	}
+	for (int l = 0; l < nb_leaves; l++){
+		bvh->nodes[leaves[l]].listed = 0;
+	}
+	return failed;
+}
+
+void Bvh_free(Bvh* bvh){
+	free(bvh->nodes);
+	free(bvh->pairs);
+	*bvh = Bvh_init(bvh->fatten);
+}
@@ -0,0 +1,182 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Exporter.h"
+#include "Profiler.h"
+
+/* The longest path a file can have. */
+#define PATH_LENGTH 4096
+
+char Exporter_write_ppm(const char* path, const uint32_t* pixels, int width, int height){
+	FILE* file = fopen(path, "wb");
+	unsigned char* row = malloc(3*width);
+	if (file == NULL || row == NULL){
+		if (file != NULL){
+			fclose(file);
+		}
+		free(row);
+		return 1;
+	}
+	char failed = fprintf(file, "P6\n%d %d\n255\n", width, height) < 0;
+	for (int y = 0; y < height && !failed; y++){
+		const uint32_t* line = pixels + (size_t)y*width;
+		for (int x = 0; x < width; x++){
+			row[3*x+0] = line[x] >> 16;
+			row[3*x+1] = line[x] >> 8;
+			row[3*x+2] = line[x];
+		}
+		failed = fwrite(row, 3, width, file) != (size_t)width;
+	}
+	free(row);
+	// the data only reaches the disk once the file is closed, which may fail as well.
+	return (fclose(file) != 0) || failed;
+}
+
+/* Tells whether a pattern has exactly one conversion, of an unsigned long long, and no other % than %%, so that it can
+ * be given to snprintf with the number of a frame. */
+static char valid_pattern(const char* pattern){
+	int conversions = 0;
+	for (const char* c = pattern; *c != '\0'; c++){
+		if (*c != '%'){
+			continue;
+		}
+		if (*++c == '%'){
+			continue;
+		}
+		// flags, width and precision, but no * which would read another argument.
+		c += strspn(c, "-+ #0'");
+		c += strspn(c, "0123456789");
+		if (*c == '.'){
+			c++;
+			c += strspn(c, "0123456789");
+		}
+		if (strncmp(c, "ll", 2) != 0 || c[2] == '\0' || strchr("diouxX", c[2]) == NULL){
+			return 0;
+		}
+		c += 2;
+		conversions++;
+	}
+	return conversions == 1;
+}
+
+static void* encode(void* arg){
+	Exporter* exporter = arg;
+	char path[PATH_LENGTH];
+	size_t frame = (size_t)exporter->width*exporter->height;
+	for (;;){
+		pthread_mutex_lock(&exporter->lock);
+		while (exporter->nb_queued == 0 && !exporter->stop){
+			pthread_cond_wait(&exporter->submitted, &exporter->lock);
+		}
+		if (exporter->nb_queued == 0){
+			pthread_mutex_unlock(&exporter->lock);
+			break;
+		}
+		int buffer = exporter->queue[exporter->head];
+		exporter->head = (exporter->head + 1) % exporter->capacity;
+		exporter->nb_queued--;
+		pthread_mutex_unlock(&exporter->lock);
+
+		PROFILE_BEGIN("encode");
+		snprintf(path, PATH_LENGTH, exporter->pattern, (unsigned long long)exporter->numbers[buffer]);
+		if (exporter->writer(path, exporter->pixels + buffer*frame, exporter->width, exporter->height)){
+			atomic_fetch_add(&exporter->failed, 1);
+		} else {
+			atomic_fetch_add(&exporter->written, 1);
+		}
+		PROFILE_END();
+
+		pthread_mutex_lock(&exporter->lock);
+		exporter->free_slots[exporter->nb_free++] = buffer;
+		pthread_mutex_unlock(&exporter->lock);
+	}
+	return NULL;
+}
+
+char Exporter_start(Exporter* exporter, const char* pattern, ExporterWriter writer, int width, int height,
+		int nb_frames, int nb_threads){
+	memset(exporter, 0, sizeof(Exporter));
+	if (!valid_pattern(pattern)){
+		fprintf(stderr, "The pattern %s should hold a single conversion of the frame number, such as %%06llu, and no "
+				"other %% than %%%%.\n", pattern);
+		return 1;
+	}
+	exporter->width = width;
+	exporter->height = height;
+	exporter->capacity = nb_frames;
+	exporter->pattern = pattern;
+	exporter->writer = (writer == NULL)?Exporter_write_ppm:writer;
+	atomic_init(&exporter->written, 0);
+	atomic_init(&exporter->dropped, 0);
+	atomic_init(&exporter->failed, 0);
+	pthread_mutex_init(&exporter->lock, NULL);
+	pthread_cond_init(&exporter->submitted, NULL);
+
+	exporter->pixels = malloc((size_t)nb_frames*width*height*sizeof(uint32_t));
+	exporter->numbers = malloc(nb_frames*sizeof(uint64_t));
+	exporter->free_slots = malloc(nb_frames*sizeof(int));
+	exporter->queue = malloc(nb_frames*sizeof(int));
+	exporter->threads = malloc(nb_threads*sizeof(pthread_t));
+	if (exporter->pixels == NULL || exporter->numbers == NULL || exporter->free_slots == NULL
+			|| exporter->queue == NULL || exporter->threads == NULL){
+		Exporter_stop(exporter);
+		return 1;
+	}
+	for (int b = 0; b < nb_frames; b++){
+		exporter->free_slots[exporter->nb_free++] = b;
+	}
+	for (; exporter->nb_threads < nb_threads; exporter->nb_threads++){
+		if (pthread_create(&exporter->threads[exporter->nb_threads], NULL, encode, exporter)){
+			Exporter_stop(exporter);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int Exporter_acquire(Exporter* exporter){
+	int buffer = -1;
+	pthread_mutex_lock(&exporter->lock);
+	if (exporter->nb_free > 0){
+		buffer = exporter->free_slots[--exporter->nb_free];
+	}
+	pthread_mutex_unlock(&exporter->lock);
+	if (buffer == -1){
+		atomic_fetch_add(&exporter->dropped, 1);
+	}
+	return buffer;
+}
+
+void Exporter_submit(Exporter* exporter, int buffer, uint64_t number){
+	exporter->numbers[buffer] = number;
+	pthread_mutex_lock(&exporter->lock);
+	exporter->queue[(exporter->head + exporter->nb_queued) % exporter->capacity] = buffer;
+	exporter->nb_queued++;
+	pthread_cond_signal(&exporter->submitted);
+	pthread_mutex_unlock(&exporter->lock);
+}
+
+void Exporter_stop(Exporter* exporter){
+	// the encoders only exit once every submitted frame is written.
+	pthread_mutex_lock(&exporter->lock);
+	exporter->stop = 1;
+	pthread_cond_broadcast(&exporter->submitted);
+	pthread_mutex_unlock(&exporter->lock);
+	for (int t = 0; t < exporter->nb_threads; t++){
+		pthread_join(exporter->threads[t], NULL);
+	}
+	exporter->nb_threads = 0;
+	pthread_mutex_destroy(&exporter->lock);
+	pthread_cond_destroy(&exporter->submitted);
+	free(exporter->pixels);
+	free(exporter->numbers);
+	free(exporter->free_slots);
+	free(exporter->queue);
+	free(exporter->threads);
+	exporter->pixels = NULL;
+	exporter->numbers = NULL;
+	exporter->free_slots = NULL;
+	exporter->queue = NULL;
+	exporter->threads = NULL;
+}
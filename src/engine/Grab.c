@@ -0,0 +1,117 @@
+#include <stdlib.h>
+
+#include "Grab.h"
+
+Grab Grab_init(){
+	Grab grab = {NULL, NULL, NULL, 0, 0, 0, 0};
+	return grab;
+}
+
+/* Makes sure the arrays can hold a given number of nodes. */
+static char reserve(Grab* grab, int capacity){
+	if (capacity <= grab->capacity){
+		return 0;
+	}
+	int* nodes = realloc(grab->nodes, capacity*sizeof(int));
+	if (nodes == NULL){
+		return 1;
+	}
+	grab->nodes = nodes;
+	float* offset_x = realloc(grab->offset_x, capacity*sizeof(float));
+	if (offset_x == NULL){
+		return 1;
+	}
+	grab->offset_x = offset_x;
+	float* offset_y = realloc(grab->offset_y, capacity*sizeof(float));
+	if (offset_y == NULL){
+		return 1;
+	}
+	grab->offset_y = offset_y;
+	grab->capacity = capacity;
+	return 0;
+}
+
+/* Holds a node, given the arrays have room for it. */
+static void hold(Grab* grab, const Nodes* nodes, int i){
+	grab->nodes[grab->count] = i;
+	grab->offset_x[grab->count] = nodes->x[i] - grab->x;
+	grab->offset_y[grab->count] = nodes->y[i] - grab->y;
+	grab->count++;
+}
+
+char Grab_pick(Grab* grab, Grid* grid, const Nodes* nodes, float x, float y, float radius, char brush){
+	grab->count = 0;
+	grab->x = x;
+	grab->y = y;
+	if (radius <= 0){
+		return 0;
+	}
+	// the grid is built on the positions being picked, with cells twice as large as the radius.
+	grid->cell_size = 2*radius;
+	if (Grid_build(grid, nodes->x, nodes->y, NULL, nodes->count)){
+		return 1;
+	}
+	if (!brush){
+		int closest = Grid_nearest(grid, x, y, radius);
+		if (closest != -1){
+			if (reserve(grab, 1)){
+				return 1;
+			}
+			hold(grab, nodes, closest);
+		}
+		return 0;
+	}
+	// the nodes found go straight into the nodes held, the query being run again if they did not fit.
+	int found = Grid_query(grid, x, y, radius, grab->nodes, grab->capacity);
+	if (found > grab->capacity){
+		if (reserve(grab, found)){
+			return 1;
+		}
+		Grid_query(grid, x, y, radius, grab->nodes, grab->capacity);
+	}
+	for (int k = 0; k < found; k++){
+		hold(grab, nodes, grab->nodes[k]);
+	}
+	return 0;
+}
+
+void Grab_move(Grab* grab, float x, float y){
+	grab->x = x;
+	grab->y = y;
+}
+
+void Grab_release(Grab* grab){
+	grab->count = 0;
+}
+
+void Grab_apply(const Grab* grab, Nodes* nodes, float K, float Kd){
+	for (int k = 0; k < grab->count; k++){
+		int i = grab->nodes[k];
+		if (Nodes_get_flag(nodes->locked, i)){
+			continue;
+		}
+		nodes->ax[i] += K * (grab->x + grab->offset_x[k] - nodes->x[i]) - Kd * nodes->vx[i];
+		nodes->ay[i] += K * (grab->y + grab->offset_y[k] - nodes->y[i]) - Kd * nodes->vy[i];
+	}
+}
+
+void Grab_remap(Grab* grab, const int* map){
+	int kept = 0;
+	for (int k = 0; k < grab->count; k++){
+		int i = map[grab->nodes[k]];
+		if (i >= 0){
+			grab->nodes[kept] = i;
+			grab->offset_x[kept] = grab->offset_x[k];
+			grab->offset_y[kept] = grab->offset_y[k];
+			kept++;
+		}
+	}
+	grab->count = kept;
+}
+
+void Grab_free(Grab* grab){
+	free(grab->nodes);
+	free(grab->offset_x);
+	free(grab->offset_y);
+	*grab = Grab_init();
+}
@@ -0,0 +1,154 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "Nodes.h"
+#include "Grid.h"
+
+Grid Grid_init(float cell_size){
+	Grid grid = {cell_size, 0, NULL, NULL, NULL, NULL, NULL, 0, 0};
+	return grid;
+}
+
+char Grid_build(Grid* grid, const float* x, const float* y, const uint32_t* active, int count){
+	if (count > grid->capacity){
+		int* sorted = realloc(grid->sorted, count*sizeof(int));
+		if (sorted == NULL){
+			return 1;
+		}
+		grid->sorted = sorted;
+		int* bucket_of = realloc(grid->bucket_of, count*sizeof(int));
+		if (bucket_of == NULL){
+			return 1;
+		}
+		grid->bucket_of = bucket_of;
+		float* sorted_x = realloc(grid->sorted_x, count*sizeof(float));
+		if (sorted_x == NULL){
+			return 1;
+		}
+		grid->sorted_x = sorted_x;
+		float* sorted_y = realloc(grid->sorted_y, count*sizeof(float));
+		if (sorted_y == NULL){
+			return 1;
+		}
+		grid->sorted_y = sorted_y;
+		grid->capacity = count;
+	}
+
+	// about two buckets per point keeps the collisions between cells rare.
+	int nb_buckets = 64;
+	while (nb_buckets < 2*count){
+		nb_buckets *= 2;
+	}
+	if (nb_buckets != grid->nb_buckets){
+		int* bucket_start = realloc(grid->bucket_start, (nb_buckets+1)*sizeof(int));
+		if (bucket_start == NULL){
+			return 1;
+		}
+		grid->bucket_start = bucket_start;
+		grid->nb_buckets = nb_buckets;
+	}
+	grid->count = count;
+
+	// counting sort of the points over their bucket.
+	int* start = grid->bucket_start;
+	memset(start, 0, (nb_buckets+1)*sizeof(int));
+	for (int i = 0; i < count; i++){
+		if (active == NULL || Nodes_get_flag(active, i)){
+			int bucket = Grid_bucket(grid, Grid_cell(grid, x[i]), Grid_cell(grid, y[i]));
+			grid->bucket_of[i] = bucket;
+			start[bucket+1]++;
+		} else {
+			grid->bucket_of[i] = -1;
+		}
+	}
+	for (int h = 0; h < nb_buckets; h++){
+		start[h+1] += start[h];
+	}
+	for (int i = 0; i < count; i++){
+		if (grid->bucket_of[i] >= 0){
+			int k = start[grid->bucket_of[i]]++;
+			grid->sorted[k] = i;
+			grid->sorted_x[k] = x[i];
+			grid->sorted_y[k] = y[i];
+		}
+	}
+	// start[h] now is the end of bucket h, i.e. the start of bucket h+1.
+	memmove(start+1, start, nb_buckets*sizeof(int));
+	start[0] = 0;
+	return 0;
+}
+
+int Grid_neighbourhood(const Grid* grid, float x, float y, int* buckets){
+	// the radius of a query is at most half a cell, so the disc around the point only overlaps the 2 x 2 cells whose
+	// common corner is the closest to the point.
+	int cx = Grid_cell(grid, x - grid->cell_size/2);
+	int cy = Grid_cell(grid, y - grid->cell_size/2);
+	int nb_buckets = 0;
+	for (int dy = 0; dy <= 1; dy++){
+		for (int dx = 0; dx <= 1; dx++){
+			int bucket = Grid_bucket(grid, cx+dx, cy+dy);
+			char seen = 0;
+			for (int b = 0; b < nb_buckets; b++){
+				seen |= buckets[b] == bucket;
+			}
+			if (!seen){
+				buckets[nb_buckets++] = bucket;
+			}
+		}
+	}
+	return nb_buckets;
+}
+
+int Grid_query(const Grid* grid, float px, float py, float radius, int* found, int max_found){
+	if (grid->nb_buckets == 0){
+		return 0;
+	}
+
+	int buckets[4];
+	int nb_buckets = Grid_neighbourhood(grid, px, py, buckets);
+	int nb_found = 0;
+	for (int b = 0; b < nb_buckets; b++){
+		for (int k = grid->bucket_start[buckets[b]]; k < grid->bucket_start[buckets[b]+1]; k++){
+			float dx = grid->sorted_x[k] - px;
+			float dy = grid->sorted_y[k] - py;
+			if (dx*dx + dy*dy < radius*radius){
+				if (nb_found < max_found){
+					found[nb_found] = grid->sorted[k];
+				}
+				nb_found++;
+			}
+		}
+	}
+	return nb_found;
+}
+
+int Grid_nearest(const Grid* grid, float px, float py, float radius){
+	if (grid->nb_buckets == 0){
+		return -1;
+	}
+
+	int buckets[4];
+	int nb_buckets = Grid_neighbourhood(grid, px, py, buckets);
+	int nearest = -1;
+	float nearest_d2 = radius*radius;
+	for (int b = 0; b < nb_buckets; b++){
+		for (int k = grid->bucket_start[buckets[b]]; k < grid->bucket_start[buckets[b]+1]; k++){
+			float dx = grid->sorted_x[k] - px;
+			float dy = grid->sorted_y[k] - py;
+			if (dx*dx + dy*dy < nearest_d2){
+				nearest = grid->sorted[k];
+				nearest_d2 = dx*dx + dy*dy;
+			}
+		}
+	}
+	return nearest;
+}
+
+void Grid_free(Grid* grid){
+	free(grid->bucket_start);
+	free(grid->sorted);
+	free(grid->bucket_of);
+	free(grid->sorted_x);
+	free(grid->sorted_y);
+	*grid = Grid_init(grid->cell_size);
+}
@@ -0,0 +1,61 @@
+#include <string.h>
+
+#include "Histogram.h"
+
+/* Gives the number of bits a value is shifted by in its bucket, i.e. the log of the width of the bucket. */
+static inline int bucket_shift(uint64_t value){
+	int bits = 64 - __builtin_clzll(value | 1);
+	return (bits > HISTOGRAM_PRECISION_BITS)?bits - HISTOGRAM_PRECISION_BITS - 1:0;
+}
+
+/* The values of [2^(b-1), 2^b) are shifted into [SUB_BUCKETS, 2*SUB_BUCKETS), and offset by shift * SUB_BUCKETS, so
+ * that the buckets of the successive powers of two follow each other, the values below 2*SUB_BUCKETS having one
+ * each. */
+static inline int bucket_index(uint64_t value){
+	int shift = bucket_shift(value);
+	return shift*HISTOGRAM_SUB_BUCKETS + (int)(value >> shift);
+}
+
+/* Gives the smallest value of a bucket, and the log of its width. */
+static inline uint64_t bucket_start(int index, int* shift){
+	*shift = (index < 2*HISTOGRAM_SUB_BUCKETS)?0:index/HISTOGRAM_SUB_BUCKETS - 1;
+	return (uint64_t)(index - *shift*HISTOGRAM_SUB_BUCKETS) << *shift;
+}
+
+void Histogram_clear(Histogram* histogram){
+	memset(histogram->counts, 0, sizeof(histogram->counts));
+	histogram->count = 0;
+	histogram->min = UINT64_MAX;
+	histogram->max = 0;
+}
+
+void Histogram_record(Histogram* histogram, uint64_t value){
+	uint64_t largest = ((uint64_t)1 << HISTOGRAM_RANGE_BITS) - 1;
+	value = (value > largest)?largest:value;
+	histogram->counts[bucket_index(value)]++;
+	histogram->count++;
+	histogram->min = (value < histogram->min)?value:histogram->min;
+	histogram->max = (value > histogram->max)?value:histogram->max;
+}
+
+uint64_t Histogram_percentile(const Histogram* histogram, double percentile){
+	if (histogram->count == 0){
+		return 0;
+	}
+	// the rank of the value wanted, from 1 to count.
+	uint64_t rank = (uint64_t)(percentile/100 * histogram->count + 0.5);
+	rank = (rank < 1)?1:rank;
+	rank = (rank > histogram->count)?histogram->count:rank;
+
+	uint64_t seen = 0;
+	for (int b = 0; b < HISTOGRAM_BUCKETS; b++){
+		seen += histogram->counts[b];
+		if (seen >= rank){
+			int shift;
+			uint64_t value = bucket_start(b, &shift) + (((uint64_t)1 << shift) >> 1);
+			value = (value < histogram->min)?histogram->min:value;
+			return (value > histogram->max)?histogram->max:value;
+		}
+	}
+	return histogram->max;
+}
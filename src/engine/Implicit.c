@@ -0,0 +1,217 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Implicit.h"
+
+Implicit Implicit_init(){
+	Implicit implicit;
+	memset(&implicit, 0, sizeof(Implicit));
+	return implicit;
+}
+
+/* Makes sure the arrays hold the given numbers of nodes and springs. */
+static char reserve(Implicit* implicit, int nb_nodes, int nb_springs){
+	if (nb_nodes > implicit->capacity){
+		float** arrays[] = {&implicit->dvx, &implicit->dvy, &implicit->rx, &implicit->ry, &implicit->zx, &implicit->zy,
+				&implicit->px, &implicit->py, &implicit->qx, &implicit->qy, &implicit->inv_x, &implicit->inv_y,
+				&implicit->free};
+		for (int a = 0; a < (int)(sizeof(arrays)/sizeof(arrays[0])); a++){
+			float* array = realloc(*arrays[a], nb_nodes*sizeof(float));
+			if (array == NULL){
+				return 1;
+			}
+			*arrays[a] = array;
+		}
+		implicit->capacity = nb_nodes;
+	}
+	if (nb_springs > implicit->spring_capacity){
+		float** arrays[] = {&implicit->nx, &implicit->ny, &implicit->across, &implicit->stiffness, &implicit->along};
+		for (int a = 0; a < (int)(sizeof(arrays)/sizeof(arrays[0])); a++){
+			float* array = realloc(*arrays[a], nb_springs*sizeof(float));
+			if (array == NULL){
+				return 1;
+			}
+			*arrays[a] = array;
+		}
+		implicit->spring_capacity = nb_springs;
+	}
+	return 0;
+}
+
+/* Accumulates the product of the spring part of the matrix with (in_x, in_y) onto (out_x, out_y). Along a spring the
+ * coefficient is given in along, across it the one stored for the spring. */
+static void multiply(const Implicit* implicit, const Springs* springs, const float* along,
+		const float* in_x, const float* in_y, float* out_x, float* out_y){
+	for (int s = 0; s < springs->count; s++){
+		int i = springs->a[s];
+		int j = springs->b[s];
+		float nx = implicit->nx[s];
+		float ny = implicit->ny[s];
+		float dx = in_x[i] - in_x[j];
+		float dy = in_y[i] - in_y[j];
+		float dn = nx*dx + ny*dy;
+		float across = implicit->across[s];
+		float yx = along[s]*nx*dn + across*(dx - nx*dn);
+		float yy = along[s]*ny*dn + across*(dy - ny*dn);
+		out_x[i] += yx;
+		out_y[i] += yy;
+		out_x[j] -= yx;
+		out_y[j] -= yy;
+	}
+}
+
+static double dot(const float* ax, const float* ay, const float* bx, const float* by, int count){
+	double sum = 0;
+	for (int i = 0; i < count; i++){
+		sum += ax[i]*bx[i] + ay[i]*by[i];
+	}
+	return sum;
+}
+
+char Implicit_solve(Implicit* implicit, Nodes* nodes, const Springs* springs, float dt, float K, float Kd,
+		float L0, int max_iterations, float tolerance){
+	int n = nodes->count;
+	if (reserve(implicit, n, springs->count)){
+		return 1;
+	}
+	// the coefficients of the matrix along the springs, without and with the damping.
+	float* stiffness = implicit->stiffness;
+	float* along = implicit->along;
+	if (springs->stiffness != NULL){
+		for (int s = 0; s < springs->count; s++){
+			stiffness[s] = dt*dt*springs->stiffness[s];
+			along[s] = dt*springs->damping[s] + stiffness[s];
+		}
+	} else {
+		for (int s = 0; s < springs->count; s++){
+			stiffness[s] = dt*dt*K;
+			along[s] = dt*Kd + stiffness[s];
+		}
+	}
+
+	for (int s = 0; s < springs->count; s++){
+		int i = springs->a[s];
+		int j = springs->b[s];
+		float d = springs->length[s];
+		float rest = (springs->rest != NULL)?springs->rest[s]:L0;
+		if (d > 0){
+			implicit->nx[s] = (nodes->x[i] - nodes->x[j]) / d;
+			implicit->ny[s] = (nodes->y[i] - nodes->y[j]) / d;
+			implicit->across[s] = (d > rest)?stiffness[s]*(1 - rest/d):0;
+		} else {
+			implicit->nx[s] = 0;
+			implicit->ny[s] = 0;
+			implicit->across[s] = 0;
+		}
+	}
+
+	// the diagonal of the matrix, used as the preconditioner.
+	for (int i = 0; i < n; i++){
+		implicit->free[i] = !Nodes_get_flag(nodes->locked, i);
+		implicit->inv_x[i] = 1;
+		implicit->inv_y[i] = 1;
+	}
+	for (int s = 0; s < springs->count; s++){
+		float nx2 = implicit->nx[s]*implicit->nx[s];
+		float ny2 = implicit->ny[s]*implicit->ny[s];
+		float across = implicit->across[s];
+		float diag_x = along[s]*nx2 + across*(1 - nx2);
+		float diag_y = along[s]*ny2 + across*(1 - ny2);
+		implicit->inv_x[springs->a[s]] += diag_x;
+		implicit->inv_y[springs->a[s]] += diag_y;
+		implicit->inv_x[springs->b[s]] += diag_x;
+		implicit->inv_y[springs->b[s]] += diag_y;
+	}
+	for (int i = 0; i < n; i++){
+		implicit->inv_x[i] = implicit->free[i] / implicit->inv_x[i];
+		implicit->inv_y[i] = implicit->free[i] / implicit->inv_y[i];
+	}
+
+	// the right hand side dt * f - dt^2 * S v, S being the stiffness part of the matrix, is the first residual as the
+	// gradient starts from dv = 0.
+	float* rx = implicit->rx;
+	float* ry = implicit->ry;
+	memset(rx, 0, n*sizeof(float));
+	memset(ry, 0, n*sizeof(float));
+	multiply(implicit, springs, stiffness, nodes->vx, nodes->vy, rx, ry);
+	for (int i = 0; i < n; i++){
+		rx[i] = implicit->free[i] * (dt*nodes->ax[i] - rx[i]);
+		ry[i] = implicit->free[i] * (dt*nodes->ay[i] - ry[i]);
+		implicit->dvx[i] = 0;
+		implicit->dvy[i] = 0;
+		implicit->zx[i] = implicit->inv_x[i] * rx[i];
+		implicit->zy[i] = implicit->inv_y[i] * ry[i];
+		implicit->px[i] = implicit->zx[i];
+		implicit->py[i] = implicit->zy[i];
+	}
+
+	double rhs = sqrt(dot(rx, ry, rx, ry, n));
+	double rz = dot(rx, ry, implicit->zx, implicit->zy, n);
+	double residual = rhs;
+	int k = 0;
+	while (k < max_iterations && residual > tolerance*rhs){
+		float* qx = implicit->qx;
+		float* qy = implicit->qy;
+		memcpy(qx, implicit->px, n*sizeof(float));
+		memcpy(qy, implicit->py, n*sizeof(float));
+		multiply(implicit, springs, along, implicit->px, implicit->py, qx, qy);
+		for (int i = 0; i < n; i++){
+			qx[i] *= implicit->free[i];
+			qy[i] *= implicit->free[i];
+		}
+
+		double pq = dot(implicit->px, implicit->py, qx, qy, n);
+		if (pq <= 0){
+			break;
+		}
+		float alpha = rz / pq;
+		for (int i = 0; i < n; i++){
+			implicit->dvx[i] += alpha * implicit->px[i];
+			implicit->dvy[i] += alpha * implicit->py[i];
+			rx[i] -= alpha * qx[i];
+			ry[i] -= alpha * qy[i];
+			implicit->zx[i] = implicit->inv_x[i] * rx[i];
+			implicit->zy[i] = implicit->inv_y[i] * ry[i];
+		}
+		double rz_next = dot(rx, ry, implicit->zx, implicit->zy, n);
+		float beta = rz_next / rz;
+		rz = rz_next;
+		for (int i = 0; i < n; i++){
+			implicit->px[i] = implicit->zx[i] + beta * implicit->px[i];
+			implicit->py[i] = implicit->zy[i] + beta * implicit->py[i];
+		}
+		residual = sqrt(dot(rx, ry, rx, ry, n));
+		k++;
+	}
+	implicit->iterations = k;
+	implicit->residual = (rhs > 0)?residual/rhs:0;
+
+	for (int i = 0; i < n; i++){
+		nodes->ax[i] = implicit->dvx[i] / dt;
+		nodes->ay[i] = implicit->dvy[i] / dt;
+	}
+	return 0;
+}
+
+void Implicit_free(Implicit* implicit){
+	free(implicit->dvx);
+	free(implicit->dvy);
+	free(implicit->rx);
+	free(implicit->ry);
+	free(implicit->zx);
+	free(implicit->zy);
+	free(implicit->px);
+	free(implicit->py);
+	free(implicit->qx);
+	free(implicit->qy);
+	free(implicit->inv_x);
+	free(implicit->inv_y);
+	free(implicit->free);
+	free(implicit->nx);
+	free(implicit->ny);
+	free(implicit->across);
+	free(implicit->stiffness);
+	free(implicit->along);
+	*implicit = Implicit_init();
+}
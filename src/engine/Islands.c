@@ -0,0 +1,291 @@
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+
+#include "Islands.h"
+
+Islands Islands_init(){
+	Islands islands;
+	memset(&islands, 0, sizeof(Islands));
+	islands.tree = Bvh_init(0);
+	return islands;
+}
+
+/* Makes sure the arrays hold the given numbers of nodes and islands. */
+static char reserve(Islands* islands, int nb_nodes, int nb_islands){
+	if (nb_nodes > islands->capacity){
+		int** arrays[] = {&islands->island, &islands->order, &islands->rank};
+		for (int a = 0; a < (int)(sizeof(arrays)/sizeof(arrays[0])); a++){
+			int* array = realloc(*arrays[a], nb_nodes*sizeof(int));
+			if (array == NULL){
+				return 1;
+			}
+			*arrays[a] = array;
+		}
+		islands->capacity = nb_nodes;
+	}
+	if (nb_islands > islands->island_capacity){
+		float** floats[] = {&islands->min_x, &islands->min_y, &islands->max_x, &islands->max_y, &islands->energy};
+		for (int a = 0; a < (int)(sizeof(floats)/sizeof(floats[0])); a++){
+			float* array = realloc(*floats[a], nb_islands*sizeof(float));
+			if (array == NULL){
+				return 1;
+			}
+			*floats[a] = array;
+		}
+		int** ints[] = {&islands->size, &islands->still, &islands->leaf};
+		for (int a = 0; a < (int)(sizeof(ints)/sizeof(ints[0])); a++){
+			int* array = realloc(*ints[a], nb_islands*sizeof(int));
+			if (array == NULL){
+				return 1;
+			}
+			*ints[a] = array;
+		}
+		char* asleep = realloc(islands->asleep, nb_islands);
+		if (asleep == NULL){
+			return 1;
+		}
+		islands->asleep = asleep;
+		islands->island_capacity = nb_islands;
+	}
+	return 0;
+}
+
+/* Gives the root of the tree of a node, halving the path on the way. */
+static int find(int* parent, int i){
+	while (parent[i] != i){
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+char Islands_build(Islands* islands, const Nodes* nodes, const Springs* springs){
+	int n = nodes->count;
+	islands->valid = 0;
+	if (reserve(islands, n, 0)){
+		return 1;
+	}
+	// the island array holds the parents of the union-find, and then the island of every node.
+	int* parent = islands->island;
+	for (int i = 0; i < n; i++){
+		parent[i] = i;
+	}
+	for (int s = 0; s < springs->count; s++){
+		int a = find(parent, springs->a[s]);
+		int b = find(parent, springs->b[s]);
+		if (a != b){
+			parent[(a < b)?b:a] = (a < b)?a:b;
+		}
+	}
+	// the roots are numbered in order, every root being lower than the nodes of its tree.
+	int count = 0;
+	for (int i = 0; i < n; i++){
+		int root = find(parent, i);
+		islands->rank[i] = (root == i)?count++:islands->rank[root];
+	}
+	memcpy(islands->island, islands->rank, n*sizeof(int));
+
+	if (reserve(islands, n, count)){
+		return 1;
+	}
+	for (int c = 0; c < count; c++){
+		islands->size[c] = 0;
+		islands->energy[c] = FLT_MAX;
+		islands->still[c] = 0;
+		islands->asleep[c] = 0;
+		islands->leaf[c] = -1;
+	}
+	Bvh_clear(&islands->tree);
+	for (int i = 0; i < n; i++){
+		islands->size[islands->island[i]]++;
+	}
+	islands->count = count;
+	islands->nb_nodes = n;
+	islands->nb_springs = springs->count;
+	islands->awake_nodes = n;
+	islands->awake_springs = springs->count;
+	islands->valid = 1;
+	return 0;
+}
+
+/* Sorts the nodes and the springs of the awake islands before the sleeping ones, keeping their order otherwise. */
+static char arrange(Islands* islands, Nodes* nodes, Springs* springs){
+	int n = nodes->count;
+	int e = springs->count;
+	int* scratch = malloc((n > e)?n*sizeof(int):(e > 0)?e*sizeof(int):1);
+	if (scratch == NULL){
+		return 1;
+	}
+
+	int awake = 0;
+	for (int i = 0; i < n; i++){
+		awake += !islands->asleep[islands->island[i]];
+	}
+	int next_awake = 0, next_asleep = awake;
+	for (int i = 0; i < n; i++){
+		int k = islands->asleep[islands->island[i]]?next_asleep++:next_awake++;
+		islands->order[k] = i;
+		islands->rank[i] = k;
+	}
+	if (Nodes_permute(nodes, islands->order)){
+		free(scratch);
+		return 1;
+	}
+	islands->arranged++;
+	for (int k = 0; k < n; k++){
+		scratch[k] = islands->island[islands->order[k]];
+	}
+	memcpy(islands->island, scratch, n*sizeof(int));
+	for (int s = 0; s < e; s++){
+		springs->a[s] = islands->rank[springs->a[s]];
+		springs->b[s] = islands->rank[springs->b[s]];
+	}
+	springs->topology++;
+
+	// both ends of a spring are in the same island, so the first one tells whether the spring sleeps.
+	int awake_springs = 0;
+	for (int s = 0; s < e; s++){
+		awake_springs += !islands->asleep[islands->island[springs->a[s]]];
+	}
+	next_awake = 0;
+	next_asleep = awake_springs;
+	for (int s = 0; s < e; s++){
+		int k = islands->asleep[islands->island[springs->a[s]]]?next_asleep++:next_awake++;
+		scratch[k] = s;
+	}
+	char failed = Springs_permute(springs, scratch);
+	free(scratch);
+	if (failed){
+		return 1;
+	}
+
+	islands->awake_nodes = awake;
+	islands->awake_springs = awake_springs;
+	return 0;
+}
+
+/* Tells whether the boxes of two islands are closer than a margin. */
+static inline char overlap(const Islands* islands, int c, int d, float margin){
+	return islands->min_x[c] - margin <= islands->max_x[d] && islands->min_x[d] - margin <= islands->max_x[c]
+			&& islands->min_y[c] - margin <= islands->max_y[d] && islands->min_y[d] - margin <= islands->max_y[c];
+}
+
+char Islands_update(Islands* islands, Nodes* nodes, Springs* springs, float energy, int steps, float margin){
+	for (int c = 0; c < islands->count; c++){
+		if (!islands->asleep[c]){
+			islands->energy[c] = 0;
+			islands->min_x[c] = islands->min_y[c] = FLT_MAX;
+			islands->max_x[c] = islands->max_y[c] = -FLT_MAX;
+		}
+	}
+	for (int i = 0; i < islands->awake_nodes; i++){
+		int c = islands->island[i];
+		islands->energy[c] += (nodes->vx[i]*nodes->vx[i] + nodes->vy[i]*nodes->vy[i]) / 2;
+		islands->min_x[c] = (nodes->x[i] < islands->min_x[c])?nodes->x[i]:islands->min_x[c];
+		islands->min_y[c] = (nodes->y[i] < islands->min_y[c])?nodes->y[i]:islands->min_y[c];
+		islands->max_x[c] = (nodes->x[i] > islands->max_x[c])?nodes->x[i]:islands->max_x[c];
+		islands->max_y[c] = (nodes->y[i] > islands->max_y[c])?nodes->y[i]:islands->max_y[c];
+	}
+
+	// the islands still for long enough are marked 2 until it is known whether a moving island is close.
+	char changed = 0;
+	for (int c = 0; c < islands->count; c++){
+		if (!islands->asleep[c]){
+			islands->energy[c] /= islands->size[c];
+			islands->still[c] = (islands->energy[c] < energy)?islands->still[c]+1:0;
+			if (islands->still[c] >= steps){
+				islands->asleep[c] = 2;
+			}
+		}
+	}
+
+	// the tree holds the boxes grown by half the margin, so that two of them overlap when the islands are closer than
+	// the margin, and fattened by the margin, so that an island creeping along does not have to move in the tree.
+	// the leaves of the awake islands are listed into the order array, which is not in use, as there are no more
+	// islands than nodes.
+	char failed = 0;
+	int nb_leaves = 0;
+	islands->tree.fatten = margin;
+	for (int c = 0; c < islands->count; c++){
+		if (islands->asleep[c] == 1){
+			continue;
+		}
+		BvhBox box = {islands->min_x[c] - margin/2, islands->min_y[c] - margin/2, islands->max_x[c] + margin/2,
+				islands->max_y[c] + margin/2};
+		if (islands->leaf[c] == -1){
+			islands->leaf[c] = Bvh_insert(&islands->tree, box, c);
+			failed |= islands->leaf[c] == -1;
+		} else {
+			Bvh_move(&islands->tree, islands->leaf[c], box);
+		}
+		if (islands->leaf[c] != -1){
+			islands->order[nb_leaves++] = islands->leaf[c];
+		}
+	}
+	failed |= Bvh_find_pairs(&islands->tree, islands->order, nb_leaves);
+
+	// only the islands moving wake the others up, so that islands at rest side by side can fall asleep one by one.
+	for (int p = 0; p < islands->tree.nb_pairs && !failed; p++){
+		for (int k = 0; k < 2; k++){
+			int c = islands->tree.pairs[2*p+k];
+			int d = islands->tree.pairs[2*p+1-k];
+			if (islands->asleep[c] == 0 && islands->still[c] == 0 && islands->asleep[d] != 0
+					&& overlap(islands, c, d, margin)){
+				changed |= islands->asleep[d] == 1;
+				islands->still[d] = 0;
+				islands->asleep[d] = 0;
+			}
+		}
+	}
+	// without the pairs, no island can be left asleep safely.
+	for (int c = 0; c < islands->count && failed; c++){
+		changed |= islands->asleep[c] == 1;
+		islands->still[c] = 0;
+		islands->asleep[c] = 0;
+	}
+	for (int c = 0; c < islands->count; c++){
+		if (islands->asleep[c] == 2){
+			islands->asleep[c] = 1;
+			changed = 1;
+		}
+	}
+	if (!changed){
+		return failed;
+	}
+
+	// the nodes falling asleep stop where they are, the ones waking up start from rest.
+	for (int i = 0; i < nodes->count; i++){
+		if (islands->asleep[islands->island[i]] != (i >= islands->awake_nodes)){
+			nodes->vx[i] = 0;
+			nodes->vy[i] = 0;
+			nodes->px[i] = nodes->x[i];
+			nodes->py[i] = nodes->y[i];
+		}
+	}
+	if (arrange(islands, nodes, springs)){
+		memset(islands->asleep, 0, islands->count);
+		memset(islands->still, 0, islands->count*sizeof(int));
+		islands->awake_nodes = nodes->count;
+		islands->awake_springs = springs->count;
+		return 1;
+	}
+	return failed;
+}
+
+void Islands_free(Islands* islands){
+	free(islands->island);
+	free(islands->order);
+	free(islands->rank);
+	free(islands->min_x);
+	free(islands->min_y);
+	free(islands->max_x);
+	free(islands->max_y);
+	free(islands->energy);
+	free(islands->size);
+	free(islands->still);
+	free(islands->asleep);
+	free(islands->leaf);
+	Bvh_free(&islands->tree);
+	*islands = Islands_init();
+}
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Kernels.h"
+
+void Kernels_clear(Nodes* nodes, int begin, int end, float gx, float gy){
+	float* restrict ax = nodes->ax;
+	float* restrict ay = nodes->ay;
+	for (int i = begin; i < end; i++){
+		ax[i] = gx;
+		ay[i] = gy;
+	}
+}
+
+static inline void spring_scalar(Nodes* nodes, Springs* springs, int s, float K, float Kd, float L0){
+	int i = springs->a[s];
+	int j = springs->b[s];
+	float dx = nodes->x[i] - nodes->x[j];
+	float dy = nodes->y[i] - nodes->y[j];
+	float d = sqrtf(dx*dx + dy*dy);
+	springs->length[s] = d;
+	// coincident nodes give no direction: the spring pushes them apart along x rather than dividing by zero, which
+	// would spread NaNs through the whole mesh. The vectorized kernels do the same, lane by lane.
+	float nx = (d > 0)?dx / d:1;
+	float ny = (d > 0)?dy / d:0;
+	float fs = K * (d - L0);
+	float fd = (nx * (nodes->vx[i] - nodes->vx[j]) + ny * (nodes->vy[i] - nodes->vy[j])) * Kd;
+	float force = fs + fd;
+
+	nodes->ax[i] += - force * nx;
+	nodes->ay[i] += - force * ny;
+	nodes->ax[j] += + force * nx;
+	nodes->ay[j] += + force * ny;
+}
+
+static void springs_scalar(Nodes* nodes, Springs* springs, int begin, int end, float K, float Kd, float L0){
+	for (int s = begin; s < end; s++){
+		spring_scalar(nodes, springs, s, K, Kd, L0);
+	}
+}
+
+static void springs_materials_scalar(Nodes* nodes, Springs* springs, int begin, int end){
+	for (int s = begin; s < end; s++){
+		spring_scalar(nodes, springs, s, springs->stiffness[s], springs->damping[s], springs->rest[s]);
+	}
+}
+
+static void integrate_scalar(Nodes* nodes, int begin, int end, float dt, float drag, float w, float h){
+	for (int i = begin; i < end; i++){
+		if (!Nodes_get_flag(nodes->locked, i)){
+			nodes->vx[i] += dt * nodes->ax[i];
+			nodes->vy[i] += dt * nodes->ay[i];
+			nodes->vx[i] *= drag;
+			nodes->vy[i] *= drag;
+			nodes->x[i] += dt * nodes->vx[i];
+			nodes->y[i] += dt * nodes->vy[i];
+			char  left = nodes->x[i] < 0;
+			char right = nodes->x[i] > w;
+			char    up = nodes->y[i] < 0;
+			char  down = nodes->y[i] > h;
+			char outside = left || right || up || down;
+			if (outside){
+				nodes->vx[i] *= -1;
+				nodes->vy[i] *= -1;
+			}
+			if  (left){ nodes->x[i] = 0; }
+			if (right){ nodes->x[i] = w; }
+			if    (up){ nodes->y[i] = 0; }
+			if  (down){ nodes->y[i] = h; }
+		}
+	}
+}
+
+Kernels Kernels_scalar(){
+	Kernels kernels = {"scalar", 1, springs_scalar, springs_materials_scalar, integrate_scalar};
+	return kernels;
+}
+
+Kernels Kernels_select(){
+	const char* forced = getenv("SOFT_BODY_KERNELS");
+	if (forced != NULL){
+		if (strcmp(forced, "scalar") == 0){
+			return Kernels_scalar();
+		}
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_cpu_init();
+		if (strcmp(forced, "sse") == 0 && __builtin_cpu_supports("sse2")){
+			return Kernels_sse();
+		}
+		if (strcmp(forced, "avx2") == 0 && __builtin_cpu_supports("avx2")){
+			return Kernels_avx2();
+		}
+#endif
+		fprintf(stderr, "Kernels \"%s\" are not available, falling back on the detected ones.\n", forced);
+	}
+
+#if defined(__x86_64__) || defined(__i386__)
+	// __builtin_cpu_supports queries the processor through CPUID.
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")){
+		return Kernels_avx2();
+	}
+	if (__builtin_cpu_supports("sse2")){
+		return Kernels_sse();
+	}
+#endif
+	return Kernels_scalar();
+}
@@ -0,0 +1,129 @@
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#include "Kernels.h"
+
+/* The functions of this file are compiled for AVX2 whatever the flags of the build, they are only ever called once
+ * Kernels_select has made sure the processor supports them. */
+#define AVX2 __attribute__((target("avx2")))
+
+/* Accumulates the forces of the springs s to s+7, given their parameters. Once inlined, the parameters of the uniform
+ * kernel are constants kept in registers. */
+AVX2 static inline __attribute__((always_inline)) void block_avx2(Nodes* nodes, Springs* springs, int s, __m256 k,
+		__m256 kd, __m256 l0){
+	float fx[8] __attribute__((aligned(32)));
+	float fy[8] __attribute__((aligned(32)));
+	__m256i ia = _mm256_loadu_si256((const __m256i*)(springs->a + s));
+	__m256i ib = _mm256_loadu_si256((const __m256i*)(springs->b + s));
+
+	__m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(nodes->x, ia, 4), _mm256_i32gather_ps(nodes->x, ib, 4));
+	__m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(nodes->y, ia, 4), _mm256_i32gather_ps(nodes->y, ib, 4));
+	__m256 dvx = _mm256_sub_ps(_mm256_i32gather_ps(nodes->vx, ia, 4), _mm256_i32gather_ps(nodes->vx, ib, 4));
+	__m256 dvy = _mm256_sub_ps(_mm256_i32gather_ps(nodes->vy, ia, 4), _mm256_i32gather_ps(nodes->vy, ib, 4));
+
+	__m256 d = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+	_mm256_storeu_ps(springs->length + s, d);
+	// the coincident nodes are pushed apart along x, as by the scalar kernel.
+	__m256 apart = _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GT_OQ);
+	__m256 nx = _mm256_blendv_ps(_mm256_set1_ps(1), _mm256_div_ps(dx, d), apart);
+	__m256 ny = _mm256_and_ps(apart, _mm256_div_ps(dy, d));
+	__m256 fs = _mm256_mul_ps(k, _mm256_sub_ps(d, l0));
+	__m256 fd = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(nx, dvx), _mm256_mul_ps(ny, dvy)), kd);
+	__m256 force = _mm256_add_ps(fs, fd);
+
+	_mm256_store_ps(fx, _mm256_mul_ps(force, nx));
+	_mm256_store_ps(fy, _mm256_mul_ps(force, ny));
+
+	// AVX2 has no scatter, and two springs of the block may share a node: the forces are added one by one.
+	for (int l = 0; l < 8; l++){
+		int i = springs->a[s+l];
+		int j = springs->b[s+l];
+		nodes->ax[i] -= fx[l];
+		nodes->ay[i] -= fy[l];
+		nodes->ax[j] += fx[l];
+		nodes->ay[j] += fy[l];
+	}
+}
+
+AVX2 static void springs_avx2(Nodes* nodes, Springs* springs, int begin, int end, float K, float Kd, float L0){
+	const __m256 k = _mm256_set1_ps(K);
+	const __m256 kd = _mm256_set1_ps(Kd);
+	const __m256 l0 = _mm256_set1_ps(L0);
+	int s = begin;
+	for (; s + 8 <= end; s += 8){
+		block_avx2(nodes, springs, s, k, kd, l0);
+	}
+	Kernels_scalar().springs(nodes, springs, s, end, K, Kd, L0);
+}
+
+AVX2 static void springs_materials_avx2(Nodes* nodes, Springs* springs, int begin, int end){
+	int s = begin;
+	for (; s + 8 <= end; s += 8){
+		block_avx2(nodes, springs, s, _mm256_loadu_ps(springs->stiffness + s), _mm256_loadu_ps(springs->damping + s),
+				_mm256_loadu_ps(springs->rest + s));
+	}
+	Kernels_scalar().springs_materials(nodes, springs, s, end);
+}
+
+AVX2 static void integrate_avx2(Nodes* nodes, int begin, int end, float dt, float drag, float w, float h){
+	Kernels scalar = Kernels_scalar();
+
+	// the flags of a block are read from a single mask word, so the blocks have to start on a multiple of 8.
+	int i = (begin + 7) & ~7;
+	if (i > end){
+		i = end;
+	}
+	scalar.integrate(nodes, begin, i, dt, drag, w, h);
+
+	const __m256 vdt = _mm256_set1_ps(dt);
+	const __m256 vdrag = _mm256_set1_ps(drag);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 vw = _mm256_set1_ps(w);
+	const __m256 vh = _mm256_set1_ps(h);
+	const __m256 sign = _mm256_set1_ps(-0.f);
+	const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+	for (; i + 8 <= end; i += 8){
+		uint32_t bits = (~nodes->locked[i >> 5] >> (i & 31)) & 0xff;
+		if (bits == 0){
+			continue;
+		}
+		__m256 move = _mm256_castsi256_ps(
+				_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(bits), lanes), lanes));
+
+		__m256 x0 = _mm256_load_ps(nodes->x + i);
+		__m256 y0 = _mm256_load_ps(nodes->y + i);
+		__m256 vx0 = _mm256_load_ps(nodes->vx + i);
+		__m256 vy0 = _mm256_load_ps(nodes->vy + i);
+
+		__m256 vx = _mm256_mul_ps(_mm256_add_ps(vx0, _mm256_mul_ps(vdt, _mm256_load_ps(nodes->ax + i))), vdrag);
+		__m256 vy = _mm256_mul_ps(_mm256_add_ps(vy0, _mm256_mul_ps(vdt, _mm256_load_ps(nodes->ay + i))), vdrag);
+		__m256 x = _mm256_add_ps(x0, _mm256_mul_ps(vdt, vx));
+		__m256 y = _mm256_add_ps(y0, _mm256_mul_ps(vdt, vy));
+
+		__m256 left = _mm256_cmp_ps(x, zero, _CMP_LT_OQ);
+		__m256 right = _mm256_cmp_ps(x, vw, _CMP_GT_OQ);
+		__m256 up = _mm256_cmp_ps(y, zero, _CMP_LT_OQ);
+		__m256 down = _mm256_cmp_ps(y, vh, _CMP_GT_OQ);
+		__m256 outside = _mm256_or_ps(_mm256_or_ps(left, right), _mm256_or_ps(up, down));
+		vx = _mm256_xor_ps(vx, _mm256_and_ps(outside, sign));
+		vy = _mm256_xor_ps(vy, _mm256_and_ps(outside, sign));
+		x = _mm256_blendv_ps(_mm256_blendv_ps(x, zero, left), vw, right);
+		y = _mm256_blendv_ps(_mm256_blendv_ps(y, zero, up), vh, down);
+
+		_mm256_store_ps(nodes->x + i, _mm256_blendv_ps(x0, x, move));
+		_mm256_store_ps(nodes->y + i, _mm256_blendv_ps(y0, y, move));
+		_mm256_store_ps(nodes->vx + i, _mm256_blendv_ps(vx0, vx, move));
+		_mm256_store_ps(nodes->vy + i, _mm256_blendv_ps(vy0, vy, move));
+	}
+
+	scalar.integrate(nodes, i, end, dt, drag, w, h);
+}
+
+Kernels Kernels_avx2(){
+	Kernels kernels = {"avx2", 8, springs_avx2, springs_materials_avx2, integrate_avx2};
+	return kernels;
+}
+
+#endif
@@ -0,0 +1,137 @@
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <emmintrin.h>
+
+#include "Kernels.h"
+
+/* The functions of this file are compiled for SSE2 whatever the flags of the build, they are only ever called once
+ * Kernels_select has made sure the processor supports them. SSE2 has neither gathers nor blends, the former are done
+ * with scalar loads and the latter with bitwise operations. */
+#define SSE2 __attribute__((target("sse2")))
+
+SSE2 static inline __m128 select_ps(__m128 mask, __m128 a, __m128 b){
+	return _mm_or_ps(_mm_andnot_ps(mask, a), _mm_and_ps(mask, b));
+}
+
+/* Accumulates the forces of the springs s to s+3, given their parameters. Once inlined, the parameters of the uniform
+ * kernel are constants kept in registers. */
+SSE2 static inline __attribute__((always_inline)) void block_sse(Nodes* nodes, Springs* springs, int s, __m128 k,
+		__m128 kd, __m128 l0){
+	float fx[4] __attribute__((aligned(16)));
+	float fy[4] __attribute__((aligned(16)));
+	const int* a = springs->a + s;
+	const int* b = springs->b + s;
+
+	__m128 dx = _mm_sub_ps(
+			_mm_setr_ps(nodes->x[a[0]], nodes->x[a[1]], nodes->x[a[2]], nodes->x[a[3]]),
+			_mm_setr_ps(nodes->x[b[0]], nodes->x[b[1]], nodes->x[b[2]], nodes->x[b[3]]));
+	__m128 dy = _mm_sub_ps(
+			_mm_setr_ps(nodes->y[a[0]], nodes->y[a[1]], nodes->y[a[2]], nodes->y[a[3]]),
+			_mm_setr_ps(nodes->y[b[0]], nodes->y[b[1]], nodes->y[b[2]], nodes->y[b[3]]));
+	__m128 dvx = _mm_sub_ps(
+			_mm_setr_ps(nodes->vx[a[0]], nodes->vx[a[1]], nodes->vx[a[2]], nodes->vx[a[3]]),
+			_mm_setr_ps(nodes->vx[b[0]], nodes->vx[b[1]], nodes->vx[b[2]], nodes->vx[b[3]]));
+	__m128 dvy = _mm_sub_ps(
+			_mm_setr_ps(nodes->vy[a[0]], nodes->vy[a[1]], nodes->vy[a[2]], nodes->vy[a[3]]),
+			_mm_setr_ps(nodes->vy[b[0]], nodes->vy[b[1]], nodes->vy[b[2]], nodes->vy[b[3]]));
+
+	__m128 d = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+	_mm_storeu_ps(springs->length + s, d);
+	// the coincident nodes are pushed apart along x, as by the scalar kernel.
+	__m128 apart = _mm_cmpgt_ps(d, _mm_setzero_ps());
+	__m128 nx = _mm_or_ps(_mm_and_ps(apart, _mm_div_ps(dx, d)), _mm_andnot_ps(apart, _mm_set1_ps(1)));
+	__m128 ny = _mm_and_ps(apart, _mm_div_ps(dy, d));
+	__m128 fs = _mm_mul_ps(k, _mm_sub_ps(d, l0));
+	__m128 fd = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(nx, dvx), _mm_mul_ps(ny, dvy)), kd);
+	__m128 force = _mm_add_ps(fs, fd);
+
+	_mm_store_ps(fx, _mm_mul_ps(force, nx));
+	_mm_store_ps(fy, _mm_mul_ps(force, ny));
+
+	for (int l = 0; l < 4; l++){
+		nodes->ax[a[l]] -= fx[l];
+		nodes->ay[a[l]] -= fy[l];
+		nodes->ax[b[l]] += fx[l];
+		nodes->ay[b[l]] += fy[l];
+	}
+}
+
+SSE2 static void springs_sse(Nodes* nodes, Springs* springs, int begin, int end, float K, float Kd, float L0){
+	const __m128 k = _mm_set1_ps(K);
+	const __m128 kd = _mm_set1_ps(Kd);
+	const __m128 l0 = _mm_set1_ps(L0);
+	int s = begin;
+	for (; s + 4 <= end; s += 4){
+		block_sse(nodes, springs, s, k, kd, l0);
+	}
+	Kernels_scalar().springs(nodes, springs, s, end, K, Kd, L0);
+}
+
+SSE2 static void springs_materials_sse(Nodes* nodes, Springs* springs, int begin, int end){
+	int s = begin;
+	for (; s + 4 <= end; s += 4){
+		block_sse(nodes, springs, s, _mm_loadu_ps(springs->stiffness + s), _mm_loadu_ps(springs->damping + s),
+				_mm_loadu_ps(springs->rest + s));
+	}
+	Kernels_scalar().springs_materials(nodes, springs, s, end);
+}
+
+SSE2 static void integrate_sse(Nodes* nodes, int begin, int end, float dt, float drag, float w, float h){
+	Kernels scalar = Kernels_scalar();
+
+	int i = (begin + 3) & ~3;
+	if (i > end){
+		i = end;
+	}
+	scalar.integrate(nodes, begin, i, dt, drag, w, h);
+
+	const __m128 vdt = _mm_set1_ps(dt);
+	const __m128 vdrag = _mm_set1_ps(drag);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 vw = _mm_set1_ps(w);
+	const __m128 vh = _mm_set1_ps(h);
+	const __m128 sign = _mm_set1_ps(-0.f);
+	const __m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+
+	for (; i + 4 <= end; i += 4){
+		uint32_t bits = (~nodes->locked[i >> 5] >> (i & 31)) & 0xf;
+		if (bits == 0){
+			continue;
+		}
+		__m128 move = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(bits), lanes), lanes));
+
+		__m128 x0 = _mm_load_ps(nodes->x + i);
+		__m128 y0 = _mm_load_ps(nodes->y + i);
+		__m128 vx0 = _mm_load_ps(nodes->vx + i);
+		__m128 vy0 = _mm_load_ps(nodes->vy + i);
+
+		__m128 vx = _mm_mul_ps(_mm_add_ps(vx0, _mm_mul_ps(vdt, _mm_load_ps(nodes->ax + i))), vdrag);
+		__m128 vy = _mm_mul_ps(_mm_add_ps(vy0, _mm_mul_ps(vdt, _mm_load_ps(nodes->ay + i))), vdrag);
+		__m128 x = _mm_add_ps(x0, _mm_mul_ps(vdt, vx));
+		__m128 y = _mm_add_ps(y0, _mm_mul_ps(vdt, vy));
+
+		__m128 left = _mm_cmplt_ps(x, zero);
+		__m128 right = _mm_cmpgt_ps(x, vw);
+		__m128 up = _mm_cmplt_ps(y, zero);
+		__m128 down = _mm_cmpgt_ps(y, vh);
+		__m128 outside = _mm_or_ps(_mm_or_ps(left, right), _mm_or_ps(up, down));
+		vx = _mm_xor_ps(vx, _mm_and_ps(outside, sign));
+		vy = _mm_xor_ps(vy, _mm_and_ps(outside, sign));
+		x = select_ps(right, select_ps(left, x, zero), vw);
+		y = select_ps(down, select_ps(up, y, zero), vh);
+
+		_mm_store_ps(nodes->x + i, select_ps(move, x0, x));
+		_mm_store_ps(nodes->y + i, select_ps(move, y0, y));
+		_mm_store_ps(nodes->vx + i, select_ps(move, vx0, vx));
+		_mm_store_ps(nodes->vy + i, select_ps(move, vy0, vy));
+	}
+
+	scalar.integrate(nodes, i, end, dt, drag, w, h);
+}
+
+Kernels Kernels_sse(){
+	Kernels kernels = {"sse", 4, springs_sse, springs_materials_sse, integrate_sse};
+	return kernels;
+}
+
+#endif
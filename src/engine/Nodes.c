@@ -0,0 +1,188 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "Nodes.h"
+
+static float* allocate_floats(int capacity){
+	// capacity is a multiple of NODES_LANES, so the size is a multiple of the alignment as aligned_alloc requires.
+	float* array = aligned_alloc(NODES_ALIGNMENT, capacity*sizeof(float));
+	if (array != NULL){
+		memset(array, 0, capacity*sizeof(float));
+	}
+	return array;
+}
+
+static uint32_t* allocate_mask(int capacity){
+	// one spare word so that the kernels can read the bits of a whole block of lanes past the last node.
+	return calloc(capacity/32 + 1, sizeof(uint32_t));
+}
+
+static int round_capacity(int capacity){
+	capacity = (capacity + NODES_LANES-1) / NODES_LANES * NODES_LANES;
+	return (capacity == 0)?NODES_LANES:capacity;
+}
+
+char Nodes_create(Nodes* nodes, int capacity){
+	capacity = round_capacity(capacity);
+
+	nodes->x  = allocate_floats(capacity);
+	nodes->y  = allocate_floats(capacity);
+	nodes->vx = allocate_floats(capacity);
+	nodes->vy = allocate_floats(capacity);
+	nodes->ax = allocate_floats(capacity);
+	nodes->ay = allocate_floats(capacity);
+	nodes->px = allocate_floats(capacity);
+	nodes->py = allocate_floats(capacity);
+	nodes->locked = allocate_mask(capacity);
+	nodes->count = 0;
+	nodes->capacity = capacity;
+	nodes->borrowed = 0;
+
+	if (!nodes->x || !nodes->y || !nodes->vx || !nodes->vy || !nodes->ax || !nodes->ay
+			|| !nodes->px || !nodes->py || !nodes->locked){
+		Nodes_free(nodes);
+		return 1;
+	}
+	return 0;
+}
+
+char Nodes_reserve(Nodes* nodes, int capacity){
+	if (capacity <= nodes->capacity){
+		return 0;
+	}
+	// aligned memory cannot be reallocated, a new store is made and the nodes are copied into it.
+	Nodes grown;
+	if (Nodes_create(&grown, capacity)){
+		return 1;
+	}
+	float** from[] = {&nodes->x, &nodes->y, &nodes->vx, &nodes->vy, &nodes->ax, &nodes->ay, &nodes->px, &nodes->py};
+	float** to[] = {&grown.x, &grown.y, &grown.vx, &grown.vy, &grown.ax, &grown.ay, &grown.px, &grown.py};
+	for (int a = 0; a < (int)(sizeof(from)/sizeof(from[0])); a++){
+		memcpy(*to[a], *from[a], nodes->count*sizeof(float));
+	}
+	memcpy(grown.locked, nodes->locked, (nodes->count+31)/32*sizeof(uint32_t));
+	grown.count = nodes->count;
+	Nodes_free(nodes);
+	*nodes = grown;
+	return 0;
+}
+
+char Nodes_wrap(Nodes* nodes, float* x, float* y, uint32_t* locked, int count, int capacity){
+	nodes->x  = x;
+	nodes->y  = y;
+	nodes->vx = allocate_floats(capacity);
+	nodes->vy = allocate_floats(capacity);
+	nodes->ax = allocate_floats(capacity);
+	nodes->ay = allocate_floats(capacity);
+	nodes->px = aligned_alloc(NODES_ALIGNMENT, capacity*sizeof(float));
+	nodes->py = aligned_alloc(NODES_ALIGNMENT, capacity*sizeof(float));
+	nodes->locked = locked;
+	nodes->count = count;
+	nodes->capacity = capacity;
+	nodes->borrowed = 1;
+
+	if (!nodes->vx || !nodes->vy || !nodes->ax || !nodes->ay || !nodes->px || !nodes->py){
+		Nodes_free(nodes);
+		return 1;
+	}
+	Nodes_save_positions(nodes);
+	return 0;
+}
+
+void Nodes_set(Nodes* nodes, int i, float x, float y, char locked){
+	nodes->x[i] = x;
+	nodes->y[i] = y;
+	nodes->vx[i] = 0;
+	nodes->vy[i] = 0;
+	nodes->ax[i] = 0;
+	nodes->ay[i] = 0;
+	nodes->px[i] = x;
+	nodes->py[i] = y;
+	Nodes_set_flag(nodes->locked, i, locked);
+}
+
+int Nodes_add(Nodes* nodes, float x, float y, char locked){
+	if (nodes->count == nodes->capacity && Nodes_reserve(nodes, 2*nodes->capacity)){
+		return -1;
+	}
+	int i = nodes->count++;
+	Nodes_set(nodes, i, x, y, locked);
+	return i;
+}
+
+void Nodes_move(Nodes* nodes, int from, int to){
+	nodes->x[to] = nodes->x[from];
+	nodes->y[to] = nodes->y[from];
+	nodes->vx[to] = nodes->vx[from];
+	nodes->vy[to] = nodes->vy[from];
+	nodes->ax[to] = nodes->ax[from];
+	nodes->ay[to] = nodes->ay[from];
+	nodes->px[to] = nodes->px[from];
+	nodes->py[to] = nodes->py[from];
+	Nodes_set_flag(nodes->locked, to, Nodes_get_flag(nodes->locked, from));
+}
+
+int Nodes_remove(Nodes* nodes, int i){
+	int last = --nodes->count;
+	Nodes_move(nodes, last, i);
+	// the bits past the last node stay cleared, so that the kernels reading whole words see no locked node there.
+	Nodes_set_flag(nodes->locked, last, 0);
+	return last;
+}
+
+char Nodes_permute(Nodes* nodes, const int* order){
+	int n = nodes->count;
+	float* scratch = malloc((n > 0)?n*sizeof(float):1);
+	uint32_t* locked = calloc((n+31)/32 + 1, sizeof(uint32_t));
+	if (scratch == NULL || locked == NULL){
+		free(scratch);
+		free(locked);
+		return 1;
+	}
+	// every field is gathered into the scratch array and copied back, so that borrowed arrays are reordered in place.
+	float* fields[] = {nodes->x, nodes->y, nodes->vx, nodes->vy, nodes->ax, nodes->ay, nodes->px, nodes->py};
+	for (int f = 0; f < (int)(sizeof(fields)/sizeof(fields[0])); f++){
+		for (int k = 0; k < n; k++){
+			scratch[k] = fields[f][order[k]];
+		}
+		memcpy(fields[f], scratch, n*sizeof(float));
+	}
+	for (int k = 0; k < n; k++){
+		Nodes_set_flag(locked, k, Nodes_get_flag(nodes->locked, order[k]));
+	}
+	memcpy(nodes->locked, locked, (n+31)/32*sizeof(uint32_t));
+	free(scratch);
+	free(locked);
+	return 0;
+}
+
+void Nodes_save_positions(Nodes* nodes){
+	memcpy(nodes->px, nodes->x, nodes->count*sizeof(float));
+	memcpy(nodes->py, nodes->y, nodes->count*sizeof(float));
+}
+
+void Nodes_interpolate(const Nodes* nodes, float alpha, float* x, float* y){
+	const float* restrict x0 = nodes->px;
+	const float* restrict y0 = nodes->py;
+	const float* restrict x1 = nodes->x;
+	const float* restrict y1 = nodes->y;
+	for (int i = 0; i < nodes->count; i++){
+		x[i] = x0[i] + alpha * (x1[i] - x0[i]);
+		y[i] = y0[i] + alpha * (y1[i] - y0[i]);
+	}
+}
+
+void Nodes_free(Nodes* nodes){
+	if (!nodes->borrowed){
+		free(nodes->x);
+		free(nodes->y);
+		free(nodes->locked);
+	}
+	free(nodes->vx);
+	free(nodes->vy);
+	free(nodes->ax);
+	free(nodes->ay);
+	free(nodes->px);
+	free(nodes->py);
+	memset(nodes, 0, sizeof(Nodes));
+}
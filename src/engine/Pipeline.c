@@ -0,0 +1,359 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Pipeline.h"
+#include "Profiler.h"
+
+double Pipeline_now(){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+/* Reallocates an array to a given number of elements, leaving it untouched on failure. */
+static char grow(void** array, int count, size_t size){
+	void* grown = realloc(*array, count*size);
+	if (grown == NULL){
+		return 1;
+	}
+	*array = grown;
+	return 0;
+}
+
+/* Makes sure a snapshot can hold the nodes and the springs of a simulation. */
+static char reserve(Snapshot* snapshot, const Simulation* sim){
+	Nodes* nodes = &snapshot->nodes;
+	if (sim->nodes.capacity > nodes->capacity){
+		int capacity = sim->nodes.capacity;
+		if (grow((void**)&nodes->x, capacity, sizeof(float)) || grow((void**)&nodes->y, capacity, sizeof(float))
+				|| grow((void**)&nodes->px, capacity, sizeof(float)) || grow((void**)&nodes->py, capacity, sizeof(float))
+				|| grow((void**)&nodes->locked, (capacity+31)/32, sizeof(uint32_t))){
+			return 1;
+		}
+		nodes->capacity = capacity;
+	}
+	Springs* springs = &snapshot->springs;
+	if (sim->springs.count > springs->capacity){
+		int capacity = sim->springs.capacity;
+		if (grow((void**)&springs->a, capacity, sizeof(int)) || grow((void**)&springs->b, capacity, sizeof(int))){
+			return 1;
+		}
+		springs->capacity = capacity;
+	}
+	if (sim->springs.count > snapshot->bin_capacity){
+		int capacity = sim->springs.capacity;
+		if (grow((void**)&snapshot->bins, 2*capacity, sizeof(int))
+				|| grow((void**)&snapshot->bin_offsets, capacity+1, sizeof(int))){
+			return 1;
+		}
+		snapshot->bin_capacity = capacity;
+	}
+	int nb_tiles = (sim->nodes.count + PIPELINE_TILE-1)/PIPELINE_TILE;
+	if (nb_tiles > snapshot->tile_capacity){
+		if (grow((void**)&snapshot->tiles, nb_tiles, sizeof(BvhBox))){
+			return 1;
+		}
+		snapshot->tile_capacity = nb_tiles;
+	}
+	if (sim->grab.count > snapshot->grabbed_capacity){
+		if (grow((void**)&snapshot->grabbed, sim->grab.count, sizeof(int))){
+			return 1;
+		}
+		snapshot->grabbed_capacity = sim->grab.count;
+	}
+	return 0;
+}
+
+/* Measures the bounding box of every tile of the nodes of a snapshot, over both of their states. */
+static void bound_tiles(Snapshot* snapshot){
+	const Nodes* nodes = &snapshot->nodes;
+	snapshot->nb_tiles = (nodes->count + PIPELINE_TILE-1)/PIPELINE_TILE;
+	for (int t = 0; t < snapshot->nb_tiles; t++){
+		int begin = t*PIPELINE_TILE;
+		int end = (begin + PIPELINE_TILE < nodes->count)?begin + PIPELINE_TILE:nodes->count;
+		BvhBox box = {nodes->x[begin], nodes->y[begin], nodes->x[begin], nodes->y[begin]};
+		// branchless minima and maxima, which the compiler vectorizes.
+		for (int i = begin; i < end; i++){
+			float min_x = (nodes->x[i] < nodes->px[i])?nodes->x[i]:nodes->px[i];
+			float max_x = (nodes->x[i] > nodes->px[i])?nodes->x[i]:nodes->px[i];
+			float min_y = (nodes->y[i] < nodes->py[i])?nodes->y[i]:nodes->py[i];
+			float max_y = (nodes->y[i] > nodes->py[i])?nodes->y[i]:nodes->py[i];
+			box.min_x = (min_x < box.min_x)?min_x:box.min_x;
+			box.max_x = (max_x > box.max_x)?max_x:box.max_x;
+			box.min_y = (min_y < box.min_y)?min_y:box.min_y;
+			box.max_y = (max_y > box.max_y)?max_y:box.max_y;
+		}
+		snapshot->tiles[t] = box;
+	}
+}
+
+/* Gives the lower and the higher of the tiles of the ends of a spring. */
+static inline void tiles_of(const Springs* springs, int s, int* low, int* high){
+	int a = springs->a[s]/PIPELINE_TILE;
+	int b = springs->b[s]/PIPELINE_TILE;
+	*low = (a < b)?a:b;
+	*high = (a < b)?b:a;
+}
+
+/* Copies the springs of the simulation into a snapshot, sorted into bins by the tiles of their ends, the lower tile
+ * first. Two counting sorts, by the higher tile then by the lower one, make the sort O(E + tiles). */
+static char bin_springs(Pipeline* pipeline, Snapshot* snapshot){
+	const Springs* springs = &pipeline->sim->springs;
+	int e = springs->count;
+	int nb_tiles = (pipeline->sim->nodes.count + PIPELINE_TILE-1)/PIPELINE_TILE;
+	if (e + nb_tiles+1 > pipeline->scratch_capacity){
+		if (grow((void**)&pipeline->scratch, e + nb_tiles+1, sizeof(int))){
+			return 1;
+		}
+		pipeline->scratch_capacity = e + nb_tiles+1;
+	}
+	int* order = pipeline->scratch;
+	int* count = pipeline->scratch + e;
+	// the first sort goes into the ends of the snapshot, which are only spring indices until the second one.
+	int* sorted = snapshot->springs.a;
+	for (int pass = 0; pass < 2; pass++){
+		const int* from = (pass == 0)?NULL:sorted;
+		int* to = (pass == 0)?sorted:order;
+		memset(count, 0, (nb_tiles+1)*sizeof(int));
+		for (int k = 0; k < e; k++){
+			int low, high;
+			tiles_of(springs, (from == NULL)?k:from[k], &low, &high);
+			count[((pass == 0)?high:low)+1]++;
+		}
+		for (int t = 0; t < nb_tiles; t++){
+			count[t+1] += count[t];
+		}
+		for (int k = 0; k < e; k++){
+			int s = (from == NULL)?k:from[k];
+			int low, high;
+			tiles_of(springs, s, &low, &high);
+			to[count[(pass == 0)?high:low]++] = s;
+		}
+	}
+
+	// a new bin starts wherever the pair of tiles changes.
+	int nb_bins = 0;
+	int previous_low = -1, previous_high = -1;
+	for (int k = 0; k < e; k++){
+		int s = order[k];
+		snapshot->springs.a[k] = springs->a[s];
+		snapshot->springs.b[k] = springs->b[s];
+		int low, high;
+		tiles_of(springs, s, &low, &high);
+		if (low != previous_low || high != previous_high){
+			snapshot->bins[2*nb_bins] = low;
+			snapshot->bins[2*nb_bins+1] = high;
+			snapshot->bin_offsets[nb_bins++] = k;
+			previous_low = low;
+			previous_high = high;
+		}
+	}
+	snapshot->bin_offsets[nb_bins] = e;
+	snapshot->nb_bins = nb_bins;
+	snapshot->springs.count = e;
+	snapshot->springs.topology = springs->topology;
+	return 0;
+}
+
+/* Copies the state of the simulation into the back snapshot and swaps it with the shared one. */
+static char publish(Pipeline* pipeline, double physics){
+	PROFILE_BEGIN("publish");
+	const Simulation* sim = pipeline->sim;
+	Snapshot* snapshot = &pipeline->snapshots[pipeline->back];
+	if (reserve(snapshot, sim)){
+		PROFILE_END();
+		return 1;
+	}
+	int n = sim->nodes.count;
+	memcpy(snapshot->nodes.x, sim->nodes.x, n*sizeof(float));
+	memcpy(snapshot->nodes.y, sim->nodes.y, n*sizeof(float));
+	memcpy(snapshot->nodes.px, sim->nodes.px, n*sizeof(float));
+	memcpy(snapshot->nodes.py, sim->nodes.py, n*sizeof(float));
+	memcpy(snapshot->nodes.locked, sim->nodes.locked, (n+31)/32*sizeof(uint32_t));
+	snapshot->nodes.count = n;
+	// the springs are only copied when they changed since this snapshot was last published, e.g. when they were colored
+	// or torn, which reorders them in place.
+	if (snapshot->springs.topology != sim->springs.topology && bin_springs(pipeline, snapshot)){
+		PROFILE_END();
+		return 1;
+	}
+	bound_tiles(snapshot);
+	memcpy(snapshot->grabbed, sim->grab.nodes, sim->grab.count*sizeof(int));
+	snapshot->nb_grabbed = sim->grab.count;
+
+	snapshot->alpha = pipeline->stepper.alpha;
+	snapshot->time = Pipeline_now();
+	snapshot->physics = physics;
+	snapshot->sequence = ++pipeline->sequence;
+	// the exchange orders the writes to the snapshot before its index is seen by the renderer.
+	pipeline->back = atomic_exchange(&pipeline->shared, pipeline->back | PIPELINE_FRESH) & ~PIPELINE_FRESH;
+	PROFILE_END();
+	return 0;
+}
+
+/* Applies the requests of the renderer to the simulation. */
+static void apply_input(Pipeline* pipeline){
+	pthread_mutex_lock(&pipeline->input_lock);
+	PipelineInput input = pipeline->input;
+	pipeline->input.grab = 0;
+	pipeline->input.release = 0;
+	pipeline->input.moved = 0;
+	pthread_mutex_unlock(&pipeline->input_lock);
+
+	if (input.release){
+		Simulation_release(pipeline->sim);
+	}
+	if (input.grab){
+		Simulation_grab(pipeline->sim, input.x, input.y, input.radius, input.brush);
+	} else if (input.moved){
+		Simulation_move_grab(pipeline->sim, input.x, input.y);
+	}
+}
+
+static void* run(void* arg){
+	Pipeline* pipeline = arg;
+	Stepper* stepper = &pipeline->stepper;
+	double last = Pipeline_now();
+	while (!atomic_load(&pipeline->stop)){
+		// in lockstep, the last snapshot is left in the shared slot until the renderer took it.
+		if (atomic_load(&pipeline->lockstep) && (atomic_load(&pipeline->shared) & PIPELINE_FRESH)){
+			struct timespec t = {0, PIPELINE_POLL};
+			nanosleep(&t, NULL);
+			continue;
+		}
+		double now = Pipeline_now();
+		double elapsed = now - last;
+		last = now;
+		double wait = stepper->dt;
+		apply_input(pipeline);
+		if (atomic_load(&pipeline->running)){
+			int steps = Stepper_advance(stepper, elapsed);
+			for (int step = 0; step < steps; step++){
+				Simulation_advance(pipeline->sim, stepper->dt);
+			}
+			if (steps > 0 && publish(pipeline, Pipeline_now() - now)){
+				atomic_store(&pipeline->failed, 1);
+				break;
+			}
+			// the thread sleeps until the next step is due.
+			wait = stepper->dt - stepper->accumulator;
+		} else {
+			Stepper_reset(stepper);
+		}
+		if (wait > 0){
+			struct timespec t = {(time_t)wait, (long)((wait - (time_t)wait)*1e9)};
+			nanosleep(&t, NULL);
+		}
+	}
+	return NULL;
+}
+
+char Pipeline_start(Pipeline* pipeline, Simulation* sim, double dt, int max_steps, char running){
+	memset(pipeline->snapshots, 0, sizeof(pipeline->snapshots));
+	for (int s = 0; s < 3; s++){
+		pipeline->snapshots[s].springs = Springs_init();
+		// the springs are copied into every snapshot on its first publication.
+		pipeline->snapshots[s].springs.topology = sim->springs.topology - 1;
+	}
+	pipeline->back = 0;
+	atomic_init(&pipeline->shared, 1);
+	pipeline->front = 2;
+	pipeline->sim = sim;
+	pipeline->stepper = Stepper_init(dt, max_steps);
+	atomic_init(&pipeline->running, running);
+	atomic_init(&pipeline->lockstep, 0);
+	atomic_init(&pipeline->stop, 0);
+	atomic_init(&pipeline->failed, 0);
+	pipeline->sequence = 0;
+	memset(&pipeline->input, 0, sizeof(PipelineInput));
+	pipeline->input.radius = PIPELINE_PICK_RADIUS;
+	pipeline->scratch = NULL;
+	pipeline->scratch_capacity = 0;
+	pthread_mutex_init(&pipeline->input_lock, NULL);
+
+	// the renderer has a state to draw before the first step.
+	if (publish(pipeline, 0) || pthread_create(&pipeline->thread, NULL, run, pipeline)){
+		pipeline->sim = NULL;
+		Pipeline_stop(pipeline);
+		return 1;
+	}
+	return 0;
+}
+
+void Pipeline_set_running(Pipeline* pipeline, char running){
+	atomic_store(&pipeline->running, running);
+}
+
+void Pipeline_set_lockstep(Pipeline* pipeline, char lockstep){
+	atomic_store(&pipeline->lockstep, lockstep);
+}
+
+void Pipeline_set_pick_radius(Pipeline* pipeline, float radius){
+	pthread_mutex_lock(&pipeline->input_lock);
+	pipeline->input.radius = radius;
+	pthread_mutex_unlock(&pipeline->input_lock);
+}
+
+void Pipeline_grab(Pipeline* pipeline, float x, float y, char brush){
+	pthread_mutex_lock(&pipeline->input_lock);
+	pipeline->input.grab = 1;
+	pipeline->input.brush = brush;
+	pipeline->input.x = x;
+	pipeline->input.y = y;
+	pthread_mutex_unlock(&pipeline->input_lock);
+}
+
+void Pipeline_move_grab(Pipeline* pipeline, float x, float y){
+	pthread_mutex_lock(&pipeline->input_lock);
+	pipeline->input.moved = 1;
+	pipeline->input.x = x;
+	pipeline->input.y = y;
+	pthread_mutex_unlock(&pipeline->input_lock);
+}
+
+void Pipeline_release(Pipeline* pipeline){
+	pthread_mutex_lock(&pipeline->input_lock);
+	pipeline->input.release = 1;
+	pipeline->input.grab = 0;
+	pthread_mutex_unlock(&pipeline->input_lock);
+}
+
+const Snapshot* Pipeline_acquire(Pipeline* pipeline){
+	if (atomic_load(&pipeline->shared) & PIPELINE_FRESH){
+		pipeline->front = atomic_exchange(&pipeline->shared, pipeline->front) & ~PIPELINE_FRESH;
+	}
+	return &pipeline->snapshots[pipeline->front];
+}
+
+float Pipeline_alpha(const Snapshot* snapshot, double dt, double now){
+	double alpha = snapshot->alpha + (now - snapshot->time)/dt;
+	return (alpha < 0)?0:(alpha > 1)?1:alpha;
+}
+
+void Pipeline_stop(Pipeline* pipeline){
+	if (pipeline->sim != NULL){
+		atomic_store(&pipeline->stop, 1);
+		pthread_join(pipeline->thread, NULL);
+		pipeline->sim = NULL;
+	}
+	for (int s = 0; s < 3; s++){
+		Snapshot* snapshot = &pipeline->snapshots[s];
+		free(snapshot->nodes.x);
+		free(snapshot->nodes.y);
+		free(snapshot->nodes.px);
+		free(snapshot->nodes.py);
+		free(snapshot->nodes.locked);
+		free(snapshot->springs.a);
+		free(snapshot->springs.b);
+		free(snapshot->tiles);
+		free(snapshot->bins);
+		free(snapshot->bin_offsets);
+		free(snapshot->grabbed);
+		memset(snapshot, 0, sizeof(Snapshot));
+	}
+	free(pipeline->scratch);
+	pipeline->scratch = NULL;
+	pipeline->scratch_capacity = 0;
+	pthread_mutex_destroy(&pipeline->input_lock);
+}
@@ -0,0 +1,145 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "Profiler.h"
+
+/* The default clock, in nanoseconds. */
+static uint64_t monotonic(){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec*1000000000u + t.tv_nsec;
+}
+
+static Profiler_clock now = monotonic;
+static uint64_t clock_frequency = 1000000000u;
+
+/* The rings of every thread, in the order they were created. */
+static ProfilerRing* _Atomic rings[PROFILER_MAX_THREADS];
+static atomic_int nb_rings;
+
+/* The ring of the calling thread, and whether it could not have one. */
+static _Thread_local ProfilerRing* ring;
+static _Thread_local char unrecorded;
+
+void Profiler_set_clock(Profiler_clock clock, uint64_t frequency){
+	now = clock;
+	clock_frequency = frequency;
+}
+
+/* Creates the ring of the calling thread. */
+static ProfilerRing* create_ring(){
+	int thread = atomic_fetch_add(&nb_rings, 1);
+	if (thread >= PROFILER_MAX_THREADS){
+		unrecorded = 1;
+		return NULL;
+	}
+	ProfilerRing* created = calloc(1, sizeof(ProfilerRing));
+	if (created == NULL){
+		unrecorded = 1;
+		return NULL;
+	}
+	atomic_init(&created->head, 0);
+	created->thread = thread;
+	atomic_store(&rings[thread], created);
+	return created;
+}
+
+void Profiler_begin(const char* name){
+	ProfilerRing* r = ring;
+	if (r == NULL){
+		if (unrecorded || (r = ring = create_ring()) == NULL){
+			return;
+		}
+	}
+	int depth = r->depth++;
+	if (depth < PROFILER_MAX_DEPTH){
+		r->names[depth] = name;
+		r->starts[depth] = now();
+	}
+}
+
+void Profiler_end(){
+	uint64_t end = now();
+	ProfilerRing* r = ring;
+	if (r == NULL || r->depth == 0){
+		return;
+	}
+	int depth = --r->depth;
+	if (depth >= PROFILER_MAX_DEPTH){
+		return;
+	}
+	// the ring has a single writer, the event only has to be complete before the head is published.
+	uint64_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+	ProfilerEvent* event = &r->events[head & (PROFILER_RING_SIZE-1)];
+	event->name = r->names[depth];
+	event->begin = r->starts[depth];
+	event->end = end;
+	atomic_store_explicit(&r->head, head+1, memory_order_release);
+}
+
+/* Gives the range [first, head) of the scopes still held by a ring. */
+static uint64_t first_event(ProfilerRing* r, uint64_t* head){
+	*head = atomic_load_explicit(&r->head, memory_order_acquire);
+	return (*head > PROFILER_RING_SIZE)?*head - PROFILER_RING_SIZE:0;
+}
+
+char Profiler_dump(const char* path){
+	FILE* file = fopen(path, "w");
+	if (file == NULL){
+		fprintf(stderr, "Could not open %s.\n", path);
+		return 1;
+	}
+	int count = atomic_load(&nb_rings);
+	count = (count < PROFILER_MAX_THREADS)?count:PROFILER_MAX_THREADS;
+
+	// the times are given from the earliest scope, so that they stay small.
+	uint64_t origin = UINT64_MAX;
+	for (int t = 0; t < count; t++){
+		ProfilerRing* r = atomic_load(&rings[t]);
+		if (r == NULL){
+			continue;
+		}
+		uint64_t head;
+		for (uint64_t e = first_event(r, &head); e < head; e++){
+			uint64_t begin = r->events[e & (PROFILER_RING_SIZE-1)].begin;
+			origin = (begin < origin)?begin:origin;
+		}
+	}
+
+	double us = 1e6 / clock_frequency;
+	char first = 1;
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	for (int t = 0; t < count; t++){
+		ProfilerRing* r = atomic_load(&rings[t]);
+		if (r == NULL){
+			continue;
+		}
+		fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+				"\"args\":{\"name\":\"thread %d\"}}", first?"":",", r->thread, r->thread);
+		first = 0;
+		uint64_t head;
+		for (uint64_t e = first_event(r, &head); e < head; e++){
+			const ProfilerEvent* event = &r->events[e & (PROFILER_RING_SIZE-1)];
+			fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+					event->name, r->thread, (event->begin - origin)*us, (event->end - event->begin)*us);
+		}
+	}
+	fprintf(file, "\n]}\n");
+
+	if (fclose(file)){
+		fprintf(stderr, "Could not write %s.\n", path);
+		return 1;
+	}
+	return 0;
+}
+
+void Profiler_free(){
+	int count = atomic_exchange(&nb_rings, 0);
+	count = (count < PROFILER_MAX_THREADS)?count:PROFILER_MAX_THREADS;
+	for (int t = 0; t < count; t++){
+		free(atomic_exchange(&rings[t], NULL));
+	}
+	ring = NULL;
+	unrecorded = 0;
+}
@@ -0,0 +1,184 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Scene.h"
+
+/* The size of the node blocks for a given number of nodes, as laid out by Nodes_create. */
+static int node_capacity(int nb_nodes){
+	int capacity = (nb_nodes + NODES_LANES-1) / NODES_LANES * NODES_LANES;
+	return (capacity == 0)?NODES_LANES:capacity;
+}
+
+static uint64_t align(uint64_t offset){
+	return (offset + SCENE_ALIGNMENT-1) / SCENE_ALIGNMENT * SCENE_ALIGNMENT;
+}
+
+/* Tells whether a block lies inside the file, and is aligned. */
+static char valid_block(const Scene* scene, uint64_t offset, uint64_t size){
+	return offset % SCENE_ALIGNMENT == 0 && offset <= scene->size && size <= scene->size - offset;
+}
+
+char Scene_open(Scene* scene, const char* path){
+	scene->data = NULL;
+	scene->size = 0;
+	scene->header = NULL;
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0){
+		fprintf(stderr, "Could not open the scene %s.\n", path);
+		return 1;
+	}
+	struct stat status;
+	if (fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(SceneHeader)){
+		fprintf(stderr, "The scene %s is too small to be a scene.\n", path);
+		close(fd);
+		return 1;
+	}
+	// the mapping is private and writable, so that the simulation moves the nodes in place without touching the file.
+	void* data = mmap(NULL, status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED){
+		fprintf(stderr, "Could not map the scene %s.\n", path);
+		return 1;
+	}
+	scene->data = data;
+	scene->size = status.st_size;
+	scene->header = data;
+
+	const SceneHeader* header = scene->header;
+	if (memcmp(header->magic, SCENE_MAGIC, sizeof(header->magic)) != 0 || header->version != SCENE_VERSION
+			|| header->header_size != sizeof(SceneHeader) || header->nb_nodes > INT32_MAX
+			|| header->nb_springs > INT32_MAX){
+		fprintf(stderr, "The scene %s is not a version %d scene.\n", path, SCENE_VERSION);
+		Scene_close(scene);
+		return 1;
+	}
+	uint64_t capacity = node_capacity(header->nb_nodes);
+	uint64_t nb_springs = header->nb_springs;
+	if (!valid_block(scene, header->x, capacity*sizeof(float)) || !valid_block(scene, header->y, capacity*sizeof(float))
+			|| !valid_block(scene, header->locked, (capacity/32 + 1)*sizeof(uint32_t))
+			|| !valid_block(scene, header->a, nb_springs*sizeof(int))
+			|| !valid_block(scene, header->b, nb_springs*sizeof(int))){
+		fprintf(stderr, "The blocks of the scene %s do not fit in the file.\n", path);
+		Scene_close(scene);
+		return 1;
+	}
+
+	// a spring to a node out of the store would make the kernels write out of the arrays.
+	const int* a = (const int*)((const char*)data + header->a);
+	const int* b = (const int*)((const char*)data + header->b);
+	int nb_nodes = header->nb_nodes;
+	char valid = 1;
+	for (uint64_t s = 0; s < nb_springs; s++){
+		valid &= (unsigned)a[s] < (unsigned)nb_nodes;
+		valid &= (unsigned)b[s] < (unsigned)nb_nodes;
+	}
+	if (!valid){
+		fprintf(stderr, "The scene %s has springs between nodes that do not exist.\n", path);
+		Scene_close(scene);
+		return 1;
+	}
+	return 0;
+}
+
+char Scene_load(const Scene* scene, Simulation* sim){
+	const SceneHeader* header = scene->header;
+	char* data = scene->data;
+	if (Simulation_create(sim, 0, header->width, header->height)){
+		return 1;
+	}
+	sim->K = header->K;
+	sim->Kd = header->Kd;
+	sim->L0 = header->L0;
+
+	// the store made by Simulation_create is replaced by one on top of the mapped blocks.
+	Nodes_free(&sim->nodes);
+	if (Nodes_wrap(&sim->nodes, (float*)(data + header->x), (float*)(data + header->y),
+			(uint32_t*)(data + header->locked), header->nb_nodes, node_capacity(header->nb_nodes))){
+		Simulation_free(sim);
+		return 1;
+	}
+	sim->springs = Springs_wrap((int*)(data + header->a), (int*)(data + header->b), header->nb_springs);
+	if (sim->springs.length == NULL){
+		Simulation_free(sim);
+		return 1;
+	}
+	Springs_measure(&sim->springs, sim->nodes.x, sim->nodes.y);
+	return 0;
+}
+
+/* Writes a block at the current position of the file, padded to the alignment, and gives its offset. */
+static char write_block(FILE* file, const void* block, size_t size, size_t padded, uint64_t* offset){
+	static const char zeros[SCENE_ALIGNMENT] = {0};
+	long position = ftell(file);
+	if (position < 0 || fseek(file, align(position), SEEK_SET) != 0){
+		return 1;
+	}
+	*offset = align(position);
+	if (size > 0 && fwrite(block, 1, size, file) != size){
+		return 1;
+	}
+	for (size_t written = size; written < padded; written += SCENE_ALIGNMENT){
+		size_t chunk = (padded - written < SCENE_ALIGNMENT)?padded - written:SCENE_ALIGNMENT;
+		if (fwrite(zeros, 1, chunk, file) != chunk){
+			return 1;
+		}
+	}
+	return 0;
+}
+
+char Scene_save(const Simulation* sim, const char* path){
+	const Nodes* nodes = &sim->nodes;
+	const Springs* springs = &sim->springs;
+	FILE* file = fopen(path, "wb");
+	if (file == NULL){
+		fprintf(stderr, "Could not create the scene %s.\n", path);
+		return 1;
+	}
+
+	SceneHeader header;
+	memset(&header, 0, sizeof(SceneHeader));
+	memcpy(header.magic, SCENE_MAGIC, sizeof(header.magic));
+	header.version = SCENE_VERSION;
+	header.header_size = sizeof(SceneHeader);
+	header.nb_nodes = nodes->count;
+	header.nb_springs = springs->count;
+	header.K = sim->K;
+	header.Kd = sim->Kd;
+	header.L0 = sim->L0;
+	header.width = sim->width;
+	header.height = sim->height;
+
+	// the header is written twice, the second time with the offsets of the blocks.
+	int capacity = node_capacity(nodes->count);
+	size_t mask_size = (capacity/32 + 1)*sizeof(uint32_t);
+	size_t nodes_mask_size = ((nodes->count + 31)/32)*sizeof(uint32_t);
+	char error = fwrite(&header, sizeof(SceneHeader), 1, file) != 1
+			|| write_block(file, nodes->x, nodes->count*sizeof(float), capacity*sizeof(float), &header.x)
+			|| write_block(file, nodes->y, nodes->count*sizeof(float), capacity*sizeof(float), &header.y)
+			|| write_block(file, nodes->locked, nodes_mask_size, mask_size, &header.locked)
+			|| write_block(file, springs->a, springs->count*sizeof(int), springs->count*sizeof(int), &header.a)
+			|| write_block(file, springs->b, springs->count*sizeof(int), springs->count*sizeof(int), &header.b)
+			|| fseek(file, 0, SEEK_SET) != 0
+			|| fwrite(&header, sizeof(SceneHeader), 1, file) != 1;
+	error |= fclose(file) != 0;
+	if (error){
+		fprintf(stderr, "Could not write the scene %s.\n", path);
+		return 1;
+	}
+	return 0;
+}
+
+void Scene_close(Scene* scene){
+	if (scene->data != NULL){
+		munmap(scene->data, scene->size);
+	}
+	scene->data = NULL;
+	scene->size = 0;
+	scene->header = NULL;
+}
@@ -0,0 +1,569 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Simulation.h"
+#include "Profiler.h"
+
+/* The context of the tasks run by the thread pool. */
+typedef struct Step{
+	Simulation* sim;
+	float dt;
+} Step;
+
+static void clear_task(void* context, int begin, int end, int thread){
+	(void)thread;
+	Simulation* sim = ((Step*)context)->sim;
+	Kernels_clear(&sim->nodes, begin, end, 0, sim->gravity);
+}
+
+static void springs_task(void* context, int begin, int end, int thread){
+	(void)thread;
+	Simulation* sim = ((Step*)context)->sim;
+	if (sim->springs.stiffness != NULL){
+		sim->kernels.springs_materials(&sim->nodes, &sim->springs, begin, end);
+	} else {
+		sim->kernels.springs(&sim->nodes, &sim->springs, begin, end, sim->K, sim->Kd, sim->L0);
+	}
+}
+
+/* Every node sums the contact forces of its neighbours onto itself only, so that the nodes can be split between threads:
+ * every pair is visited twice, once from each side, but nothing is ever written by two threads. */
+static void contacts_task(void* context, int begin, int end, int thread){
+	(void)thread;
+	Simulation* sim = ((Step*)context)->sim;
+	Nodes* nodes = &sim->nodes;
+	const Grid* grid = &sim->grid;
+	float radius = sim->contact_radius;
+	int buckets[4];
+
+	for (int i = begin; i < end; i++){
+		float xi = nodes->x[i];
+		float yi = nodes->y[i];
+		float fx = 0, fy = 0;
+		int nb_buckets = Grid_neighbourhood(grid, xi, yi, buckets);
+		for (int b = 0; b < nb_buckets; b++){
+			for (int k = grid->bucket_start[buckets[b]]; k < grid->bucket_start[buckets[b]+1]; k++){
+				float dx = xi - grid->sorted_x[k];
+				float dy = yi - grid->sorted_y[k];
+				float d2 = dx*dx + dy*dy;
+				// coincident nodes, as a node and itself, have no direction to be pushed along.
+				if (d2 >= radius*radius || d2 == 0){
+					continue;
+				}
+				int j = grid->sorted[k];
+				float d = sqrtf(d2);
+				float nx = dx / d;
+				float ny = dy / d;
+				float vn = nx * (nodes->vx[i] - nodes->vx[j]) + ny * (nodes->vy[i] - nodes->vy[j]);
+				float force = sim->contact_K * (radius - d) - sim->contact_Kd * vn;
+				// contacts push the nodes apart, they never pull them together.
+				if (force > 0){
+					fx += force * nx;
+					fy += force * ny;
+				}
+			}
+		}
+		nodes->ax[i] += fx;
+		nodes->ay[i] += fy;
+	}
+}
+
+static void predict_task(void* context, int begin, int end, int thread){
+	(void)thread;
+	Simulation* sim = ((Step*)context)->sim;
+	Xpbd_predict(&sim->nodes, begin, end, ((Step*)context)->dt, sim->drag);
+}
+
+static void project_task(void* context, int begin, int end, int thread){
+	(void)thread;
+	Simulation* sim = ((Step*)context)->sim;
+	Xpbd_project(&sim->xpbd, &sim->nodes, &sim->springs, begin, end, ((Step*)context)->dt, sim->K, sim->Kd, sim->L0);
+}
+
+static void finish_task(void* context, int begin, int end, int thread){
+	(void)thread;
+	Simulation* sim = ((Step*)context)->sim;
+	Xpbd_finish(&sim->nodes, begin, end, ((Step*)context)->dt, sim->width, sim->height);
+}
+
+static void integrate_task(void* context, int begin, int end, int thread){
+	(void)thread;
+	Simulation* sim = ((Step*)context)->sim;
+	Nodes* nodes = &sim->nodes;
+	memcpy(nodes->px + begin, nodes->x + begin, (end-begin)*sizeof(float));
+	memcpy(nodes->py + begin, nodes->y + begin, (end-begin)*sizeof(float));
+	sim->kernels.integrate(nodes, begin, end, ((Step*)context)->dt, sim->drag, sim->width, sim->height);
+}
+
+char Simulation_create(Simulation* sim, int capacity, float width, float height){
+	if (Nodes_create(&sim->nodes, capacity)){
+		return 1;
+	}
+	sim->springs = Springs_init();
+	sim->kernels = Kernels_select();
+	sim->pool = NULL;
+
+	sim->K = SIMULATION_K;
+	sim->Kd = SIMULATION_KD;
+	sim->L0 = SIMULATION_L0;
+	sim->gravity = SIMULATION_GRAVITY;
+	sim->drag = SIMULATION_DRAG;
+	sim->width = width;
+	sim->height = height;
+
+	sim->contact_radius = SIMULATION_CONTACT_RADIUS;
+	sim->contact_K = SIMULATION_CONTACT_K;
+	sim->contact_Kd = SIMULATION_CONTACT_KD;
+	sim->grid = Grid_init(2*SIMULATION_CONTACT_RADIUS);
+
+	sim->solver = SIMULATION_SOLVER;
+	sim->iterations = SIMULATION_ITERATIONS;
+	sim->tolerance = SIMULATION_TOLERANCE;
+	sim->implicit = Implicit_init();
+	sim->constraint_iterations = SIMULATION_CONSTRAINT_ITERATIONS;
+	sim->xpbd = Xpbd_init();
+
+	sim->deterministic = 0;
+
+	sim->sleeping = 1;
+	sim->sleep_energy = SIMULATION_SLEEP_ENERGY;
+	sim->sleep_steps = SIMULATION_SLEEP_STEPS;
+	sim->islands = Islands_init();
+	sim->asleep_nodes = 0;
+
+	sim->grab = Grab_init();
+	sim->grab_K = SIMULATION_GRAB_K;
+	sim->grab_Kd = SIMULATION_GRAB_KD;
+
+	sim->adaptive = 0;
+	sim->safety = SIMULATION_SAFETY;
+	sim->max_travel = SIMULATION_MAX_TRAVEL;
+	sim->max_substeps = SIMULATION_MAX_SUBSTEPS;
+	sim->substeps = 0;
+	sim->repaired = 0;
+	sim->scratch = NULL;
+	sim->scratch_capacity = 0;
+
+	sim->torn = 0;
+	sim->torn_since_build = 0;
+
+	sim->remap = NULL;
+	sim->remap_capacity = 0;
+	return 0;
+}
+
+char Simulation_set_threads(Simulation* sim, int nb_threads){
+	if (sim->pool != NULL){
+		ThreadPool_free(sim->pool);
+		free(sim->pool);
+		sim->pool = NULL;
+	}
+	if (nb_threads == 1){
+		return 0;
+	}
+
+	sim->pool = malloc(sizeof(ThreadPool));
+	if (sim->pool == NULL || ThreadPool_create(sim->pool, nb_threads)){
+		free(sim->pool);
+		sim->pool = NULL;
+		return 1;
+	}
+	return 0;
+}
+
+char Simulation_remove_nodes(Simulation* sim, const int* indices, int n){
+	Nodes* nodes = &sim->nodes;
+	Springs* springs = &sim->springs;
+	// the remap array always holds the identity between two removals, only the entries changed below are reset.
+	if (nodes->count > sim->remap_capacity){
+		int* remap = realloc(sim->remap, nodes->capacity*sizeof(int));
+		if (remap == NULL){
+			return 1;
+		}
+		for (int i = sim->remap_capacity; i < nodes->capacity; i++){
+			remap[i] = i;
+		}
+		sim->remap = remap;
+		sim->remap_capacity = nodes->capacity;
+	}
+	int* remap = sim->remap;
+
+	for (int k = 0; k < n; k++){
+		remap[indices[k]] = -1;
+	}
+	// the holes below the new count are filled with the last nodes that remain, from the end.
+	int count = nodes->count - n;
+	int last = nodes->count - 1;
+	for (int k = 0; k < n; k++){
+		int hole = indices[k];
+		if (hole >= count){
+			continue;
+		}
+		while (remap[last] == -1){
+			last--;
+		}
+		Nodes_move(nodes, last, hole);
+		remap[last] = hole;
+		last--;
+	}
+	for (int i = count; i < nodes->count; i++){
+		Nodes_set_flag(nodes->locked, i, 0);
+	}
+	int old_count = nodes->count;
+	nodes->count = count;
+
+	// a single pass renumbers the springs, those losing an end being dropped.
+	int kept = 0;
+	for (int s = 0; s < springs->count; s++){
+		int a = remap[springs->a[s]];
+		int b = remap[springs->b[s]];
+		if (a >= 0 && b >= 0){
+			Springs_move(springs, s, kept);
+			springs->a[kept] = a;
+			springs->b[kept] = b;
+			kept++;
+		}
+	}
+	springs->count = kept;
+	springs->topology++;
+	springs->adjacency_valid = 0;
+	springs->colors_valid = 0;
+	sim->islands.valid = 0;
+	Grab_remap(&sim->grab, remap);
+
+	// only the removed nodes and the moved ones were changed in the remap array.
+	for (int k = 0; k < n; k++){
+		remap[indices[k]] = indices[k];
+	}
+	for (int i = count; i < old_count; i++){
+		remap[i] = i;
+	}
+	return 0;
+}
+
+/* Runs a task over every spring, color by color when the springs are split between threads, or when the simulation has
+ * to be deterministic: within a color no two springs share a node, so the order the forces reach a node in only
+ * depends on the colors. */
+static void for_each_spring(Simulation* sim, ThreadPool_task task, Step* step){
+	Springs* springs = &sim->springs;
+	if ((ThreadPool_size(sim->pool) > 1 && springs->count > SIMULATION_SPRING_GRAIN) || sim->deterministic){
+		// the springs added since the last coloring are processed by a single thread, they are colored again once
+		// they make up a noticeable part of the work.
+		if (Springs_uncolored(springs) > springs->count/8){
+			Springs_color(springs, sim->nodes.count);
+		}
+		if (springs->colors_valid){
+			for (int c = 0; c < springs->nb_colors; c++){
+				ThreadPool_parallel_for(sim->pool, springs->color_offsets[c], springs->color_offsets[c+1],
+						SIMULATION_SPRING_GRAIN, task, step);
+			}
+			task(step, springs->color_offsets[springs->nb_colors], springs->count, 0);
+			return;
+		}
+	}
+	task(step, 0, springs->count, 0);
+}
+
+void Simulation_compute_forces(Simulation* sim){
+	Step step = {sim, 0};
+	PROFILE_BEGIN("forces");
+	ThreadPool_parallel_for(sim->pool, 0, sim->nodes.count, SIMULATION_NODE_GRAIN, clear_task, &step);
+	if (sim->solver != SOLVER_XPBD){
+		for_each_spring(sim, springs_task, &step);
+	}
+	PROFILE_END();
+}
+
+void Simulation_compute_contacts(Simulation* sim){
+	Step step = {sim, 0};
+	if (sim->contact_radius <= 0){
+		return;
+	}
+	PROFILE_BEGIN("contacts");
+	// the cells are twice as large as the contact radius, so that the contacts of a node are in the 2 x 2 cells around
+	// it.
+	sim->grid.cell_size = 2*sim->contact_radius;
+	// the sleeping nodes are in the grid too, so that the awake ones collide with them.
+	if (Grid_build(&sim->grid, sim->nodes.x, sim->nodes.y, NULL, sim->nodes.count + sim->asleep_nodes) == 0){
+		ThreadPool_parallel_for(sim->pool, 0, sim->nodes.count, SIMULATION_NODE_GRAIN, contacts_task, &step);
+	}
+	PROFILE_END();
+}
+
+void Simulation_solve(Simulation* sim, float dt){
+	if (sim->solver == SOLVER_IMPLICIT){
+		PROFILE_BEGIN("solve");
+		Implicit_solve(&sim->implicit, &sim->nodes, &sim->springs, dt, sim->K, sim->Kd, sim->L0, sim->iterations,
+				sim->tolerance);
+		PROFILE_END();
+	} else if (sim->solver == SOLVER_XPBD){
+		Step step = {sim, dt};
+		PROFILE_BEGIN("solve");
+		ThreadPool_parallel_for(sim->pool, 0, sim->nodes.count, SIMULATION_NODE_GRAIN, predict_task, &step);
+		if (Xpbd_reset(&sim->xpbd, sim->springs.count) == 0){
+			for (int it = 0; it < sim->constraint_iterations; it++){
+				for_each_spring(sim, project_task, &step);
+			}
+		}
+		PROFILE_END();
+	}
+}
+
+void Simulation_integrate(Simulation* sim, float dt){
+	Step step = {sim, dt};
+	PROFILE_BEGIN("integrate");
+	if (sim->solver == SOLVER_XPBD){
+		ThreadPool_parallel_for(sim->pool, 0, sim->nodes.count, SIMULATION_NODE_GRAIN, finish_task, &step);
+		// the spring forces are not computed, the lengths are still needed by the rendering.
+		Springs_measure(&sim->springs, sim->nodes.x, sim->nodes.y);
+	} else {
+		ThreadPool_parallel_for(sim->pool, 0, sim->nodes.count, SIMULATION_NODE_GRAIN, integrate_task, &step);
+	}
+	PROFILE_END();
+}
+
+void Simulation_wake(Simulation* sim){
+	sim->islands.valid = 0;
+}
+
+char Simulation_grab(Simulation* sim, float x, float y, float radius, char brush){
+	Simulation_wake(sim);
+	return Grab_pick(&sim->grab, &sim->grid, &sim->nodes, x, y, radius, brush);
+}
+
+void Simulation_move_grab(Simulation* sim, float x, float y){
+	Grab_move(&sim->grab, x, y);
+}
+
+void Simulation_release(Simulation* sim){
+	Grab_release(&sim->grab);
+}
+
+/* Removes the springs strained past their threshold, given the number of springs hidden past the count, which follow
+ * the awake ones: the last of them fills the slot every removal frees at the end of the awake springs. Gives the number
+ * of springs removed. */
+static int tear(Simulation* sim, int hidden){
+	Springs* springs = &sim->springs;
+	int removed = 0;
+	// a removal only moves springs from higher indices into the hole, which have already been checked.
+	for (int s = springs->count-1; s >= 0; s--){
+		float rest = (springs->rest != NULL)?springs->rest[s]:sim->L0;
+		// an infinite threshold never breaks, even with a null rest length.
+		if (fabsf(springs->length[s] - rest) > springs->tear[s] * rest){
+			Springs_remove(springs, s);
+			if (hidden > 0){
+				Springs_move(springs, springs->count + hidden, springs->count);
+			}
+			removed++;
+		}
+	}
+	return removed;
+}
+
+void Simulation_step(Simulation* sim, float dt){
+	PROFILE_BEGIN("step");
+	Islands* islands = &sim->islands;
+	// the islands are left awake while nodes are held, so that the nodes are not reordered under the grab.
+	char sleeping = sim->sleeping && sim->grab.count == 0;
+	if (sleeping && (!islands->valid || islands->nb_nodes != sim->nodes.count
+			|| islands->nb_springs != sim->springs.count)){
+		sleeping = Islands_build(islands, &sim->nodes, &sim->springs) == 0;
+		sim->torn_since_build = 0;
+	}
+	int nb_nodes = sim->nodes.count;
+	int nb_springs = sim->springs.count;
+	if (sleeping){
+		sim->asleep_nodes = nb_nodes - islands->awake_nodes;
+		sim->nodes.count = islands->awake_nodes;
+		sim->springs.count = islands->awake_springs;
+	}
+
+	Simulation_compute_forces(sim);
+	Simulation_compute_contacts(sim);
+	Grab_apply(&sim->grab, &sim->nodes, sim->grab_K, sim->grab_Kd);
+	Simulation_solve(sim, dt);
+	Simulation_integrate(sim, dt);
+
+	if (sim->springs.tear != NULL){
+		PROFILE_BEGIN("tear");
+		int removed = tear(sim, nb_springs - sim->springs.count);
+		nb_springs -= removed;
+		sim->torn += removed;
+		if (sleeping){
+			islands->nb_springs -= removed;
+			islands->awake_springs -= removed;
+			sim->torn_since_build += removed;
+			if (sim->torn_since_build > nb_springs/SIMULATION_TEAR_REBUILD){
+				islands->valid = 0;
+			}
+		}
+		PROFILE_END();
+	}
+
+	if (sleeping){
+		sim->nodes.count = nb_nodes;
+		sim->springs.count = nb_springs;
+		sim->asleep_nodes = 0;
+		Islands_update(islands, &sim->nodes, &sim->springs, sim->sleep_energy, sim->sleep_steps,
+				sim->contact_radius);
+	}
+	PROFILE_END();
+}
+
+/* Makes sure the scratch arrays hold two floats per node. */
+static char reserve_scratch(Simulation* sim){
+	if (sim->nodes.count <= sim->scratch_capacity){
+		return 0;
+	}
+	float* scratch = realloc(sim->scratch, 2*(size_t)sim->nodes.capacity*sizeof(float));
+	if (scratch == NULL){
+		return 1;
+	}
+	sim->scratch = scratch;
+	sim->scratch_capacity = sim->nodes.capacity;
+	return 0;
+}
+
+/* Gives the largest step the stiffness and the damping allow, which only depends on the springs and the parameters. */
+static float stiffness_dt(Simulation* sim){
+	if (sim->solver != SOLVER_EXPLICIT){
+		return INFINITY;
+	}
+	Springs* springs = &sim->springs;
+	int n = sim->nodes.count;
+	float* stiffness = sim->scratch;
+	float* damping = sim->scratch + sim->scratch_capacity;
+	memset(stiffness, 0, n*sizeof(float));
+	memset(damping, 0, n*sizeof(float));
+	for (int s = 0; s < springs->count; s++){
+		float K = (springs->stiffness != NULL)?springs->stiffness[s]:sim->K;
+		float Kd = (springs->stiffness != NULL)?springs->damping[s]:sim->Kd;
+		stiffness[springs->a[s]] += K;
+		stiffness[springs->b[s]] += K;
+		damping[springs->a[s]] += Kd;
+		damping[springs->b[s]] += Kd;
+	}
+	float max_K = 0, max_Kd = 0;
+	for (int i = 0; i < n; i++){
+		max_K = (stiffness[i] > max_K)?stiffness[i]:max_K;
+		max_Kd = (damping[i] > max_Kd)?damping[i]:max_Kd;
+	}
+	// Gershgorin: the largest eigenvalue of the stiffness around a node is at most twice the sum of its springs.
+	float w2 = 2*max_K, c = 2*max_Kd;
+	if (sim->contact_radius > 0){
+		w2 += 2*SIMULATION_MAX_CONTACTS*sim->contact_K;
+		c += 2*SIMULATION_MAX_CONTACTS*sim->contact_Kd;
+	}
+	if (sim->grab.count > 0){
+		w2 += sim->grab_K;
+		c += sim->grab_Kd;
+	}
+	float limit = c + sqrtf(w2);
+	return (limit > 0)?sim->safety * 2 / limit:INFINITY;
+}
+
+/* Puts the nodes whose state is not finite back at rest where they were before the last step, and gives the speed of
+ * the fastest node. */
+static float repair(Simulation* sim){
+	Nodes* nodes = &sim->nodes;
+	float max_speed2 = 0;
+	for (int i = 0; i < nodes->count; i++){
+		float speed2 = nodes->vx[i]*nodes->vx[i] + nodes->vy[i]*nodes->vy[i];
+		// speed2 is not finite as soon as a velocity is not, and neither is x - x or y - y for a position.
+		if (!isfinite(speed2 + (nodes->x[i] - nodes->x[i]) + (nodes->y[i] - nodes->y[i]))){
+			char known = isfinite(nodes->px[i]) && isfinite(nodes->py[i]);
+			nodes->x[i] = known?nodes->px[i]:sim->width/2;
+			nodes->y[i] = known?nodes->py[i]:sim->height/2;
+			nodes->px[i] = nodes->x[i];
+			nodes->py[i] = nodes->y[i];
+			nodes->vx[i] = 0;
+			nodes->vy[i] = 0;
+			sim->repaired++;
+			speed2 = 0;
+		}
+		max_speed2 = (speed2 > max_speed2)?speed2:max_speed2;
+	}
+	return sqrtf(max_speed2);
+}
+
+/* Gives the stable step for the largest step the stiffness allows and the speed of the fastest node. */
+static float stable_dt(const Simulation* sim, float limit, float speed){
+	float reach = (sim->contact_radius > 0)?sim->contact_radius:sim->L0;
+	float travel = (speed > 0)?sim->max_travel * reach / speed:INFINITY;
+	return (travel < limit)?travel:limit;
+}
+
+float Simulation_stable_dt(Simulation* sim){
+	if (reserve_scratch(sim)){
+		return -1;
+	}
+	float max_speed2 = 0;
+	for (int i = 0; i < sim->nodes.count; i++){
+		float speed2 = sim->nodes.vx[i]*sim->nodes.vx[i] + sim->nodes.vy[i]*sim->nodes.vy[i];
+		max_speed2 = (speed2 > max_speed2)?speed2:max_speed2;
+	}
+	return stable_dt(sim, stiffness_dt(sim), sqrtf(max_speed2));
+}
+
+int Simulation_advance(Simulation* sim, float dt){
+	if (!sim->adaptive || reserve_scratch(sim)){
+		Simulation_step(sim, dt);
+		repair(sim);
+		sim->substeps = 1;
+		return 1;
+	}
+	PROFILE_BEGIN("advance");
+	Nodes* nodes = &sim->nodes;
+	int count = nodes->count;
+	float limit = stiffness_dt(sim);
+	float speed = repair(sim);
+	// the positions at the start are kept in the scratch arrays once the stiffness has been measured.
+	memcpy(sim->scratch, nodes->x, count*sizeof(float));
+	memcpy(sim->scratch + sim->scratch_capacity, nodes->y, count*sizeof(float));
+	int arranged = sim->islands.arranged;
+
+	float remaining = dt;
+	int substeps = 0;
+	for (;;){
+		// the rest of the time is split into equal steps, the last one taking exactly what is left.
+		float h = stable_dt(sim, limit, speed);
+		int left = sim->max_substeps - substeps;
+		float parts = (h >= remaining)?1:ceilf(remaining / h);
+		int n = (parts < left)?(int)parts:left;
+		h = (n > 1)?remaining / n:remaining;
+		Simulation_step(sim, h);
+		speed = repair(sim);
+		substeps++;
+		if (n <= 1){
+			break;
+		}
+		remaining -= h;
+	}
+
+	// the nodes may have been reordered by the islands, in which case the rendering only interpolates the last step.
+	if (substeps > 1 && sim->islands.arranged == arranged && nodes->count == count){
+		memcpy(nodes->px, sim->scratch, count*sizeof(float));
+		memcpy(nodes->py, sim->scratch + sim->scratch_capacity, count*sizeof(float));
+	}
+	sim->substeps = substeps;
+	PROFILE_END();
+	return substeps;
+}
+
+void Simulation_free(Simulation* sim){
+	Simulation_set_threads(sim, 1);
+	Xpbd_free(&sim->xpbd);
+	Implicit_free(&sim->implicit);
+	Islands_free(&sim->islands);
+	Grab_free(&sim->grab);
+	Grid_free(&sim->grid);
+	Springs_free(&sim->springs);
+	Nodes_free(&sim->nodes);
+	free(sim->scratch);
+	sim->scratch = NULL;
+	sim->scratch_capacity = 0;
+	free(sim->remap);
+	sim->remap = NULL;
+	sim->remap_capacity = 0;
+}
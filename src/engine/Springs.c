@@ -0,0 +1,372 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "Springs.h"
+
+Springs Springs_init(){
+	Springs springs = {NULL, NULL, NULL, 0, 0, 0, 0, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0, 0, NULL, 0, 0};
+	return springs;
+}
+
+Springs Springs_wrap(int* a, int* b, int count){
+	Springs springs = Springs_init();
+	springs.length = calloc(count+1, sizeof(float));
+	if (springs.length != NULL){
+		springs.a = a;
+		springs.b = b;
+		springs.count = count;
+		springs.capacity = count;
+		springs.borrowed = 1;
+	}
+	return springs;
+}
+
+/* Copies the borrowed arrays into arrays of our own, which can hold a given number of springs. */
+static char own(Springs* springs, int capacity){
+	if (!springs->borrowed){
+		return 0;
+	}
+	int* a = malloc((capacity+1)*sizeof(int));
+	int* b = malloc((capacity+1)*sizeof(int));
+	if (a == NULL || b == NULL){
+		free(a);
+		free(b);
+		return 1;
+	}
+	memcpy(a, springs->a, springs->capacity*sizeof(int));
+	memcpy(b, springs->b, springs->capacity*sizeof(int));
+	springs->a = a;
+	springs->b = b;
+	springs->borrowed = 0;
+	return 0;
+}
+
+char Springs_reserve(Springs* springs, int capacity){
+	if (capacity <= springs->capacity){
+		return 0;
+	}
+
+	// the borrowed arrays cannot be reallocated, they are copied into arrays of our own.
+	if (own(springs, capacity)){
+		return 1;
+	}
+	int* a = realloc(springs->a, capacity*sizeof(int));
+	if (a == NULL){
+		return 1;
+	}
+	springs->a = a;
+	int* b = realloc(springs->b, capacity*sizeof(int));
+	if (b == NULL){
+		return 1;
+	}
+	springs->b = b;
+	float* length = realloc(springs->length, capacity*sizeof(float));
+	if (length == NULL){
+		return 1;
+	}
+	springs->length = length;
+	if (springs->stiffness != NULL){
+		float** materials[] = {&springs->rest, &springs->stiffness, &springs->damping};
+		for (int m = 0; m < 3; m++){
+			float* material = realloc(*materials[m], capacity*sizeof(float));
+			if (material == NULL){
+				return 1;
+			}
+			*materials[m] = material;
+		}
+	}
+	if (springs->tear != NULL){
+		float* tear = realloc(springs->tear, capacity*sizeof(float));
+		if (tear == NULL){
+			return 1;
+		}
+		springs->tear = tear;
+	}
+
+	springs->capacity = capacity;
+	return 0;
+}
+
+char Springs_add(Springs* springs, int a, int b){
+	if (springs->count == springs->capacity){
+		// the arrays grow geometrically so that adding a spring stays O(1) amortized.
+		if (Springs_reserve(springs, (springs->capacity < 16)?16:2*springs->capacity)){
+			return 1;
+		}
+	}
+
+	springs->a[springs->count] = a;
+	springs->b[springs->count] = b;
+	springs->length[springs->count] = 0;
+	if (springs->stiffness != NULL){
+		Springs_set_material(springs, springs->count, 0, 0, 0);
+	}
+	if (springs->tear != NULL){
+		springs->tear[springs->count] = INFINITY;
+	}
+	springs->count++;
+	springs->topology++;
+	springs->adjacency_valid = 0;
+	return 0;
+}
+
+char Springs_use_materials(Springs* springs, const float* x, const float* y, float K, float Kd){
+	if (springs->stiffness == NULL){
+		int capacity = springs->capacity+1;
+		float* rest = malloc(capacity*sizeof(float));
+		float* stiffness = malloc(capacity*sizeof(float));
+		float* damping = malloc(capacity*sizeof(float));
+		if (rest == NULL || stiffness == NULL || damping == NULL){
+			free(rest);
+			free(stiffness);
+			free(damping);
+			return 1;
+		}
+		springs->rest = rest;
+		springs->stiffness = stiffness;
+		springs->damping = damping;
+	}
+	for (int s = 0; s < springs->count; s++){
+		float dx = x[springs->a[s]] - x[springs->b[s]];
+		float dy = y[springs->a[s]] - y[springs->b[s]];
+		Springs_set_material(springs, s, sqrtf(dx*dx + dy*dy), K, Kd);
+	}
+	return 0;
+}
+
+void Springs_set_material(Springs* springs, int s, float rest, float K, float Kd){
+	springs->rest[s] = rest;
+	springs->stiffness[s] = K;
+	springs->damping[s] = Kd;
+}
+
+char Springs_use_tearing(Springs* springs, float strain){
+	if (springs->tear == NULL){
+		springs->tear = malloc((springs->capacity+1)*sizeof(float));
+		if (springs->tear == NULL){
+			return 1;
+		}
+	}
+	for (int s = 0; s < springs->count; s++){
+		springs->tear[s] = strain;
+	}
+	return 0;
+}
+
+void Springs_move(Springs* springs, int from, int to){
+	springs->a[to] = springs->a[from];
+	springs->b[to] = springs->b[from];
+	springs->length[to] = springs->length[from];
+	if (springs->stiffness != NULL){
+		Springs_set_material(springs, to, springs->rest[from], springs->stiffness[from], springs->damping[from]);
+	}
+	if (springs->tear != NULL){
+		springs->tear[to] = springs->tear[from];
+	}
+}
+
+void Springs_remove(Springs* springs, int s){
+	int hole = s;
+	if (springs->colors_valid){
+		// the hole is filled with the last spring of its color, which moves the hole to the end of the color, i.e. to
+		// the start of the next one, and so on until the uncolored springs: one move per color at most.
+		int c = 0;
+		while (c < springs->nb_colors && springs->color_offsets[c+1] <= s){
+			c++;
+		}
+		for (; c < springs->nb_colors; c++){
+			int last = --springs->color_offsets[c+1];
+			Springs_move(springs, last, hole);
+			hole = last;
+		}
+	}
+	Springs_move(springs, springs->count-1, hole);
+	springs->count--;
+	springs->topology++;
+	springs->adjacency_valid = 0;
+}
+
+char Springs_permute(Springs* springs, const int* order){
+	int e = springs->count;
+	int* scratch = malloc((e > 0)?e*sizeof(int):1);
+	if (scratch == NULL){
+		return 1;
+	}
+	// every field is gathered into the scratch array and copied back, so that borrowed arrays are reordered in place.
+	int* ints[] = {springs->a, springs->b};
+	for (int f = 0; f < 2; f++){
+		for (int k = 0; k < e; k++){
+			scratch[k] = ints[f][order[k]];
+		}
+		memcpy(ints[f], scratch, e*sizeof(int));
+	}
+	float* floats[] = {springs->length, springs->tear, springs->rest, springs->stiffness, springs->damping};
+	float* gathered = (float*)scratch;
+	for (int f = 0; f < 5; f++){
+		if (floats[f] == NULL){
+			continue;
+		}
+		for (int k = 0; k < e; k++){
+			gathered[k] = floats[f][order[k]];
+		}
+		memcpy(floats[f], gathered, e*sizeof(float));
+	}
+	springs->topology++;
+	springs->adjacency_valid = 0;
+	springs->colors_valid = 0;
+	free(scratch);
+	return 0;
+}
+
+void Springs_measure(Springs* springs, const float* x, const float* y){
+	for (int s = 0; s < springs->count; s++){
+		float dx = x[springs->a[s]] - x[springs->b[s]];
+		float dy = y[springs->a[s]] - y[springs->b[s]];
+		springs->length[s] = sqrtf(dx*dx + dy*dy);
+	}
+}
+
+void Springs_clear(Springs* springs){
+	springs->count = 0;
+	springs->topology++;
+	springs->adjacency_valid = 0;
+	springs->colors_valid = 0;
+}
+
+char Springs_build_adjacency(Springs* springs, int nb_nodes){
+	int* offsets = realloc(springs->offsets, (nb_nodes+1)*sizeof(int));
+	if (offsets == NULL){
+		return 1;
+	}
+	springs->offsets = offsets;
+	int* neighbours = realloc(springs->neighbours, (2*springs->count+1)*sizeof(int));
+	if (neighbours == NULL){
+		return 1;
+	}
+	springs->neighbours = neighbours;
+	int* edges = realloc(springs->edges, (2*springs->count+1)*sizeof(int));
+	if (edges == NULL){
+		return 1;
+	}
+	springs->edges = edges;
+
+	// counting sort over the endpoints: first the degree of every node...
+	for (int i = 0; i <= nb_nodes; i++){
+		offsets[i] = 0;
+	}
+	for (int s = 0; s < springs->count; s++){
+		offsets[springs->a[s]+1]++;
+		offsets[springs->b[s]+1]++;
+	}
+	// ... then the start of every row...
+	for (int i = 0; i < nb_nodes; i++){
+		offsets[i+1] += offsets[i];
+	}
+	// ... and finally the rows themselves, using offsets[i] as a cursor that ends up on the start of row i+1.
+	for (int s = 0; s < springs->count; s++){
+		int a = springs->a[s];
+		int b = springs->b[s];
+		neighbours[offsets[a]] = b;
+		edges[offsets[a]++] = s;
+		neighbours[offsets[b]] = a;
+		edges[offsets[b]++] = s;
+	}
+	for (int i = nb_nodes; i > 0; i--){
+		offsets[i] = offsets[i-1];
+	}
+	offsets[0] = 0;
+
+	springs->adjacency_nodes = nb_nodes;
+	springs->adjacency_valid = 1;
+	return 0;
+}
+
+/* The color given to the springs which could not be colored. */
+#define NO_COLOR 64
+
+char Springs_color(Springs* springs, int nb_nodes){
+	int count = springs->count;
+	uint64_t* used = calloc(nb_nodes+1, sizeof(uint64_t));
+	unsigned char* colors = malloc(count+1);
+	int* order = malloc((count+1)*sizeof(int));
+	int* offsets = realloc(springs->color_offsets, (NO_COLOR+2)*sizeof(int));
+	if (offsets != NULL){
+		springs->color_offsets = offsets;
+	}
+	// the springs are reordered in arrays of our own, even if they were borrowed.
+	if (used == NULL || colors == NULL || order == NULL || offsets == NULL || own(springs, springs->capacity)){
+		free(used);
+		free(colors);
+		free(order);
+		return 1;
+	}
+
+	// greedy coloring: the lowest color used by neither end, the bits of used[i] being the colors around node i.
+	int nb_colors = 0;
+	for (int s = 0; s < count; s++){
+		uint64_t taken = used[springs->a[s]] | used[springs->b[s]];
+		int color = (taken == UINT64_MAX)?NO_COLOR:__builtin_ctzll(~taken);
+		colors[s] = color;
+		if (color != NO_COLOR){
+			used[springs->a[s]] |= (uint64_t)1 << color;
+			used[springs->b[s]] |= (uint64_t)1 << color;
+			if (color >= nb_colors){
+				nb_colors = color+1;
+			}
+		}
+	}
+
+	// counting sort of the springs by color, the uncolored ones ending up last. The entries past the count are kept,
+	// for the lists colored over a prefix, see Simulation_step.
+	memset(offsets, 0, (NO_COLOR+2)*sizeof(int));
+	for (int s = 0; s < count; s++){
+		offsets[colors[s]+1]++;
+	}
+	for (int c = 0; c <= NO_COLOR; c++){
+		offsets[c+1] += offsets[c];
+	}
+	for (int s = 0; s < count; s++){
+		order[offsets[colors[s]]++] = s;
+	}
+	char failed = Springs_permute(springs, order);
+	free(used);
+	free(colors);
+	free(order);
+	if (failed){
+		return 1;
+	}
+	// offsets[c] now is the end of color c, i.e. the start of color c+1.
+	memmove(offsets+1, offsets, (NO_COLOR+1)*sizeof(int));
+	offsets[0] = 0;
+	offsets[nb_colors] = offsets[NO_COLOR];
+
+	springs->nb_colors = nb_colors;
+	springs->colors_valid = 1;
+	return 0;
+}
+
+int Springs_uncolored(const Springs* springs){
+	if (!springs->colors_valid){
+		return springs->count;
+	}
+	return springs->count - springs->color_offsets[springs->nb_colors];
+}
+
+void Springs_free(Springs* springs){
+	if (!springs->borrowed){
+		free(springs->a);
+		free(springs->b);
+	}
+	free(springs->length);
+	free(springs->rest);
+	free(springs->stiffness);
+	free(springs->damping);
+	free(springs->tear);
+	free(springs->offsets);
+	free(springs->neighbours);
+	free(springs->edges);
+	free(springs->color_offsets);
+	*springs = Springs_init();
+}
@@ -0,0 +1,100 @@
+#include <string.h>
+
+#include "Stats.h"
+
+/* The names of the metrics, in the order of the StatsMetric enumeration. */
+static const char* METRICS[STATS_METRICS] = {"frame", "physics", "render", "sleep"};
+
+/* The percentiles written for every metric, the maximum being written after them. */
+static const double PERCENTILES[] = {50, 95, 99};
+static const char* PERCENTILE_NAMES[] = {"p50", "p95", "p99"};
+#define NB_PERCENTILES ((int)(sizeof(PERCENTILES)/sizeof(PERCENTILES[0])))
+
+static void clear(Stats* stats){
+	for (int m = 0; m < STATS_METRICS; m++){
+		Histogram_clear(&stats->histograms[m]);
+	}
+	stats->elapsed = 0;
+	stats->frames = 0;
+}
+
+char Stats_open(Stats* stats, const char* path, StatsFormat format, double period){
+	stats->owned = path != NULL && strcmp(path, "-") != 0;
+	stats->output = stats->owned?fopen(path, "a"):stdout;
+	if (stats->output == NULL){
+		fprintf(stderr, "Could not open %s.\n", path);
+		return 1;
+	}
+	stats->format = format;
+	stats->period = period;
+	stats->total = 0;
+	clear(stats);
+
+	// a file appended to already has its header, only an empty one is given one.
+	char empty = !stats->owned || (fseek(stats->output, 0, SEEK_END) == 0 && ftell(stats->output) == 0);
+	if (format == STATS_CSV && empty){
+		fprintf(stats->output, "time,frames,fps");
+		for (int m = 0; m < STATS_METRICS; m++){
+			for (int p = 0; p < NB_PERCENTILES; p++){
+				fprintf(stats->output, ",%s_%s_ms", METRICS[m], PERCENTILE_NAMES[p]);
+			}
+			fprintf(stats->output, ",%s_max_ms", METRICS[m]);
+		}
+		fprintf(stats->output, "\n");
+	}
+	return 0;
+}
+
+void Stats_record(Stats* stats, StatsMetric metric, double seconds){
+	Histogram_record(&stats->histograms[metric], (seconds > 0)?seconds*1e6 + 0.5:0);
+}
+
+/* Writes the line of the current period. */
+static void write_line(Stats* stats){
+	FILE* output = stats->output;
+	double fps = stats->frames / stats->elapsed;
+	if (stats->format == STATS_CSV){
+		fprintf(output, "%.3f,%d,%.2f", stats->total, stats->frames, fps);
+	} else {
+		fprintf(output, "{\"time\":%.3f,\"frames\":%d,\"fps\":%.2f", stats->total, stats->frames, fps);
+	}
+	for (int m = 0; m < STATS_METRICS; m++){
+		const Histogram* histogram = &stats->histograms[m];
+		if (stats->format == STATS_JSON){
+			fprintf(output, ",\"%s\":{", METRICS[m]);
+		}
+		for (int p = 0; p <= NB_PERCENTILES; p++){
+			// the durations are written in milliseconds, the maximum is exact.
+			double ms = ((p < NB_PERCENTILES)?Histogram_percentile(histogram, PERCENTILES[p]):histogram->max) * 1e-3;
+			if (stats->format == STATS_CSV){
+				fprintf(output, ",%.3f", ms);
+			} else {
+				fprintf(output, "%s\"%s_ms\":%.3f", (p == 0)?"":",", (p < NB_PERCENTILES)?PERCENTILE_NAMES[p]:"max", ms);
+			}
+		}
+		if (stats->format == STATS_JSON){
+			fprintf(output, "}");
+		}
+	}
+	fputs((stats->format == STATS_JSON)?"}\n":"\n", output);
+	fflush(output);
+}
+
+void Stats_end_frame(Stats* stats, double seconds){
+	Stats_record(stats, STATS_FRAME, seconds);
+	stats->frames++;
+	stats->elapsed += seconds;
+	stats->total += seconds;
+	if (stats->elapsed >= stats->period){
+		write_line(stats);
+		clear(stats);
+	}
+}
+
+void Stats_close(Stats* stats){
+	if (stats->owned && stats->output != NULL){
+		fclose(stats->output);
+	}
+	stats->output = NULL;
+	stats->owned = 0;
+}
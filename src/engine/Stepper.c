@@ -0,0 +1,31 @@
+#include "Stepper.h"
+
+Stepper Stepper_init(double dt, int max_steps){
+	Stepper stepper = {dt, max_steps, 0, 1, 0};
+	return stepper;
+}
+
+int Stepper_advance(Stepper* stepper, double elapsed){
+	stepper->accumulator += elapsed;
+
+	int steps = stepper->accumulator / stepper->dt;
+	if (steps > stepper->max_steps){
+		// the physics is late: rather than trying to catch up, which would make the next frame even longer, the
+		// simulation slows down for a while.
+		stepper->dropped += (steps - stepper->max_steps) * stepper->dt;
+		stepper->accumulator -= (steps - stepper->max_steps) * stepper->dt;
+		steps = stepper->max_steps;
+	}
+	stepper->accumulator -= steps * stepper->dt;
+
+	stepper->alpha = stepper->accumulator / stepper->dt;
+	if (stepper->alpha > 1){
+		stepper->alpha = 1;
+	}
+	return steps;
+}
+
+void Stepper_reset(Stepper* stepper){
+	stepper->accumulator = 0;
+	stepper->alpha = 1;
+}
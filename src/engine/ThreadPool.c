@@ -0,0 +1,155 @@
+#include <stdlib.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+/* The number of times an idle worker checks for a new job before going to sleep. */
+#define SPIN_COUNT 4096
+
+static inline void relax(){
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+static void run_chunks(ThreadPool* pool, int thread){
+	int grain = pool->grain;
+	int end = pool->end;
+	int begin;
+	while ((begin = atomic_fetch_add(&pool->next, grain)) < end){
+		pool->task(pool->context, begin, (begin + grain < end)?begin + grain:end, thread);
+	}
+}
+
+typedef struct Worker{
+	ThreadPool* pool;
+	int thread;
+} Worker;
+
+static void* worker_main(void* arg){
+	Worker worker = *(Worker*)arg;
+	free(arg);
+	ThreadPool* pool = worker.pool;
+
+	unsigned seen = 0;
+	for (;;){
+		int spins = 0;
+		while (atomic_load(&pool->generation) == seen){
+			if (++spins < SPIN_COUNT){
+				relax();
+				continue;
+			}
+			pthread_mutex_lock(&pool->lock);
+			while (atomic_load(&pool->generation) == seen){
+				pthread_cond_wait(&pool->wake, &pool->lock);
+			}
+			pthread_mutex_unlock(&pool->lock);
+		}
+		seen = atomic_load(&pool->generation);
+		if (atomic_load(&pool->stop)){
+			break;
+		}
+
+		PROFILE_BEGIN("job");
+		run_chunks(pool, worker.thread);
+		PROFILE_END();
+		atomic_fetch_sub(&pool->remaining, 1);
+	}
+	return NULL;
+}
+
+char ThreadPool_create(ThreadPool* pool, int nb_threads){
+	if (nb_threads <= 0){
+		nb_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if (nb_threads <= 0){
+		nb_threads = 1;
+	}
+
+	pool->nb_workers = 0;
+	pool->threads = malloc((nb_threads-1 > 0)?(nb_threads-1)*sizeof(pthread_t):1);
+	if (pool->threads == NULL){
+		return 1;
+	}
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->wake, NULL);
+	atomic_init(&pool->generation, 0);
+	atomic_init(&pool->next, 0);
+	atomic_init(&pool->remaining, 0);
+	atomic_init(&pool->stop, 0);
+
+	for (int t = 1; t < nb_threads; t++){
+		Worker* worker = malloc(sizeof(Worker));
+		if (worker == NULL){
+			ThreadPool_free(pool);
+			return 1;
+		}
+		worker->pool = pool;
+		worker->thread = t;
+		if (pthread_create(&pool->threads[pool->nb_workers], NULL, worker_main, worker)){
+			free(worker);
+			ThreadPool_free(pool);
+			return 1;
+		}
+		pool->nb_workers++;
+	}
+	return 0;
+}
+
+void ThreadPool_parallel_for(ThreadPool* pool, int begin, int end, int grain, ThreadPool_task task, void* context){
+	if (grain < 1){
+		grain = 1;
+	}
+	if (pool == NULL || pool->nb_workers == 0 || end - begin <= grain){
+		if (begin < end){
+			task(context, begin, end, 0);
+		}
+		return;
+	}
+
+	// the job is fully described before the generation changes, so that the workers see it whole.
+	pool->task = task;
+	pool->context = context;
+	pool->end = end;
+	pool->grain = grain;
+	atomic_store(&pool->next, begin);
+	atomic_store(&pool->remaining, pool->nb_workers);
+
+	pthread_mutex_lock(&pool->lock);
+	atomic_fetch_add(&pool->generation, 1);
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+
+	run_chunks(pool, 0);
+	int spins = 0;
+	while (atomic_load(&pool->remaining) > 0){
+		if (++spins < SPIN_COUNT){
+			relax();
+		} else {
+			sched_yield();
+		}
+	}
+}
+
+int ThreadPool_size(const ThreadPool* pool){
+	return (pool == NULL)?1:pool->nb_workers+1;
+}
+
+void ThreadPool_free(ThreadPool* pool){
+	atomic_store(&pool->stop, 1);
+	pthread_mutex_lock(&pool->lock);
+	atomic_fetch_add(&pool->generation, 1);
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+	for (int t = 0; t < pool->nb_workers; t++){
+		pthread_join(pool->threads[t], NULL);
+	}
+
+	pthread_cond_destroy(&pool->wake);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->threads);
+	pool->threads = NULL;
+	pool->nb_workers = 0;
+}
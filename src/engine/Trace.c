@@ -0,0 +1,164 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Trace.h"
+
+/* The names of the fields of a record, in the order they are written. */
+static const char* FIELDS[] = {"x", "y", "vx", "vy"};
+
+/* Gives the fields of the nodes, in the order they are written. */
+static void fields(const Nodes* nodes, const float* values[4]){
+	values[0] = nodes->x;
+	values[1] = nodes->y;
+	values[2] = nodes->vx;
+	values[3] = nodes->vy;
+}
+
+uint64_t Trace_hash(const Nodes* nodes){
+	const float* values[4];
+	fields(nodes, values);
+	// FNV-1a over 32 bit words rather than bytes, which is four times faster and mixes as well for this purpose.
+	uint64_t hash = 14695981039346656037ull;
+	for (int f = 0; f < 4; f++){
+		for (int i = 0; i < nodes->count; i++){
+			uint32_t word;
+			memcpy(&word, &values[f][i], sizeof(uint32_t));
+			hash ^= word;
+			hash *= 1099511628211ull;
+		}
+	}
+	return hash;
+}
+
+/* The distance between two floats in units in the last place, i.e. the number of floats between them. Two NaNs are
+ * equal, and a NaN is as far as can be from anything else. */
+static uint32_t ulps(float a, float b){
+	if (a == b || (isnan(a) && isnan(b))){
+		return 0;
+	}
+	if (isnan(a) || isnan(b)){
+		return UINT32_MAX;
+	}
+	// the bits of the floats, sign and magnitude, are turned into integers ordered as the floats are.
+	int32_t ia, ib;
+	memcpy(&ia, &a, sizeof(float));
+	memcpy(&ib, &b, sizeof(float));
+	ia = (ia < 0)?INT32_MIN - ia:ia;
+	ib = (ib < 0)?INT32_MIN - ib:ib;
+	int64_t distance = (int64_t)ia - ib;
+	distance = (distance < 0)?-distance:distance;
+	return (distance > UINT32_MAX)?UINT32_MAX:distance;
+}
+
+char Trace_create(Trace* trace, const char* path, const Simulation* sim, float dt, uint32_t seed){
+	memset(trace, 0, sizeof(Trace));
+	trace->file = fopen(path, "wb");
+	if (trace->file == NULL){
+		fprintf(stderr, "Could not create the trace %s.\n", path);
+		return 1;
+	}
+	TraceHeader* header = &trace->header;
+	memcpy(header->magic, TRACE_MAGIC, sizeof(header->magic));
+	header->version = TRACE_VERSION;
+	header->header_size = sizeof(TraceHeader);
+	header->nb_nodes = sim->nodes.count;
+	header->nb_springs = sim->springs.count;
+	header->dt = dt;
+	header->solver = sim->solver;
+	header->seed = seed;
+	trace->recording = 1;
+	if (fwrite(header, sizeof(TraceHeader), 1, trace->file) != 1){
+		fprintf(stderr, "Could not write the trace %s.\n", path);
+		Trace_close(trace);
+		return 1;
+	}
+	return 0;
+}
+
+char Trace_open(Trace* trace, const char* path){
+	memset(trace, 0, sizeof(Trace));
+	trace->file = fopen(path, "rb");
+	if (trace->file == NULL){
+		fprintf(stderr, "Could not open the trace %s.\n", path);
+		return 1;
+	}
+	TraceHeader* header = &trace->header;
+	if (fread(header, sizeof(TraceHeader), 1, trace->file) != 1
+			|| memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0 || header->version != TRACE_VERSION
+			|| header->header_size != sizeof(TraceHeader) || header->nb_nodes > INT32_MAX/4){
+		fprintf(stderr, "The trace %s is not a version %d trace.\n", path, TRACE_VERSION);
+		Trace_close(trace);
+		return 1;
+	}
+	trace->expected = malloc((4*(size_t)header->nb_nodes + 1)*sizeof(float));
+	if (trace->expected == NULL){
+		Trace_close(trace);
+		return 1;
+	}
+	return 0;
+}
+
+char Trace_record(Trace* trace, const Nodes* nodes){
+	const float* values[4];
+	fields(nodes, values);
+	uint64_t hash = Trace_hash(nodes);
+	char failed = fwrite(&hash, sizeof(uint64_t), 1, trace->file) != 1;
+	for (int f = 0; f < 4 && !failed; f++){
+		failed = fwrite(values[f], sizeof(float), nodes->count, trace->file) != (size_t)nodes->count;
+	}
+	trace->step++;
+	return failed;
+}
+
+int Trace_check(Trace* trace, const Nodes* nodes, uint32_t tolerance, TraceDivergence* divergence){
+	int count = trace->header.nb_nodes;
+	if (nodes->count != count){
+		return -2;
+	}
+	// the trace only ends cleanly where a record would start, anything shorter than a record is a truncated one.
+	int next = fgetc(trace->file);
+	if (next == EOF){
+		return ferror(trace->file)?-2:-1;
+	}
+	ungetc(next, trace->file);
+	uint64_t hash;
+	if (fread(&hash, sizeof(uint64_t), 1, trace->file) != 1
+			|| fread(trace->expected, sizeof(float), 4*(size_t)count, trace->file) != 4*(size_t)count){
+		return -2;
+	}
+	int step = trace->step++;
+	// identical checksums mean identical states, only the states that differ are compared node by node.
+	if (Trace_hash(nodes) == hash){
+		return 0;
+	}
+	const float* values[4];
+	fields(nodes, values);
+	for (int i = 0; i < count; i++){
+		for (int f = 0; f < 4; f++){
+			float expected = trace->expected[f*count + i];
+			uint32_t distance = ulps(expected, values[f][i]);
+			if (distance > trace->max_ulps){
+				trace->max_ulps = distance;
+			}
+			if (distance > tolerance){
+				TraceDivergence found = {step, i, FIELDS[f], expected, values[f][i], distance};
+				*divergence = found;
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+char Trace_close(Trace* trace){
+	char failed = 0;
+	if (trace->file != NULL){
+		failed = ferror(trace->file) != 0;
+		failed |= fclose(trace->file) != 0;
+	}
+	free(trace->expected);
+	trace->file = NULL;
+	trace->expected = NULL;
+	return trace->recording && failed;
+}
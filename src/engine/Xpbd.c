@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Xpbd.h"
+
+Xpbd Xpbd_init(){
+	Xpbd xpbd = {NULL, 0};
+	return xpbd;
+}
+
+void Xpbd_predict(Nodes* nodes, int begin, int end, float dt, float drag){
+	memcpy(nodes->px + begin, nodes->x + begin, (end-begin)*sizeof(float));
+	memcpy(nodes->py + begin, nodes->y + begin, (end-begin)*sizeof(float));
+	for (int i = begin; i < end; i++){
+		if (!Nodes_get_flag(nodes->locked, i)){
+			nodes->vx[i] += dt * nodes->ax[i];
+			nodes->vy[i] += dt * nodes->ay[i];
+			nodes->vx[i] *= drag;
+			nodes->vy[i] *= drag;
+			nodes->x[i] += dt * nodes->vx[i];
+			nodes->y[i] += dt * nodes->vy[i];
+		}
+	}
+}
+
+char Xpbd_reset(Xpbd* xpbd, int count){
+	if (count > xpbd->capacity){
+		float* lambda = realloc(xpbd->lambda, count*sizeof(float));
+		if (lambda == NULL){
+			return 1;
+		}
+		xpbd->lambda = lambda;
+		xpbd->capacity = count;
+	}
+	memset(xpbd->lambda, 0, count*sizeof(float));
+	return 0;
+}
+
+/* Projects the nodes onto the constraint of a spring, given its compliance alpha, its damping gamma and its rest
+ * length. */
+static inline void project(Xpbd* xpbd, Nodes* nodes, const Springs* springs, int s, float alpha, float gamma, float L0){
+	int i = springs->a[s];
+	int j = springs->b[s];
+	// the locked nodes have an infinite mass, i.e. a null inverse mass.
+	float wi = !Nodes_get_flag(nodes->locked, i);
+	float wj = !Nodes_get_flag(nodes->locked, j);
+	float dx = nodes->x[i] - nodes->x[j];
+	float dy = nodes->y[i] - nodes->y[j];
+	float d = sqrtf(dx*dx + dy*dy);
+	if (wi + wj == 0){
+		return;
+	}
+	// coincident nodes are pushed apart along x, as by the force kernels.
+	float nx = (d > 0)?dx / d:1;
+	float ny = (d > 0)?dy / d:0;
+	float C = d - L0;
+	// the change of the constraint since the start of the step, for the damping.
+	float dC = nx * (dx - (nodes->px[i] - nodes->px[j])) + ny * (dy - (nodes->py[i] - nodes->py[j]));
+	float dlambda = (-C - alpha*xpbd->lambda[s] - gamma*dC) / ((1 + gamma)*(wi + wj) + alpha);
+	xpbd->lambda[s] += dlambda;
+	nodes->x[i] += wi * dlambda * nx;
+	nodes->y[i] += wi * dlambda * ny;
+	nodes->x[j] -= wj * dlambda * nx;
+	nodes->y[j] -= wj * dlambda * ny;
+}
+
+void Xpbd_project(Xpbd* xpbd, Nodes* nodes, const Springs* springs, int begin, int end, float dt, float K,
+		float Kd, float L0){
+	// the compliance scaled by the time step, and the damping relative to the stiffness, as in the XPBD paper.
+	if (springs->stiffness != NULL){
+		for (int s = begin; s < end; s++){
+			// a spring without stiffness has an infinite compliance, it never moves the nodes.
+			float k = springs->stiffness[s];
+			if (k <= 0){
+				continue;
+			}
+			project(xpbd, nodes, springs, s, 1 / (k * dt*dt), springs->damping[s] / (k * dt), springs->rest[s]);
+		}
+		return;
+	}
+	float alpha = 1 / (K * dt*dt);
+	float gamma = Kd / (K * dt);
+	for (int s = begin; s < end; s++){
+		project(xpbd, nodes, springs, s, alpha, gamma, L0);
+	}
+}
+
+void Xpbd_finish(Nodes* nodes, int begin, int end, float dt, float w, float h){
+	for (int i = begin; i < end; i++){
+		if (!Nodes_get_flag(nodes->locked, i)){
+			char  left = nodes->x[i] < 0;
+			char right = nodes->x[i] > w;
+			char    up = nodes->y[i] < 0;
+			char  down = nodes->y[i] > h;
+			if  (left){ nodes->x[i] = 0; }
+			if (right){ nodes->x[i] = w; }
+			if    (up){ nodes->y[i] = 0; }
+			if  (down){ nodes->y[i] = h; }
+			nodes->vx[i] = (nodes->x[i] - nodes->px[i]) / dt;
+			nodes->vy[i] = (nodes->y[i] - nodes->py[i]) / dt;
+			// the nodes bounce on the walls as with the explicit integration.
+			if (left || right || up || down){
+				nodes->vx[i] *= -1;
+				nodes->vy[i] *= -1;
+			}
+		}
+	}
+}
+
+void Xpbd_free(Xpbd* xpbd){
+	free(xpbd->lambda);
+	*xpbd = Xpbd_init();
+}
@@ -2,23 +2,42 @@
 #include <stdio.h>
 #include <time.h>
 #include <math.h>
+#include <string.h>
 
 #include "base.h"
 #include "Timer.h"
+#include "Simulation.h"
+#include "Stepper.h"
+#include "Batch.h"
+#include "Scene.h"
+#include "Profiler.h"
+#include "Stats.h"
+#include "Pipeline.h"
+#include "View.h"
+#include "Grid.h"
+#include "Exporter.h"
 
 #include "config.h"
 
-void DrawCircle(SDL_Renderer * renderer, int32_t centreX, int32_t centreY, int32_t radius);
-
-typedef struct Node{
-	float x, y, vx, vy, ax, ay;
-	char locked, active;
-} Node;
-
+// the number of nodes allocated up front, the store grows past it as nodes are added.
 #define NB_NODES 10
 
+/* Writes a frame as a PNG file with SDL_image, for the exporter. */
+static char write_png(const char* path, const uint32_t* pixels, int width, int height){
+	SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom((void*)pixels, width, height, 32, width*sizeof(uint32_t),
+			SDL_PIXELFORMAT_ARGB8888);
+	if (surface == NULL){
+		return 1;
+	}
+	char failed = IMG_SavePNG(surface, path) != 0;
+	SDL_FreeSurface(surface);
+	return failed;
+}
+
 int main(int argc, char** argv){
-	srandom(time(NULL));
+	// the seed is fixed by SOFT_BODY_SEED, so that a run can be replayed.
+	const char* seed = getenv("SOFT_BODY_SEED");
+	srandom((seed != NULL)?strtoul(seed, NULL, 0):(unsigned long)time(NULL));
 
 /*## SDL INITIALIZATION ##########################################################################*/
 	SDL_Window* window;
@@ -37,293 +56,367 @@ int main(int argc, char** argv){
 		return 1;
 	}
 
-float DT = 1./MAX_FPS;
+	// the scene given on the command line is mapped and used in place, the default one is built by hand below.
+	Simulation sim;
+	Scene scene = {NULL, 0, NULL};
+	if (argc > 1){
+		if (Scene_open(&scene, argv[1]) || Scene_load(&scene, &sim)){
+			fprintf(stderr, "Could not load the scene %s.\n", argv[1]);
+			Scene_close(&scene);
+			close_renderer(&renderer);
+			close_window(&window);
+			quit(LIBS);
+			return 1;
+		}
+	} else if (Simulation_create(&sim, NB_NODES, WINDOW_W, WINDOW_H)){
+		fprintf(stderr, "Could not allocate %d nodes.\n", NB_NODES);
+		close_renderer(&renderer);
+		close_window(&window);
+		quit(LIBS);
+		return 1;
+	}
+	Nodes* nodes = &sim.nodes;
+	Springs* springs = &sim.springs;
+	// the positions the nodes are drawn at, interpolated between the two states of the last snapshot.
+	int render_capacity = nodes->capacity;
+	float* render_x = malloc(render_capacity*sizeof(float));
+	float* render_y = malloc(render_capacity*sizeof(float));
+	if (render_x == NULL || render_y == NULL){
+		fprintf(stderr, "Could not allocate the rendered positions.\n");
+		free(render_x);
+		free(render_y);
+		Simulation_free(&sim);
+		Scene_close(&scene);
+		close_renderer(&renderer);
+		close_window(&window);
+		quit(LIBS);
+		return 1;
+	}
 
-	Node nodes[NB_NODES];
-	for (int i = 0; i < NB_NODES; i++){
-		nodes[i].active = 0;
+	if (scene.data == NULL){
+		Nodes_add(nodes, WINDOW_W/2-100, WINDOW_H/4-100, 0);
+		Nodes_add(nodes, WINDOW_W/2+100, WINDOW_H/4-100, 0);
+		Nodes_add(nodes, WINDOW_W/2-100, WINDOW_H/4+100, 0);
+		Nodes_add(nodes, WINDOW_W/2+100, WINDOW_H/4+100, 0);
+		Springs_add(springs, 0, 1);
+		Springs_add(springs, 0, 2);
+		Springs_add(springs, 0, 3);
+		Springs_add(springs, 1, 2);
+		Springs_add(springs, 1, 3);
+		Springs_add(springs, 2, 3);
 	}
-	char connections[NB_NODES][NB_NODES];
-	for (int i = 0; i < NB_NODES; i++){
-		for (int j = 0; j < NB_NODES; j++){
-			connections[i][j] = 0;
+	Batch batch = Batch_init();
+	// the frame is drawn on the processor and uploaded as a single texture when SOFT_BODY_RASTER is set, which is
+	// faster than the fallback paths of the renderer on hosts without a GPU. It is also needed to export the frames.
+	const char* export_pattern = getenv("SOFT_BODY_EXPORT");
+	ThreadPool raster_pool;
+	ThreadPool* raster_threads = NULL;
+	if (getenv("SOFT_BODY_RASTER") != NULL || export_pattern != NULL){
+		if (ThreadPool_create(&raster_pool, RASTER_THREADS)){
+			fprintf(stderr, "Could not start the rasterizer threads, rasterizing on a single one.\n");
+		} else {
+			raster_threads = &raster_pool;
+		}
+		if (Batch_use_raster(&batch, renderer, WINDOW_W, WINDOW_H, BACKGROUND_COLOR, raster_threads)){
+			fprintf(stderr, "Could not start the software rasterizer, drawing with the renderer.\n");
+		}
+	}
+	// every new state of the simulation is written to a file when SOFT_BODY_EXPORT gives a pattern, as PNG if it ends
+	// with .png, as PPM otherwise. The files are written by background threads, and a frame is dropped rather than
+	// waited for when they cannot keep up. The viewer quits once SOFT_BODY_EXPORT_FRAMES states were exported, so that
+	// an export can run without anyone to close it.
+	Exporter exporter;
+	char exporting = 0;
+	const char* export_length = getenv("SOFT_BODY_EXPORT_FRAMES");
+	unsigned long long export_frames = (export_length != NULL)?strtoull(export_length, NULL, 0):0;
+	unsigned long long exported = 0;
+	unsigned long long exporter_drops = 0;
+	double exporter_report = 0;
+	if (export_pattern != NULL && batch.texture != NULL){
+		const char* export_extension = strrchr(export_pattern, '.');
+		ExporterWriter writer = (export_extension != NULL && strcmp(export_extension, ".png") == 0)?write_png:NULL;
+		if (Exporter_start(&exporter, export_pattern, writer, WINDOW_W, WINDOW_H, EXPORT_FRAMES, EXPORT_THREADS)){
+			fprintf(stderr, "Could not start the frame export.\n");
+		} else {
+			exporting = 1;
 		}
 	}
 
-	nodes[0].x = WINDOW_W/2-100;
-	nodes[0].y = WINDOW_H/4-100;
-	nodes[0].vx = 0;
-	nodes[0].vy = 0;
-	nodes[0].ax = 0;
-	nodes[0].ay = 0;
-	nodes[0].locked = 0;
-	nodes[0].active = 1;
-	nodes[1].x = WINDOW_W/2+100;
-	nodes[1].y = WINDOW_H/4-100;
-	nodes[1].vx = 0;
-	nodes[1].vy = 0;
-	nodes[1].ax = 0;
-	nodes[1].ay = 0;
-	nodes[1].locked = 0;
-	nodes[1].active = 1;
-	nodes[2].x = WINDOW_W/2-100;
-	nodes[2].y = WINDOW_H/4+100;
-	nodes[2].vx = 0;
-	nodes[2].vy = 0;
-	nodes[2].ax = 0;
-	nodes[2].ay = 0;
-	nodes[2].locked = 0;
-	nodes[2].active = 1;
-	nodes[3].x = WINDOW_W/2+100;
-	nodes[3].y = WINDOW_H/4+100;
-	nodes[3].vx = 0;
-	nodes[3].vy = 0;
-	nodes[3].ax = 0;
-	nodes[3].ay = 0;
-	nodes[3].locked = 0;
-	nodes[3].active = 1;
-	connections[0][1] = 1;
-	connections[0][2] = 1;
-	connections[0][3] = 1;
-	connections[1][2] = 1;
-	connections[1][3] = 1;
-	connections[2][3] = 1;
+	int mouse_x = 0, mouse_y = 0;
+	// the simulation is paused at first, unless it is exported, there being no one to press P then.
+	char simulate = exporting;
+	// the nodes under the mouse, found on a grid of the nodes of the snapshot, and the snapshot it was built for.
+	int hovered[PICK_MAX];
+	Grid hover_grid = Grid_init(2*PICK_RADIUS);
+	uint64_t hover_sequence = 0;
+	// the whole box of the simulation is shown at first, the wheel zooms and dragging with the right button pans.
+	View view = View_fit(sim.width, sim.height, WINDOW_W, WINDOW_H);
 
-	int mouse_x, mouse_y;
-	Uint32 mouse_buttons;
-	char simulate = 0;
+	sim.adaptive = PHYSICS_ADAPTIVE;
+	// the springs break once strained past SOFT_BODY_TEAR, e.g. 1 for twice their rest length.
+	const char* tear = getenv("SOFT_BODY_TEAR");
+	if (tear != NULL && Springs_use_tearing(springs, strtof(tear, NULL))){
+		fprintf(stderr, "Could not allocate the thresholds of the springs, they will not tear.\n");
+	}
+	if (Simulation_set_threads(&sim, PHYSICS_THREADS)){
+		fprintf(stderr, "Could not start the physics threads, running on a single one.\n");
+	}
+	printf("Using the %s kernels on %d threads.\n", sim.kernels.name, ThreadPool_size(sim.pool));
+
+	// the simulation is stepped on a thread of its own from now on, and is only seen through the snapshots it
+	// publishes until the pipeline is stopped.
+	Pipeline pipeline;
+	if (Pipeline_start(&pipeline, &sim, PHYSICS_DT, PHYSICS_MAX_STEPS, simulate)){
+		fprintf(stderr, "Could not start the simulation thread.\n");
+		free(render_x);
+		free(render_y);
+		Simulation_free(&sim);
+		Scene_close(&scene);
+		close_renderer(&renderer);
+		close_window(&window);
+		quit(LIBS);
+		return 1;
+	}
+	// every state is drawn when exported, the frames being dropped by the exporter alone.
+	Pipeline_set_lockstep(&pipeline, exporting);
+	uint64_t sequence = 0;
 
-	float K = 10;
-	float Kd = 1;
-	float L0 = 200;
-	float GRAVITY = 200;
-	float DRAG = 0.99;
+	// the scopes are timed with the performance counter of SDL, the finest clock it has.
+	Profiler_set_clock(SDL_GetPerformanceCounter, SDL_GetPerformanceFrequency());
 
 /*## MAIN LOOP PREPARATION #######################################################################*/
 	char loop = 1;
 	SDL_Event e;
 
 /*## VARIABLES USED FOR FRAME RATE MANAGEMENT ####################################################*/
-	Timer fps_timer = Timer_init();
 	Timer cap_timer = Timer_init();
-	Uint8 frames = 1;
-	Timer_start(&fps_timer);
 	Timer_start(&cap_timer);
 
+	// the frame statistics go to the standard output unless SOFT_BODY_STATS names a file, as JSON lines if it ends
+	// with .json or .jsonl, as CSV otherwise.
+	Stats stats;
+	const char* stats_path = getenv("SOFT_BODY_STATS");
+	const char* extension = (stats_path == NULL)?NULL:strrchr(stats_path, '.');
+	StatsFormat stats_format = (extension != NULL && (strcmp(extension, ".json") == 0 || strcmp(extension, ".jsonl") == 0))
+			?STATS_JSON:STATS_CSV;
+	if (Stats_open(&stats, stats_path, stats_format, STATS_PERIOD)){
+		Stats_open(&stats, NULL, STATS_CSV, STATS_PERIOD);
+	}
+
+/*## VARIABLES USED FOR THE FRAME TIMING ########################################################*/
+	Uint64 counter_frequency = SDL_GetPerformanceFrequency();
+	Uint64 last_counter = SDL_GetPerformanceCounter();
+
 /*##################################################################################################
 ## MAIN LOOP #######################################################################################
 ##################################################################################################*/
 	while (loop){
 /*## EVENT HANDLING ##############################################################################*/
+		PROFILE_BEGIN("frame");
+		PROFILE_BEGIN("events");
 		SDL_PumpEvents();
 		while (SDL_PollEvent(&e) != 0){
 			if (e.type == SDL_QUIT){
 				loop = 0;
 			} else if (e.type == SDL_MOUSEMOTION){
+				mouse_x = e.motion.x;
+				mouse_y = e.motion.y;
+				if (e.motion.state & SDL_BUTTON_RMASK){
+					View_pan(&view, e.motion.xrel, e.motion.yrel);
+				}
+				if (e.motion.state & SDL_BUTTON_LMASK){
+					Pipeline_move_grab(&pipeline, view.x + mouse_x/view.zoom, view.y + mouse_y/view.zoom);
+				}
+			} else if (e.type == SDL_MOUSEWHEEL && e.wheel.y != 0){
+				View_zoom(&view, powf(ZOOM_STEP, e.wheel.y), mouse_x, mouse_y);
+			} else if (e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_LEFT){
+				// the left button grabs the node under the mouse, or every node around it with shift held.
+				const Uint8* key_states = SDL_GetKeyboardState(NULL);
+				Pipeline_grab(&pipeline, view.x + e.button.x/view.zoom, view.y + e.button.y/view.zoom,
+						key_states[SDL_SCANCODE_LSHIFT] || key_states[SDL_SCANCODE_RSHIFT]);
+			} else if (e.type == SDL_MOUSEBUTTONUP && e.button.button == SDL_BUTTON_LEFT){
+				Pipeline_release(&pipeline);
 			}
-//			mouse_buttons = SDL_GetMouseState(&mouse_x, &mouse_y);
-//			if ((mouse_buttons & SDL_BUTTON_LMASK) != 0){
-//				printf("%ld\n", time(NULL));
-//				printf("Mouse Button 1 (left) is pressed.\n");
-//				char found = 0;
-//				for (int i = 0; i < NB_NODES; i++){
-//					if (!nodes[i].active){
-//							found = 1;
-//							nodes[i].x = mouse_x;
-//							nodes[i].y = mouse_y;
-//							nodes[i].vx = 0;
-//							nodes[i].vy = 0;
-//							nodes[i].ax = 0;
-//							nodes[i].ay = 0;
-//							nodes[i].locked = 0;
-//							nodes[i].active = 1;
-//							break;
-//						}
-//				}
-//				if (found == 0){
-//					printf("all nodes are created!\n");
-//				}
-//			}
-//			if ((mouse_buttons & SDL_BUTTON_RMASK) != 0){
-//				printf("Mouse Button 2 (right) is pressed.\n");
-//				char found = 0;
-//				for (int i = 0; i < NB_NODES; i++){
-//					if (!nodes[i].active){
-//							found = 1;
-//							nodes[i].x = mouse_x;
-//							nodes[i].y = mouse_y;
-//							nodes[i].vx = 0;
-//							nodes[i].vy = 0;
-//							nodes[i].ax = 0;
-//							nodes[i].ay = 0;
-//							nodes[i].locked = 1;
-//							nodes[i].active = 1;
-//							break;
-//						}
-//				}
-//				if (found == 0){
-//					printf("all nodes are created!\n");}
-//				}
 		}
 		const Uint8* current_key_states = SDL_GetKeyboardState(NULL);
 		if (current_key_states[SDL_SCANCODE_ESCAPE]){
 			loop = 0;
 		}
 //		if (current_key_states[SDL_SCANCODE_R]){
-//			for (int i = 0; i < NB_NODES; i++){
-//				nodes[i].active = 0;
-//			}
+//			nodes->count = 0;
+//			Springs_clear(springs);
 //		}
 		if (current_key_states[SDL_SCANCODE_P]){
 			simulate ^= 1;
+			Pipeline_set_running(&pipeline, simulate);
 		}
+		PROFILE_END();
 
 /*## UPDATING THE OBJECTS. #######################################################################*/
-		float dx, dy, d, fs, fd, force;
-		if (simulate){
-			for (int i = 0; i < NB_NODES; i++){
-				if (nodes[i].active){
-					nodes[i].ax = 0;
-					nodes[i].ay = GRAVITY;
-				}
-			}
-			for (int i = 0; i < NB_NODES; i++){
-				if (nodes[i].active){
-					for (int j = i+1; j < NB_NODES; j++){
-						if (nodes[j].active){
-							if (connections[i][j]){
-								dx = nodes[i].x - nodes[j].x;
-								dy = nodes[i].y - nodes[j].y;
-								d = sqrt(dx*dx + dy*dy);
-								fs = K * (d - L0);
-								fd = (dx/d * (nodes[i].vx - nodes[j].vx) + dy/d * (nodes[i].vy - nodes[j].vy)) * Kd;
-								force = fs + fd;
-								
-								nodes[i].ax += - force * dx / d;
-								nodes[i].ay += - force * dy / d;
-								nodes[j].ax += + force * dx / d;
-								nodes[j].ay += + force * dy / d;
-							}
-						}
-					}
-				}
-			}
-
-			for (int i = 0; i < NB_NODES; i++){
-				if ((nodes[i].active) && (!nodes[i].locked)){
-					nodes[i].vx += DT * nodes[i].ax;
-					nodes[i].vy += DT * nodes[i].ay;
-					nodes[i].vx *= DRAG;
-					nodes[i].vy *= DRAG;
-					nodes[i].x += DT * nodes[i].vx;
-					nodes[i].y += DT * nodes[i].vy;
-					char  left = nodes[i].x < 0;
-					char right = nodes[i].x > WINDOW_W;
-					char    up = nodes[i].y < 0;
-					char  down = nodes[i].y > WINDOW_H;
-					char outside = left || right || up || down;
-					if (outside){
-						nodes[i].vx *= -1;
-						nodes[i].vy *= -1;
-					}
-					if  (left){ nodes[i].x = 0; }
-					if (right){ nodes[i].x = WINDOW_W; }
-					if    (up){ nodes[i].y = 0; }
-					if  (down){ nodes[i].y = WINDOW_H; }
-				}
+		// the time elapsed since the last frame is the duration of the whole last frame.
+		Uint64 counter = SDL_GetPerformanceCounter();
+		double elapsed = (double)(counter - last_counter) / counter_frequency;
+		last_counter = counter;
+		Stats_end_frame(&stats, elapsed);
+		if (atomic_load(&pipeline.failed)){
+			fprintf(stderr, "Could not allocate a snapshot of the simulation.\n");
+			PROFILE_END();
+			break;
+		}
+		// the physics runs meanwhile on its own thread, the latest state it published is drawn.
+		const Snapshot* snapshot = Pipeline_acquire(&pipeline);
+		char fresh = snapshot->sequence != sequence;
+		if (fresh){
+			sequence = snapshot->sequence;
+			Stats_record(&stats, STATS_PHYSICS, snapshot->physics);
+		}
+		Uint64 render_start = SDL_GetPerformanceCounter();
+		PROFILE_BEGIN("render");
+		// the node store may have grown since the last frame.
+		if (snapshot->nodes.capacity > render_capacity){
+			float* grown_x = realloc(render_x, snapshot->nodes.capacity*sizeof(float));
+			float* grown_y = (grown_x == NULL)?NULL:realloc(render_y, snapshot->nodes.capacity*sizeof(float));
+			if (grown_y == NULL){
+				fprintf(stderr, "Could not allocate the rendered positions.\n");
+				render_x = (grown_x == NULL)?render_x:grown_x;
+				PROFILE_END();
+				PROFILE_END();
+				break;
 			}
+			render_x = grown_x;
+			render_y = grown_y;
+			render_capacity = snapshot->nodes.capacity;
 		}
+		Nodes_interpolate(&snapshot->nodes, Pipeline_alpha(snapshot, PHYSICS_DT, Pipeline_now()), render_x, render_y);
 
 /*## RENDERING ###################################################################################*/
-		set_background_color(renderer, 0x333333ff);
+		set_background_color(renderer, BACKGROUND_COLOR << 8 | 0xff);
 
-		float c;
-		for (int i = 0; i < NB_NODES; i++){
-			if (nodes[i].active){
-				for (int j = i+1; j < NB_NODES; j++){
-					if (nodes[j].active){
-						if (connections[i][j]){
-							dx = nodes[i].x - nodes[j].x;
-							dy = nodes[i].y - nodes[j].y;
-							d = sqrt(dx*dx + dy*dy);
-							c = exp(-d/300) * 255;
-							SDL_SetRenderDrawColor(renderer, c, c, c, 0xff);
-							SDL_RenderDrawLine(renderer, nodes[i].x, nodes[i].y, nodes[j].x, nodes[j].y);
-						}
-					}
-				}
+		// everything is gathered into a single batch, drawn with one call whatever the number of springs and nodes. When
+		// zoomed out, the springs shorter than a pixel are left out and the nodes are drawn as a density map, so that
+		// the number of quads depends on the window rather than on the scene.
+		Batch_clear(&batch);
+		char far = view.zoom < LOD_ZOOM;
+		char failed = Batch_add_springs(&batch, &snapshot->springs, snapshot->tiles, snapshot->bins,
+				snapshot->bin_offsets, snapshot->nb_bins, render_x, render_y, SPRING_WIDTH, far?1:0, &view);
+		if (far){
+			failed = failed || Batch_add_density(&batch, &snapshot->nodes, snapshot->tiles, PIPELINE_TILE, render_x,
+					render_y, DENSITY_CELL, &view);
+		} else {
+			failed = failed || Batch_add_nodes(&batch, &snapshot->nodes, snapshot->tiles, PIPELINE_TILE, render_x,
+					render_y, NODE_SIZE, &view);
+		}
+		// the nodes grabbed are highlighted, otherwise the closest node under the mouse, or all of them with shift
+		// held. The grid answers in O(1), and is only built for the snapshots looked under, and again when the radius
+		// changes with the zoom.
+		float pick_radius = PICK_RADIUS/view.zoom;
+		Pipeline_set_pick_radius(&pipeline, pick_radius);
+		float world_x = view.x + mouse_x/view.zoom;
+		float world_y = view.y + mouse_y/view.zoom;
+		const Uint8* key_states = SDL_GetKeyboardState(NULL);
+		int nb_hovered = 0;
+		if (snapshot->nb_grabbed > 0){
+			failed = failed || Batch_add_highlight(&batch, &snapshot->nodes, snapshot->grabbed, snapshot->nb_grabbed,
+					render_x, render_y, NODE_SIZE, &view);
+		} else {
+			if (hover_sequence != sequence || hover_grid.cell_size != 2*pick_radius){
+				hover_grid.cell_size = 2*pick_radius;
+				hover_sequence = Grid_build(&hover_grid, snapshot->nodes.x, snapshot->nodes.y, NULL,
+						snapshot->nodes.count)?0:sequence;
+			}
+			// nothing is highlighted when the grid could not be allocated, it is built again on the next frame.
+			if (hover_sequence == 0){
+				nb_hovered = 0;
+			} else if (key_states[SDL_SCANCODE_LSHIFT] || key_states[SDL_SCANCODE_RSHIFT]){
+				nb_hovered = Grid_query(&hover_grid, world_x, world_y, pick_radius, hovered, PICK_MAX);
+			} else {
+				hovered[0] = Grid_nearest(&hover_grid, world_x, world_y, pick_radius);
+				nb_hovered = hovered[0] != -1;
 			}
 		}
-		for (int i = 0; i < NB_NODES; i++){
-			if (nodes[i].active){
-				float dx = mouse_x - nodes[i].x;
-				float dy = mouse_y - nodes[i].y;
-				float dist_to_mouse = dx*dx + dy*dy;;
-				SDL_SetRenderDrawColor(renderer, 0xff, (nodes[i].locked)?0x00:0xff, (dist_to_mouse < 400)?0x00:0xff, 0xff);
-				SDL_Rect rect = {nodes[i].x - 10, nodes[i].y - 10, 20, 20};
-				SDL_RenderFillRect(renderer, &rect);
+		nb_hovered = (nb_hovered < PICK_MAX)?nb_hovered:PICK_MAX;
+		failed = failed || Batch_add_highlight(&batch, &snapshot->nodes, hovered, nb_hovered, render_x, render_y,
+				NODE_SIZE, &view);
+		if (failed){
+			fprintf(stderr, "Could not allocate the render batch.\n");
+			loop = 0;
+		}
+		Batch_render(&batch, renderer);
+		if (exporting && fresh){
+			int buffer = Exporter_acquire(&exporter);
+			if (buffer != -1){
+				size_t frame = (size_t)exporter.width*exporter.height;
+				memcpy(exporter.pixels + buffer*frame, batch.raster.pixels, frame*sizeof(uint32_t));
+				Exporter_submit(&exporter, buffer, sequence);
+			}
+			// the frames dropped count, the export covering the states of the simulation whether they were written.
+			if (++exported == export_frames){
+				loop = 0;
+			}
+			// the drops are reported as they happen, once per period of the statistics at most.
+			unsigned long long drops = atomic_load(&exporter.dropped);
+			if (drops > exporter_drops && Pipeline_now() - exporter_report >= STATS_PERIOD){
+				fprintf(stderr, "The disk cannot keep up, %llu frames dropped so far.\n", drops);
+				exporter_drops = drops;
+				exporter_report = Pipeline_now();
 			}
 		}
+		PROFILE_END();
 
+		PROFILE_BEGIN("present");
 		SDL_RenderPresent(renderer);
+		PROFILE_END();
+		Uint64 render_counter = SDL_GetPerformanceCounter();
+		Stats_record(&stats, STATS_RENDER, (double)(render_counter - render_start) / counter_frequency);
 
-/*## FRAME RATE SHOWING AND CAPPING ##############################################################*/
-		frames++;
-		if (frames%MAX_FPS == 0){
-			printf("%f\n", frames*1000./(double)Timer_get_ticks(fps_timer));
-			frames = 0;
-			Timer_start(&fps_timer);
-		}
-		if (Timer_get_ticks(cap_timer) < TICKS_PER_FRAME){
+/*## FRAME RATE CAPPING ##########################################################################*/
+		PROFILE_BEGIN("sleep");
+		// the frames are not capped while exported, the renderer has to keep up with the simulation.
+		if (!exporting && Timer_get_ticks(cap_timer) < TICKS_PER_FRAME){
 			SDL_Delay(TICKS_PER_FRAME-Timer_get_ticks(cap_timer));
 		}
 		Timer_start(&cap_timer);
+		PROFILE_END();
+		PROFILE_END();
+		Stats_record(&stats, STATS_SLEEP, (double)(SDL_GetPerformanceCounter() - render_counter) / counter_frequency);
 	}
 
 /*##################################################################################################
 ## CLOSING EVERYTHING###############################################################################
 ##################################################################################################*/
+	Pipeline_stop(&pipeline);
+	if (sim.torn > 0){
+		printf("%d springs were torn.\n", sim.torn);
+	}
+	if (sim.repaired > 0){
+		printf("%d nodes were put back at rest after their state stopped being finite.\n", sim.repaired);
+	}
+	if (exporting){
+		Exporter_stop(&exporter);
+		printf("Exported %llu frames, %llu dropped because the disk could not keep up, %llu could not be written.\n",
+				(unsigned long long)atomic_load(&exporter.written), (unsigned long long)atomic_load(&exporter.dropped),
+				(unsigned long long)atomic_load(&exporter.failed));
+	}
+#ifdef SOFT_BODY_PROFILE
+	// the physics threads are idle once the pipeline is stopped, so the trace is dumped while nothing records anymore.
+	if (getenv("SOFT_BODY_TRACE") != NULL){
+		Profiler_dump(getenv("SOFT_BODY_TRACE"));
+	}
+#endif
+	Stats_close(&stats);
+	Batch_free(&batch);
+	Grid_free(&hover_grid);
+	if (raster_threads != NULL){
+		ThreadPool_free(raster_threads);
+	}
+	free(render_x);
+	free(render_y);
+	Simulation_free(&sim);
+	Profiler_free();
+	Scene_close(&scene);
 	close_renderer(&renderer);
 	close_window(&window);
 	quit(LIBS);
 
 	return 0;
 }
-
-void DrawCircle(SDL_Renderer * renderer, int32_t centreX, int32_t centreY, int32_t radius)
-{
-   const int32_t diameter = (radius * 2);
-
-   int32_t x = (radius - 1);
-   int32_t y = 0;
-   int32_t tx = 1;
-   int32_t ty = 1;
-   int32_t error = (tx - diameter);
-
-   while (x >= y)
-   {
-      //  Each of the following renders an octant of the circle
-      SDL_RenderDrawPoint(renderer, centreX + x, centreY - y);
-      SDL_RenderDrawPoint(renderer, centreX + x, centreY + y);
-      SDL_RenderDrawPoint(renderer, centreX - x, centreY - y);
-      SDL_RenderDrawPoint(renderer, centreX - x, centreY + y);
-      SDL_RenderDrawPoint(renderer, centreX + y, centreY - x);
-      SDL_RenderDrawPoint(renderer, centreX + y, centreY + x);
-      SDL_RenderDrawPoint(renderer, centreX - y, centreY - x);
-      SDL_RenderDrawPoint(renderer, centreX - y, centreY + x);
-
-      if (error <= 0)
-      {
-         ++y;
-         error += ty;
-         ty += 2;
-      }
-
-      if (error > 0)
-      {
-         --x;
-         tx += 2;
-         error += (tx - diameter);
-      }
-   }
-}
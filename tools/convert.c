@@ -0,0 +1,168 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Scene.h"
+
+/* Converts a text scene into a binary one, see Scene.h. The text scene is made of keywords followed by their values,
+ * anything after a '#' being a comment:
+ *     box <width> <height>
+ *     springs <K> <Kd> <L0>
+ *     nodes <count>
+ *     <x> <y> <locked>        count times
+ *     edges <count>
+ *     <a> <b>                 count times
+ * springs is optional, the defaults of the engine being used otherwise, and the box defaults to twice the extent of the
+ * nodes. */
+
+/* Reads the next word, skipping the blanks and the comments. */
+static char next_word(FILE* file, char* word, int size){
+	int c;
+	while ((c = fgetc(file)) != EOF){
+		if (c == '#'){
+			while ((c = fgetc(file)) != EOF && c != '\n');
+		} else if (c != ' ' && c != '\t' && c != '\n' && c != '\r'){
+			break;
+		}
+	}
+	int length = 0;
+	while (c != EOF && c != ' ' && c != '\t' && c != '\n' && c != '\r' && c != '#'){
+		if (length < size-1){
+			word[length++] = c;
+		}
+		c = fgetc(file);
+	}
+	if (c == '#'){
+		ungetc(c, file);
+	}
+	word[length] = '\0';
+	return length > 0;
+}
+
+static char next_float(FILE* file, float* value){
+	char word[64];
+	char* end;
+	if (!next_word(file, word, sizeof(word))){
+		return 0;
+	}
+	*value = strtof(word, &end);
+	return *end == '\0';
+}
+
+static char next_int(FILE* file, int* value){
+	char word[64];
+	char* end;
+	if (!next_word(file, word, sizeof(word))){
+		return 0;
+	}
+	*value = strtol(word, &end, 10);
+	return *end == '\0';
+}
+
+static char convert(FILE* input, Simulation* sim){
+	float width = -1, height = -1;
+	float K = SIMULATION_K, Kd = SIMULATION_KD, L0 = SIMULATION_L0;
+	int nb_nodes = -1;
+	char word[64];
+	while (next_word(input, word, sizeof(word))){
+		if (strcmp(word, "box") == 0){
+			if (!next_float(input, &width) || !next_float(input, &height) || width < 0 || height < 0){
+				fprintf(stderr, "box expects a width and a height.\n");
+				return 1;
+			}
+			sim->width = width;
+			sim->height = height;
+		} else if (strcmp(word, "springs") == 0){
+			if (!next_float(input, &K) || !next_float(input, &Kd) || !next_float(input, &L0)){
+				fprintf(stderr, "springs expects a stiffness, a damping and a rest length.\n");
+				return 1;
+			}
+		} else if (strcmp(word, "nodes") == 0){
+			if (nb_nodes >= 0 || !next_int(input, &nb_nodes) || nb_nodes < 0){
+				fprintf(stderr, "nodes expects a number of nodes, and can only be given once.\n");
+				return 1;
+			}
+			if (Simulation_create(sim, nb_nodes, width, height)){
+				fprintf(stderr, "Could not allocate %d nodes.\n", nb_nodes);
+				return 1;
+			}
+			for (int i = 0; i < nb_nodes; i++){
+				float x, y;
+				int locked;
+				if (!next_float(input, &x) || !next_float(input, &y) || !next_int(input, &locked)){
+					fprintf(stderr, "node %d expects x, y and whether it is locked.\n", i);
+					return 1;
+				}
+				if (Nodes_add(&sim->nodes, x, y, locked != 0) < 0){
+					fprintf(stderr, "Could not allocate %d nodes.\n", nb_nodes);
+					return 1;
+				}
+			}
+		} else if (strcmp(word, "edges") == 0){
+			int nb_springs;
+			if (nb_nodes < 0 || !next_int(input, &nb_springs) || nb_springs < 0){
+				fprintf(stderr, "edges expects a number of springs, after the nodes.\n");
+				return 1;
+			}
+			if (Springs_reserve(&sim->springs, sim->springs.count + nb_springs)){
+				fprintf(stderr, "Could not allocate %d springs.\n", nb_springs);
+				return 1;
+			}
+			for (int s = 0; s < nb_springs; s++){
+				int a, b;
+				if (!next_int(input, &a) || !next_int(input, &b) || a < 0 || b < 0 || a >= nb_nodes || b >= nb_nodes){
+					fprintf(stderr, "spring %d expects two nodes between 0 and %d.\n", s, nb_nodes-1);
+					return 1;
+				}
+				Springs_add(&sim->springs, a, b);
+			}
+		} else {
+			fprintf(stderr, "Unknown keyword %s.\n", word);
+			return 1;
+		}
+	}
+	if (nb_nodes < 0){
+		fprintf(stderr, "The scene has no nodes.\n");
+		return 1;
+	}
+	// the parameters of the springs are set once the whole scene is read, springs being allowed after the nodes.
+	sim->K = K;
+	sim->Kd = Kd;
+	sim->L0 = L0;
+	if (width < 0 || height < 0){
+		sim->width = 0;
+		sim->height = 0;
+		for (int i = 0; i < nb_nodes; i++){
+			sim->width = (2*sim->nodes.x[i] > sim->width)?2*sim->nodes.x[i]:sim->width;
+			sim->height = (2*sim->nodes.y[i] > sim->height)?2*sim->nodes.y[i]:sim->height;
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char** argv){
+	if (argc != 3){
+		fprintf(stderr, "usage: %s <text scene> <binary scene>\n", argv[0]);
+		return 1;
+	}
+	FILE* input = fopen(argv[1], "r");
+	if (input == NULL){
+		fprintf(stderr, "Could not open %s.\n", argv[1]);
+		return 1;
+	}
+
+	Simulation sim;
+	memset(&sim, 0, sizeof(Simulation));
+	char error = convert(input, &sim);
+	fclose(input);
+	if (!error){
+		error = Scene_save(&sim, argv[2]);
+	}
+	if (!error){
+		printf("%s: %d nodes, %d springs\n", argv[2], sim.nodes.count, sim.springs.count);
+	}
+	if (sim.nodes.x != NULL){
+		Simulation_free(&sim);
+	}
+	return error;
+}
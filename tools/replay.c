@@ -0,0 +1,168 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "Scene.h"
+#include "Trace.h"
+
+/* The scene built when none is given: a square grid of springs hanging from its top row, its nodes moved at random by
+ * up to a fraction of the rest length so that the mesh is not symmetric. */
+#define DEFAULT_SIDE  32
+#define DEFAULT_STEPS 600
+#define JITTER        0.125f
+#define SEED          0x9e3779b9u
+/* The fixed time step the traces are recorded with. */
+#define DT            (1.f/240)
+
+/* The names of the solvers, in the order of the Solver enumeration. */
+static const char* SOLVERS[] = {"explicit", "implicit", "xpbd"};
+#define NB_SOLVERS ((int)(sizeof(SOLVERS)/sizeof(SOLVERS[0])))
+
+/* A xorshift generator, so that the scenes built from a seed are the same on every run and on every platform. */
+static uint32_t next_random(uint32_t* state){
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+/* Builds the default scene from a seed, in a box twice as high as the grid so that it swings and hits the floor. */
+static char build(Simulation* sim, uint32_t seed){
+	int side = DEFAULT_SIDE;
+	if (Simulation_create(sim, side*side, (side+1)*SIMULATION_L0, 2*(side+1)*SIMULATION_L0)){
+		return 1;
+	}
+	uint32_t state = seed;
+	for (int r = 0; r < side; r++){
+		for (int c = 0; c < side; c++){
+			float dx = ((next_random(&state) & 0xffff) / 65535.f - 0.5f) * 2*JITTER*sim->L0;
+			float dy = ((next_random(&state) & 0xffff) / 65535.f - 0.5f) * 2*JITTER*sim->L0;
+			if (Nodes_add(&sim->nodes, (c+1)*sim->L0 + dx, (r+1)*sim->L0 + dy, r == 0) < 0){
+				return 1;
+			}
+		}
+	}
+	for (int r = 0; r < side; r++){
+		for (int c = 0; c < side; c++){
+			int i = r*side + c;
+			if ((c+1 < side && Springs_add(&sim->springs, i, i+1)) || (r+1 < side && Springs_add(&sim->springs, i, i+side))
+					|| (c+1 < side && r+1 < side && Springs_add(&sim->springs, i, i+side+1))){
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+/* Steps a simulation, recording every state into a new trace. */
+static char record(Simulation* sim, const char* path, int nb_steps, uint32_t seed){
+	Trace trace;
+	if (Trace_create(&trace, path, sim, DT, seed)){
+		return 1;
+	}
+	char failed = 0;
+	for (int step = 0; step < nb_steps && !failed; step++){
+		Simulation_step(sim, DT);
+		failed = Trace_record(&trace, &sim->nodes);
+	}
+	failed |= Trace_close(&trace);
+	if (failed){
+		fprintf(stderr, "Could not write the trace %s.\n", path);
+		return 1;
+	}
+	printf("%s: %d steps of %d nodes, last checksum %016llx\n", path, nb_steps, sim->nodes.count,
+			(unsigned long long)Trace_hash(&sim->nodes));
+	return 0;
+}
+
+/* Steps a simulation along an opened trace until the end of the trace or the first divergence. */
+static char check(Simulation* sim, Trace* trace, uint32_t tolerance){
+	TraceDivergence divergence;
+	int result = 0;
+	while (result == 0){
+		Simulation_step(sim, trace->header.dt);
+		result = Trace_check(trace, &sim->nodes, tolerance, &divergence);
+	}
+	if (result == 1){
+		printf("diverged at step %d, node %d: %s is %.9g instead of %.9g, %u ulps away\n", divergence.step,
+				divergence.node, divergence.field, divergence.actual, divergence.expected, divergence.ulps);
+		return 1;
+	}
+	if (result == -2){
+		if (sim->nodes.count != (int)trace->header.nb_nodes){
+			fprintf(stderr, "The simulation has %d nodes at step %d, the trace %u.\n", sim->nodes.count, trace->step,
+					trace->header.nb_nodes);
+		} else {
+			fprintf(stderr, "The trace is truncated or cannot be read at step %d.\n", trace->step);
+		}
+		return 1;
+	}
+	// the last step run had no record to be checked against.
+	printf("%d steps match, at most %u ulps away\n", trace->step, trace->max_ulps);
+	return 0;
+}
+
+int main(int argc, char** argv){
+	char recording = argc > 2 && strcmp(argv[1], "record") == 0;
+	char checking = argc > 2 && strcmp(argv[1], "check") == 0;
+	// record <trace> [steps] [threads] [solver] [scene], check <trace> [threads] [ulps] [scene].
+	int next = 3;
+	int nb_steps = (recording && argc > next)?atoi(argv[next++]):DEFAULT_STEPS;
+	int nb_threads = (argc > next)?atoi(argv[next++]):1;
+	const char* solver = (recording && argc > next)?argv[next++]:"explicit";
+	long tolerance = (checking && argc > next)?atol(argv[next++]):0;
+	const char* scene_path = (argc > next)?argv[next]:NULL;
+	int solver_id = -1;
+	for (int id = 0; id < NB_SOLVERS; id++){
+		if (strcmp(solver, SOLVERS[id]) == 0){
+			solver_id = id;
+		}
+	}
+	if ((!recording && !checking) || nb_steps <= 0 || nb_threads < 0 || solver_id < 0 || tolerance < 0
+			|| tolerance > UINT32_MAX){
+		fprintf(stderr, "usage: %s record <trace> [steps] [threads] [explicit|implicit|xpbd] [scene]\n"
+				"       %s check <trace> [threads] [ulps] [scene]\n", argv[0], argv[0]);
+		return 1;
+	}
+
+	Trace trace;
+	if (checking && Trace_open(&trace, argv[2])){
+		return 1;
+	}
+	uint32_t seed = checking?trace.header.seed:SEED;
+	Simulation sim;
+	memset(&sim, 0, sizeof(Simulation));
+	Scene scene = {NULL, 0, NULL};
+	char failed = checking && trace.header.solver >= NB_SOLVERS;
+	if (scene_path != NULL){
+		failed = failed || Scene_open(&scene, scene_path) || Scene_load(&scene, &sim);
+		seed = 0;
+	} else {
+		failed = failed || build(&sim, seed);
+	}
+	if (!failed && checking && (trace.header.nb_nodes != (uint32_t)sim.nodes.count
+			|| trace.header.nb_springs != (uint32_t)sim.springs.count)){
+		fprintf(stderr, "The trace was recorded on another scene.\n");
+		failed = 1;
+	}
+	// the trace holds the solver it was recorded with, the kernels and the threads are what is being checked.
+	sim.solver = checking?(Solver)trace.header.solver:(Solver)solver_id;
+	sim.deterministic = 1;
+	failed = failed || Simulation_set_threads(&sim, nb_threads);
+	if (!failed){
+		printf("soft-body-replay: %d nodes, %d springs, %s kernels, %d threads, %s solver\n", sim.nodes.count,
+				sim.springs.count, sim.kernels.name, ThreadPool_size(sim.pool), SOLVERS[sim.solver]);
+		failed = recording?record(&sim, argv[2], nb_steps, seed):check(&sim, &trace, tolerance);
+	}
+
+	if (checking){
+		Trace_close(&trace);
+	}
+	if (sim.nodes.x != NULL){
+		Simulation_free(&sim);
+	}
+	Scene_close(&scene);
+	return failed;
+}